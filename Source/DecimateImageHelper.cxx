@@ -0,0 +1,527 @@
+/*=========================================================================
+
+                                vtkbone
+
+  VTK classes for building and analyzing Numerics88 finite element models.
+
+  Copyright (c) 2010-2025, Numerics88 Solutions.
+  All rights reserved.
+
+=========================================================================*/
+
+#include "DecimateImageHelper.h"
+#include "vtkboneDecimateImage.h"
+#include "vtkSMPTools.h"
+#include "vtkType.h"
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VTKBONE_DECIMATE_SSE2
+#include <emmintrin.h>
+#endif
+
+//----------------------------------------------------------------------------
+// Element-wise maximum of four input rows of length n, written to out.
+template <typename T>
+inline void DecimateImageMaxOfRows(const T* a, const T* b, const T* c, const T* d,
+                                   T* out, int n)
+{
+  for (int i=0; i<n; ++i)
+  {
+    out[i] = std::max(std::max(a[i], b[i]), std::max(c[i], d[i]));
+  }
+}
+
+#ifdef VTKBONE_DECIMATE_SSE2
+
+// The vector loop handles 16 bytes at a time; the remainder of the row is
+// done by the scalar loop.  vmax is the SSE2 maximum for the type.
+template <typename T, typename TMax>
+inline void DecimateImageMaxOfRowsSSE2(const T* a, const T* b, const T* c, const T* d,
+                                       T* out, int n, TMax vmax)
+{
+  const int valuesPerBlock = 16/sizeof(T);
+  int i = 0;
+  for (; i + valuesPerBlock <= n; i += valuesPerBlock)
+  {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m128i vc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + i));
+    __m128i vd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     vmax(vmax(va, vb), vmax(vc, vd)));
+  }
+  DecimateImageMaxOfRows<T>(a+i, b+i, c+i, d+i, out+i, n-i);
+}
+
+// SSE2 only has unsigned 8 bit and signed 16 bit maximum; the other 8 and
+// 16 bit types are offset into their range.
+inline __m128i DecimateImageMaxEpi8(__m128i x, __m128i y)
+{
+  const __m128i bias = _mm_set1_epi8(char(0x80));
+  return _mm_xor_si128(_mm_max_epu8(_mm_xor_si128(x, bias), _mm_xor_si128(y, bias)), bias);
+}
+
+inline __m128i DecimateImageMaxEpu16(__m128i x, __m128i y)
+{
+  const __m128i bias = _mm_set1_epi16(short(0x8000));
+  return _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(x, bias), _mm_xor_si128(y, bias)), bias);
+}
+
+inline void DecimateImageMaxOfRows(const unsigned char* a, const unsigned char* b,
+                                   const unsigned char* c, const unsigned char* d,
+                                   unsigned char* out, int n)
+{
+  DecimateImageMaxOfRowsSSE2(a, b, c, d, out, n,
+    [](__m128i x, __m128i y) { return _mm_max_epu8(x, y); });
+}
+
+inline void DecimateImageMaxOfRows(const signed char* a, const signed char* b,
+                                   const signed char* c, const signed char* d,
+                                   signed char* out, int n)
+{
+  DecimateImageMaxOfRowsSSE2(a, b, c, d, out, n, DecimateImageMaxEpi8);
+}
+
+inline void DecimateImageMaxOfRows(const char* a, const char* b,
+                                   const char* c, const char* d,
+                                   char* out, int n)
+{
+  if (std::numeric_limits<char>::is_signed)
+  {
+    DecimateImageMaxOfRowsSSE2(a, b, c, d, out, n, DecimateImageMaxEpi8);
+  }
+  else
+  {
+    DecimateImageMaxOfRowsSSE2(a, b, c, d, out, n,
+      [](__m128i x, __m128i y) { return _mm_max_epu8(x, y); });
+  }
+}
+
+inline void DecimateImageMaxOfRows(const short* a, const short* b,
+                                   const short* c, const short* d,
+                                   short* out, int n)
+{
+  DecimateImageMaxOfRowsSSE2(a, b, c, d, out, n,
+    [](__m128i x, __m128i y) { return _mm_max_epi16(x, y); });
+}
+
+inline void DecimateImageMaxOfRows(const unsigned short* a, const unsigned short* b,
+                                   const unsigned short* c, const unsigned short* d,
+                                   unsigned short* out, int n)
+{
+  DecimateImageMaxOfRowsSSE2(a, b, c, d, out, n, DecimateImageMaxEpu16);
+}
+
+inline void DecimateImageMaxOfRows(const float* a, const float* b,
+                                   const float* c, const float* d,
+                                   float* out, int n)
+{
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    // The second operand of _mm_max_ps is returned for NaN, as for std::max.
+    __m128 vab = _mm_max_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(a + i));
+    __m128 vcd = _mm_max_ps(_mm_loadu_ps(d + i), _mm_loadu_ps(c + i));
+    _mm_storeu_ps(out + i, _mm_max_ps(vcd, vab));
+  }
+  for (; i<n; ++i)
+  {
+    out[i] = std::max(std::max(a[i], b[i]), std::max(c[i], d[i]));
+  }
+}
+
+inline void DecimateImageMaxOfRows(const double* a, const double* b,
+                                   const double* c, const double* d,
+                                   double* out, int n)
+{
+  int i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d vab = _mm_max_pd(_mm_loadu_pd(b + i), _mm_loadu_pd(a + i));
+    __m128d vcd = _mm_max_pd(_mm_loadu_pd(d + i), _mm_loadu_pd(c + i));
+    _mm_storeu_pd(out + i, _mm_max_pd(vcd, vab));
+  }
+  for (; i<n; ++i)
+  {
+    out[i] = std::max(std::max(a[i], b[i]), std::max(c[i], d[i]));
+  }
+}
+
+#endif  // VTKBONE_DECIMATE_SSE2
+
+//----------------------------------------------------------------------------
+// Collects the input rows contributing to output row (kk,jj): rows
+// jj*f[1] ... of slices kk*f[2] ..., truncated at the input boundary.
+template <typename T>
+inline void DecimateImageBlockRows(
+  const T* iptr,
+  const int idims[3],
+  const int f[3],
+  vtkIdType kk,
+  int jj,
+  std::vector<const T*>& rows)
+{
+  rows.clear();
+  const vtkIdType kEnd = std::min((kk+1)*f[2], vtkIdType(idims[2]));
+  const int jEnd = std::min((jj+1)*f[1], idims[1]);
+  for (vtkIdType k=kk*f[2]; k<kEnd; ++k)
+  {
+    for (int j=jj*f[1]; j<jEnd; ++j)
+    {
+      rows.push_back(iptr + (size_t(k)*size_t(idims[1]) + size_t(j))*size_t(idims[0]));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Calls reduce(rows, orow) for every output row, with the input rows that
+// contribute to it.  Output slices are distributed over threads with
+// vtkSMPTools.  Every output value is written exactly once, so the output
+// need not be initialized.
+template <typename T, typename TOut, typename TReduce>
+void DecimateImageForEachRow(
+  const T* iptr,
+  const int idims[3],
+  TOut* optr,
+  const int odims[3],
+  const int f[3],
+  TReduce reduce)
+{
+  const size_t outRowSize = size_t(odims[0]);
+  const size_t outSliceSize = outRowSize*size_t(odims[1]);
+  vtkSMPTools::For(0, odims[2], [&](vtkIdType kkBegin, vtkIdType kkEnd)
+  {
+    // Holds the row buffers of reduce for this range of slices.
+    TReduce localReduce (reduce);
+    std::vector<const T*> rows;
+    for (vtkIdType kk=kkBegin; kk<kkEnd; ++kk)
+    {
+      TOut* orow = optr + size_t(kk)*outSliceSize;
+      for (int jj=0; jj<odims[1]; ++jj, orow += outRowSize)
+      {
+        DecimateImageBlockRows(iptr, idims, f, kk, jj, rows);
+        localReduce(rows, orow);
+      }
+    }
+  });
+}
+
+//----------------------------------------------------------------------------
+// Output value is maximum over the block.  The contributing input rows are
+// reduced four at a time with vector maximum into a row buffer, which is
+// then reduced along x.
+template <typename T>
+struct DecimateImageMaximum
+{
+  int n, fx;
+  std::vector<T> rowMax;
+
+  DecimateImageMaximum(int _n, int _fx) : n (_n), fx (_fx) {}
+
+  void operator()(const std::vector<const T*>& rows, T* orow)
+  {
+    rowMax.resize(n);
+    const size_t last = rows.size() - 1;
+    DecimateImageMaxOfRows(rows[0], rows[std::min(size_t(1),last)],
+                           rows[std::min(size_t(2),last)], rows[std::min(size_t(3),last)],
+                           rowMax.data(), n);
+    for (size_t r=4; r<rows.size(); r+=3)
+    {
+      DecimateImageMaxOfRows(rowMax.data(), rows[r],
+                             rows[std::min(r+1,last)], rows[std::min(r+2,last)],
+                             rowMax.data(), n);
+    }
+    if (fx == 2)
+    {
+      const int pairs = n/2;
+      for (int ii=0; ii<pairs; ++ii)
+      {
+        orow[ii] = std::max(rowMax[2*ii], rowMax[2*ii+1]);
+      }
+      if (n % 2)
+      {
+        orow[pairs] = rowMax[n-1];
+      }
+      return;
+    }
+    for (int i0=0, ii=0; i0<n; i0+=fx, ++ii)
+    {
+      const int i1 = std::min(i0+fx, n);
+      T v = rowMax[i0];
+      for (int i=i0+1; i<i1; ++i)
+      {
+        v = std::max(v, rowMax[i]);
+      }
+      orow[ii] = v;
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Output value is the mean over the block.
+template <typename T, typename TOut>
+struct DecimateImageMean
+{
+  int n, fx;
+  std::vector<double> sum;
+
+  DecimateImageMean(int _n, int _fx) : n (_n), fx (_fx) {}
+
+  void operator()(const std::vector<const T*>& rows, TOut* orow)
+  {
+    const int nOut = (n + fx - 1)/fx;
+    sum.assign(nOut, 0.0);
+    for (size_t r=0; r<rows.size(); ++r)
+    {
+      const T* row = rows[r];
+      for (int i0=0, ii=0; i0<n; i0+=fx, ++ii)
+      {
+        const int i1 = std::min(i0+fx, n);
+        double s = 0;
+        for (int i=i0; i<i1; ++i)
+        {
+          s += row[i];
+        }
+        sum[ii] += s;
+      }
+    }
+    for (int i0=0, ii=0; i0<n; i0+=fx, ++ii)
+    {
+      const double count = double(rows.size())*double(std::min(fx, n-i0));
+      orow[ii] = TOut(sum[ii]/count);
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Output value is the fraction of non-zero values over the block.
+template <typename T, typename TOut>
+struct DecimateImageOccupancyFraction
+{
+  int n, fx;
+  std::vector<vtkIdType> occupied;
+
+  DecimateImageOccupancyFraction(int _n, int _fx) : n (_n), fx (_fx) {}
+
+  void operator()(const std::vector<const T*>& rows, TOut* orow)
+  {
+    const int nOut = (n + fx - 1)/fx;
+    occupied.assign(nOut, 0);
+    for (size_t r=0; r<rows.size(); ++r)
+    {
+      const T* row = rows[r];
+      for (int i0=0, ii=0; i0<n; i0+=fx, ++ii)
+      {
+        const int i1 = std::min(i0+fx, n);
+        vtkIdType c = 0;
+        for (int i=i0; i<i1; ++i)
+        {
+          c += (row[i] != 0);
+        }
+        occupied[ii] += c;
+      }
+    }
+    for (int i0=0, ii=0; i0<n; i0+=fx, ++ii)
+    {
+      const double count = double(rows.size())*double(std::min(fx, n-i0));
+      orow[ii] = TOut(occupied[ii]/count);
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Output value is the most frequent value over the block; ties are resolved
+// in favour of the larger value.  The values of each block are gathered
+// into a buffer and sorted.
+template <typename T>
+struct DecimateImageMajority
+{
+  int n, fx;
+  std::vector<T> values;
+  std::vector<int> filled;
+
+  DecimateImageMajority(int _n, int _fx) : n (_n), fx (_fx) {}
+
+  void operator()(const std::vector<const T*>& rows, T* orow)
+  {
+    const int nOut = (n + fx - 1)/fx;
+    const size_t blockSize = rows.size()*size_t(fx);
+    values.resize(size_t(nOut)*blockSize);
+    filled.assign(nOut, 0);
+    for (size_t r=0; r<rows.size(); ++r)
+    {
+      const T* row = rows[r];
+      for (int i0=0, ii=0; i0<n; i0+=fx, ++ii)
+      {
+        const int i1 = std::min(i0+fx, n);
+        T* block = values.data() + size_t(ii)*blockSize + filled[ii];
+        std::copy(row + i0, row + i1, block);
+        filled[ii] += i1 - i0;
+      }
+    }
+    for (int ii=0; ii<nOut; ++ii)
+    {
+      T* block = values.data() + size_t(ii)*blockSize;
+      T* blockEnd = block + filled[ii];
+      std::sort(block, blockEnd);
+      T best = *block;
+      std::ptrdiff_t bestCount = 0;
+      while (block != blockEnd)
+      {
+        T* runEnd = std::upper_bound(block, blockEnd, *block);
+        if (runEnd - block >= bestCount)
+        {
+          best = *block;
+          bestCount = runEnd - block;
+        }
+        block = runEnd;
+      }
+      orow[ii] = best;
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Reduces each block of f[0] x f[1] x f[2] input values to one output
+// value.  Where an input dimension is not a multiple of the factor, the
+// last output layer is reduced over the input values remaining.  For
+// the maximum and majority the output type is the input type; for the mean
+// and occupancy fraction it is given by OutputType.
+template <typename T>
+void DecimateImageReduce (
+  const T* iptr,
+  const int idims[3],
+  void* optr,
+  const int odims[3],
+  const int f[3],
+  int mode)
+{
+  switch (mode)
+  {
+    case vtkboneDecimateImage::MAXIMUM:
+      DecimateImageForEachRow(iptr, idims, static_cast<T*>(optr), odims, f,
+                              DecimateImageMaximum<T>(idims[0], f[0]));
+      break;
+    case vtkboneDecimateImage::MAJORITY:
+      DecimateImageForEachRow(iptr, idims, static_cast<T*>(optr), odims, f,
+                              DecimateImageMajority<T>(idims[0], f[0]));
+      break;
+    case vtkboneDecimateImage::MEAN:
+      if (std::is_same<T,double>::value)
+      {
+        DecimateImageForEachRow(iptr, idims, static_cast<double*>(optr), odims, f,
+                                DecimateImageMean<T,double>(idims[0], f[0]));
+      }
+      else
+      {
+        DecimateImageForEachRow(iptr, idims, static_cast<float*>(optr), odims, f,
+                                DecimateImageMean<T,float>(idims[0], f[0]));
+      }
+      break;
+    case vtkboneDecimateImage::OCCUPANCY_FRACTION:
+      DecimateImageForEachRow(iptr, idims, static_cast<float*>(optr), odims, f,
+                              DecimateImageOccupancyFraction<T,float>(idims[0], f[0]));
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------
+int DecimateImageHelper::OutputType(int mode, int inputType)
+{
+  switch (mode)
+  {
+    case vtkboneDecimateImage::MEAN:
+      return (inputType == VTK_DOUBLE) ? VTK_DOUBLE : VTK_FLOAT;
+    case vtkboneDecimateImage::OCCUPANCY_FRACTION:
+      return VTK_FLOAT;
+    default:
+      return inputType;
+  }
+}
+
+//----------------------------------------------------------------------------
+void DecimateImageHelper::OutputInformation
+  (
+  bool onCells,
+  const int inExt[6],
+  const double inSpacing[3],
+  const double inOrigin[3],
+  const int f[3],
+  int outExt[6],
+  double outSpacing[3],
+  double outOrigin[3]
+  )
+{
+  for (int k = 0; k < 3; k++)
+  {
+    const int inDims = inExt[2*k+1] - inExt[2*k] + 1;
+    int outDims;
+    outSpacing[k] = inSpacing[k] * f[k];
+    if (onCells)
+    {
+      outOrigin[k] = inOrigin[k] + inExt[2*k]*inSpacing[k];
+      //  Round up to a multiple of the factor in cells (points-1), then add
+      //  one more point at boundary.
+      outDims = 1 + (inDims - 1 + f[k] - 1) / f[k];
+    }
+    else
+    {
+      // Center of the first block of points.
+      outOrigin[k] = inOrigin[k] + (inExt[2*k] + 0.5*(f[k] - 1)) * inSpacing[k];
+      outDims = (inDims + f[k] - 1) / f[k];  // Round up to a multiple of the factor
+    }
+    outExt[2*k] = 0;
+    outExt[2*k+1] = outDims - 1;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool DecimateImageHelper::Decimate
+  (
+  const void* iraw,
+  int dataType,
+  const int idims[3],
+  void* oraw,
+  const int odims[3],
+  const int f[3],
+  int mode
+  )
+{
+  switch (dataType)
+  {
+    case VTK_FLOAT:
+      DecimateImageReduce (static_cast<const float*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_DOUBLE:
+      DecimateImageReduce (static_cast<const double*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_CHAR:
+      DecimateImageReduce (static_cast<const char*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_SIGNED_CHAR:
+      DecimateImageReduce (static_cast<const signed char*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_UNSIGNED_CHAR:
+      DecimateImageReduce (static_cast<const unsigned char*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_SHORT:
+      DecimateImageReduce (static_cast<const short*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_UNSIGNED_SHORT:
+      DecimateImageReduce (static_cast<const unsigned short*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_INT:
+      DecimateImageReduce (static_cast<const int*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    case VTK_UNSIGNED_INT:
+      DecimateImageReduce (static_cast<const unsigned int*>(iraw), idims, oraw, odims, f, mode);
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,63 @@
+/*=========================================================================
+
+                                vtkbone
+
+  VTK classes for building and analyzing Numerics88 finite element models.
+
+  Copyright (c) 2010-2025, Numerics88 Solutions.
+  All rights reserved.
+
+=========================================================================*/
+
+#ifndef __DecimateImageHelper_h
+#define __DecimateImageHelper_h
+
+/** @namespace DecimateImageHelper
+
+  The block reduction kernels of vtkboneDecimateImage, shared with
+  vtkboneImagePyramid.  Modes are the ReductionMode_t values of
+  vtkboneDecimateImage.
+*/
+namespace DecimateImageHelper
+{
+
+  /** Returns the output scalar type of a reduction mode for an input
+      scalar type. */
+  int OutputType (int mode, int inputType);
+
+  /** Computes the output whole extent, spacing and origin of a decimation
+      by factors of an image with whole extent inExt, with the data either
+      on the cells or on the points.  The output extent starts at 0. */
+  void OutputInformation
+    (
+    bool onCells,
+    const int inExt[6],
+    const double inSpacing[3],
+    const double inOrigin[3],
+    const int factors[3],
+    int outExt[6],
+    double outSpacing[3],
+    double outOrigin[3]
+    );
+
+  /** Reduces each block of factors[0] x factors[1] x factors[2] values of
+      the idims volume in to one value of the odims volume out, which must
+      have the type given by OutputType.  Blocks truncated by the boundary
+      of the input are reduced over the values present.  Output slices are
+      computed in parallel.  odims[2] may be less than the full number of
+      output slices, to decimate a slab.  Returns false if the data type is
+      not supported. */
+  bool Decimate
+    (
+    const void* in,
+    int dataType,
+    const int idims[3],
+    void* out,
+    const int odims[3],
+    const int factors[3],
+    int mode
+    );
+
+}  // namespace DecimateImageHelper
+
+#endif
@@ -0,0 +1,186 @@
+/*=========================================================================
+
+                                vtkbone
+
+  VTK classes for building and analyzing Numerics88 finite element models.
+
+  Copyright (c) 2010-2025, Numerics88 Solutions.
+  All rights reserved.
+
+=========================================================================*/
+
+#ifndef __FileHeaderCache_h
+#define __FileHeaderCache_h
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/** @class FileHeaderCache
+
+  A thread-safe cache of parsed file headers, used by the image readers so
+  that each file header is parsed only once, however many times the
+  header is requested.
+
+  Entries are keyed on the file name, and are valid only as long as the
+  size, the modification time (to the resolution of the file system,
+  typically nanoseconds) and the identity (inode) of the file are
+  unchanged, so that a file rewritten or replaced immediately after being
+  read is parsed again.  THeader must be copyable.
+
+  At most a fixed number of headers are kept; when the cache is full, the
+  least recently used header is discarded.
+
+  This object is not itself a VTK object; each reader keeps one static
+  instance in its implementation.
+*/
+template <typename THeader>
+class FileHeaderCache
+{
+public:
+
+  /** Constructs a cache holding at most maxEntries headers. */
+  explicit FileHeaderCache (size_t maxEntries = 64)
+    : maxEntries (maxEntries > 0 ? maxEntries : 1)
+  {}
+
+  /** Sets header to the header of filename.  If there is no valid cached
+      header, calls read(filename, header) to parse it, and caches the
+      result if read returns true.  Returns the value returned by read, or
+      true if the header was cached.  Exceptions thrown by read are
+      propagated. */
+  template <typename TRead>
+  bool Read (const char* filename, THeader& header, TRead read)
+  {
+    const std::string key (filename);
+    Stamp stamp;
+    const bool stamped = GetStamp (key, stamp);
+    if (stamped)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+      typename EntryMap::iterator it = this->entries.find (key);
+      if (it != this->entries.end() && it->second.stamp == stamp)
+      {
+        this->order.splice (this->order.begin(), this->order, it->second.position);
+        header = it->second.header;
+        return true;
+      }
+    }
+    if (!read (filename, header))
+    {
+      return false;
+    }
+    if (stamped)
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+      typename EntryMap::iterator it = this->entries.find (key);
+      if (it != this->entries.end())
+      {
+        this->order.splice (this->order.begin(), this->order, it->second.position);
+      }
+      else
+      {
+        if (this->entries.size() >= this->maxEntries)
+        {
+          this->entries.erase (this->order.back());
+          this->order.pop_back();
+        }
+        this->order.push_front (key);
+        it = this->entries.insert (std::make_pair (key, Entry())).first;
+        it->second.position = this->order.begin();
+      }
+      it->second.stamp = stamp;
+      it->second.header = header;
+    }
+    return true;
+  }
+
+  /** Discards all cached headers. */
+  void Clear ()
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    this->entries.clear();
+    this->order.clear();
+  }
+
+  /** Returns the number of cached headers. */
+  size_t Size ()
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    return this->entries.size();
+  }
+
+protected:
+
+  struct Stamp
+  {
+    unsigned long long size;
+    long long mtime;        // seconds
+    long long mtime_nsec;
+    unsigned long long id;  // inode, or 0 if not available
+
+    bool operator== (const Stamp& other) const
+    {
+      return size == other.size && mtime == other.mtime &&
+             mtime_nsec == other.mtime_nsec && id == other.id;
+    }
+  };
+
+  struct Entry
+  {
+    Stamp stamp;
+    THeader header;
+    std::list<std::string>::iterator position;  // in order
+  };
+
+  typedef std::map<std::string, Entry> EntryMap;
+
+  static bool GetStamp (const std::string& filename, Stamp& stamp)
+  {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA (filename.c_str(), GetFileExInfoStandard, &data)) {
+      return false; }
+    stamp.size = (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) |
+                 data.nFileSizeLow;
+    // Last write time in units of 100 ns.
+    const unsigned long long t =
+        (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+        data.ftLastWriteTime.dwLowDateTime;
+    stamp.mtime = static_cast<long long>(t / 10000000);
+    stamp.mtime_nsec = static_cast<long long>(t % 10000000) * 100;
+    stamp.id = 0;
+#else
+    struct stat st;
+    if (stat (filename.c_str(), &st) != 0) {
+      return false; }
+    stamp.size = static_cast<unsigned long long>(st.st_size);
+    stamp.mtime = static_cast<long long>(st.st_mtime);
+#ifdef __APPLE__
+    stamp.mtime_nsec = static_cast<long long>(st.st_mtimespec.tv_nsec);
+#else
+    stamp.mtime_nsec = static_cast<long long>(st.st_mtim.tv_nsec);
+#endif
+    stamp.id = static_cast<unsigned long long>(st.st_ino);
+#endif
+    return true;
+  }
+
+  const size_t maxEntries;
+  std::mutex mutex;
+  EntryMap entries;
+  std::list<std::string> order;  // most recently used first
+};
+
+#endif
@@ -0,0 +1,486 @@
+/*=========================================================================
+
+                                vtkbone
+
+  VTK classes for building and analyzing Numerics88 finite element models.
+
+  Copyright (c) 2010-2025, Numerics88 Solutions.
+  All rights reserved.
+
+=========================================================================*/
+
+#include "ScancoFileHelper.h"
+#include "vtkByteSwap.h"
+#include "vtkSMPTools.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace ScancoFileHelper
+{
+
+//-----------------------------------------------------------------------
+// Regions of files currently mapped, keyed on the pointer returned by
+// MapFileRegion, so that they can be released given only that pointer.
+
+struct MappedRegion
+{
+  void* base;
+  size_t length;
+};
+
+static std::mutex mapped_regions_mutex;
+static std::map<void*, MappedRegion> mapped_regions;
+
+//-----------------------------------------------------------------------
+static unsigned long long ReadLittleEndian (const unsigned char* p, int n)
+{
+  unsigned long long x = 0;
+  for (int i=n-1; i>=0; --i) {
+    x = (x << 8) | p[i]; }
+  return x;
+}
+
+//-----------------------------------------------------------------------
+// Version 3.0 AIM files start with a version string and have 64 bit block
+// sizes; earlier versions have 32 bit block sizes.  The blocks are the
+// pre-header, the image structure, the processing log, the image data and
+// the associated data.
+static bool ReadAIMBlockSizes
+  (
+  std::ifstream& f,
+  unsigned long long& file_size,
+  unsigned long long* blocks
+  )
+{
+  f.seekg (0, std::ios::end);
+  file_size = static_cast<unsigned long long>(f.tellg());
+  f.seekg (0, std::ios::beg);
+  unsigned char pre_header[56];
+  f.read (reinterpret_cast<char*>(pre_header), sizeof(pre_header));
+  if (f.gcount() < 20) {
+    return false; }
+  if (f.gcount() == 56 &&
+      std::memcmp (pre_header, "AIMDATA_V030", 12) == 0)
+  {
+    for (int i=0; i<5; ++i) {
+      blocks[i] = ReadLittleEndian (pre_header + 16 + 8*i, 8); }
+  }
+  else
+  {
+    for (int i=0; i<5; ++i) {
+      blocks[i] = ReadLittleEndian (pre_header + 4*i, 4); }
+  }
+  f.clear();
+  return true;
+}
+
+//-----------------------------------------------------------------------
+bool FindAIMDataBlock
+  (
+  const char* filename,
+  unsigned long long& offset,
+  unsigned long long& size
+  )
+{
+  std::ifstream f (filename, std::ios::in | std::ios::binary);
+  if (!f) {
+    return false; }
+  unsigned long long file_size;
+  unsigned long long blocks[5];
+  if (!ReadAIMBlockSizes (f, file_size, blocks)) {
+    return false; }
+  offset = blocks[0] + blocks[1] + blocks[2];
+  size = blocks[3];
+  return (offset <= file_size && size <= file_size - offset);
+}
+
+//-----------------------------------------------------------------------
+// In both versions the image structure starts with the version, the
+// processing log and data pointers, the id and the reference, which take
+// 20 bytes, followed by the 32 bit type code.
+bool ReadAIMTypeCode
+  (
+  const char* filename,
+  int& typeCode
+  )
+{
+  std::ifstream f (filename, std::ios::in | std::ios::binary);
+  if (!f) {
+    return false; }
+  unsigned long long file_size;
+  unsigned long long blocks[5];
+  if (!ReadAIMBlockSizes (f, file_size, blocks) ||
+      blocks[1] < 24 || blocks[0] + 24 > file_size) {
+    return false; }
+  unsigned char code[4];
+  f.seekg (blocks[0] + 20, std::ios::beg);
+  f.read (reinterpret_cast<char*>(code), sizeof(code));
+  if (f.gcount() != 4) {
+    return false; }
+  typeCode = int(ReadLittleEndian (code, 4));
+  return true;
+}
+
+//-----------------------------------------------------------------------
+// The ISQ header is followed by data_offset further 512 byte blocks before
+// the image data.
+bool FindISQDataBlock
+  (
+  const char* filename,
+  unsigned long long& offset
+  )
+{
+  std::ifstream f (filename, std::ios::in | std::ios::binary);
+  if (!f) {
+    return false; }
+  unsigned char header[512];
+  f.read (reinterpret_cast<char*>(header), sizeof(header));
+  if (f.gcount() != 512) {
+    return false; }
+  offset = (ReadLittleEndian (header + 508, 4) + 1) * 512;
+  return true;
+}
+
+//-----------------------------------------------------------------------
+void* MapFileRegion
+  (
+  const char* filename,
+  unsigned long long offset,
+  size_t length
+  )
+{
+  void* base = NULL;
+  unsigned long long aligned_offset;
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo (&info);
+  aligned_offset = offset - offset % info.dwAllocationGranularity;
+  size_t mapped_length = length + size_t(offset - aligned_offset);
+  HANDLE file = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL; }
+  HANDLE mapping = CreateFileMappingA (file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle (file);
+  if (mapping == NULL) {
+    return NULL; }
+  base = MapViewOfFile (mapping, FILE_MAP_COPY,
+                        DWORD(aligned_offset >> 32),
+                        DWORD(aligned_offset & 0xFFFFFFFF),
+                        mapped_length);
+  // The view keeps the mapping alive.
+  CloseHandle (mapping);
+  if (base == NULL) {
+    return NULL; }
+#else
+  long page_size = sysconf (_SC_PAGESIZE);
+  aligned_offset = offset - offset % page_size;
+  size_t mapped_length = length + size_t(offset - aligned_offset);
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL; }
+  base = mmap (NULL, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+               fd, off_t(aligned_offset));
+  // The mapping keeps the file alive.
+  close (fd);
+  if (base == MAP_FAILED) {
+    return NULL; }
+#endif
+  void* data = static_cast<char*>(base) + (offset - aligned_offset);
+  MappedRegion region;
+  region.base = base;
+  region.length = mapped_length;
+  std::lock_guard<std::mutex> lock (mapped_regions_mutex);
+  mapped_regions[data] = region;
+  return data;
+}
+
+//-----------------------------------------------------------------------
+void* CreateScratchRegion (size_t length)
+{
+  if (length == 0) {
+    return NULL; }
+  void* base = NULL;
+#ifdef _WIN32
+  unsigned long long size = length;
+  HANDLE mapping = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                       DWORD(size >> 32), DWORD(size & 0xFFFFFFFF),
+                                       NULL);
+  if (mapping == NULL) {
+    return NULL; }
+  base = MapViewOfFile (mapping, FILE_MAP_ALL_ACCESS, 0, 0, length);
+  // The view keeps the mapping alive.
+  CloseHandle (mapping);
+  if (base == NULL) {
+    return NULL; }
+#else
+  // tmpfile is removed when closed, but the mapping keeps it alive.
+  FILE* file = tmpfile();
+  if (file == NULL) {
+    return NULL; }
+  int fd = fileno (file);
+  if (ftruncate (fd, off_t(length)) != 0)
+  {
+    fclose (file);
+    return NULL;
+  }
+  base = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  fclose (file);
+  if (base == MAP_FAILED) {
+    return NULL; }
+#endif
+  MappedRegion region;
+  region.base = base;
+  region.length = length;
+  std::lock_guard<std::mutex> lock (mapped_regions_mutex);
+  mapped_regions[base] = region;
+  return base;
+}
+
+//-----------------------------------------------------------------------
+void UnmapFileRegion (void* data)
+{
+  MappedRegion region;
+  {
+    std::lock_guard<std::mutex> lock (mapped_regions_mutex);
+    std::map<void*, MappedRegion>::iterator it = mapped_regions.find (data);
+    if (it == mapped_regions.end()) {
+      return; }
+    region = it->second;
+    mapped_regions.erase (it);
+  }
+#ifdef _WIN32
+  UnmapViewOfFile (region.base);
+#else
+  munmap (region.base, region.length);
+#endif
+}
+
+//-----------------------------------------------------------------------
+bool ReadRawSubVolume
+  (
+  const char* filename,
+  unsigned long long offset,
+  int elementSize,
+  const int* dims,
+  const int* voxelExtent,
+  void* out
+  )
+{
+  std::ifstream f (filename, std::ios::in | std::ios::binary);
+  if (!f) {
+    return false; }
+  const size_t nx = voxelExtent[1] - voxelExtent[0] + 1;
+  const size_t ny = voxelExtent[3] - voxelExtent[2] + 1;
+  const size_t nz = voxelExtent[5] - voxelExtent[4] + 1;
+  const size_t row_bytes = nx * elementSize;
+  char* p = static_cast<char*>(out);
+  // Whole rows of a slice are contiguous in the file, and can be read at once.
+  const bool whole_rows = (int(nx) == dims[0]);
+  for (int k=voxelExtent[4]; k<=voxelExtent[5]; ++k)
+  {
+    for (int j=voxelExtent[2]; j<=voxelExtent[3]; ++j)
+    {
+      unsigned long long position = offset +
+          ((static_cast<unsigned long long>(k)*dims[1] + j)*dims[0]
+           + voxelExtent[0]) * elementSize;
+      f.seekg (position, std::ios::beg);
+      if (whole_rows)
+      {
+        f.read (p, row_bytes * ny);
+        p += row_bytes * ny;
+        break;
+      }
+      f.read (p, row_bytes);
+      p += row_bytes;
+    }
+    if (!f) {
+      return false; }
+  }
+  const size_t n = nx * ny * nz;
+  if (elementSize == 2) {
+    vtkByteSwap::Swap2LERange (out, n); }
+  else if (elementSize == 4) {
+    vtkByteSwap::Swap4LERange (out, n); }
+  return true;
+}
+
+//-----------------------------------------------------------------------
+bool ReadFileRegion
+  (
+  const char* filename,
+  unsigned long long offset,
+  size_t size,
+  void* out
+  )
+{
+  std::ifstream f (filename, std::ios::in | std::ios::binary);
+  if (!f) {
+    return false; }
+  f.seekg (offset, std::ios::beg);
+  f.read (static_cast<char*>(out), size);
+  return (f && size_t(f.gcount()) == size);
+}
+
+//-----------------------------------------------------------------------
+// Run-length decoding.  A chunk starts at a run boundary, at input
+// position in, output position out, and (for binary images) with the
+// value index flip.
+
+struct RunLengthChunk
+{
+  size_t in;
+  size_t out;
+  int flip;
+};
+
+// Output voxels per chunk: large enough that indexing is negligible, small
+// enough to balance the load.
+static const size_t run_length_chunk_size = 1 << 20;
+
+static bool IndexBinaryRunLength
+  (
+  const unsigned char* data,
+  size_t size,
+  size_t n,
+  std::vector<RunLengthChunk>& chunks
+  )
+{
+  chunks.clear();
+  if (size < 6) {
+    return false; }
+  size_t in = 6;
+  size_t out = 0;
+  size_t next_chunk = 0;
+  int flip = 0;
+  while (in < size && out < n)
+  {
+    if (out >= next_chunk)
+    {
+      RunLengthChunk chunk = {in, out, flip};
+      chunks.push_back (chunk);
+      next_chunk = out + run_length_chunk_size;
+    }
+    const unsigned char count = data[in++];
+    out += count;
+    if (count != 255) {
+      flip ^= 1; }
+  }
+  return (in == size && out == n);
+}
+
+static bool IndexCharRunLength
+  (
+  const unsigned char* data,
+  size_t size,
+  size_t n,
+  std::vector<RunLengthChunk>& chunks
+  )
+{
+  chunks.clear();
+  if (size < 4 || (size - 4) % 2 != 0) {
+    return false; }
+  size_t in = 4;
+  size_t out = 0;
+  size_t next_chunk = 0;
+  while (in < size && out < n)
+  {
+    if (out >= next_chunk)
+    {
+      RunLengthChunk chunk = {in, out, 0};
+      chunks.push_back (chunk);
+      next_chunk = out + run_length_chunk_size;
+    }
+    out += data[in];
+    in += 2;
+  }
+  return (in == size && out == n);
+}
+
+bool DecodeAIMRunLength
+  (
+  const unsigned char* data,
+  size_t size,
+  int typeCode,
+  char* out,
+  size_t n,
+  int numberOfThreads
+  )
+{
+  std::vector<RunLengthChunk> chunks;
+  const bool is_binary = (typeCode == AIM_TYPE_BINARY_RUN_LENGTH);
+  if (is_binary)
+  {
+    if (!IndexBinaryRunLength (data, size, n, chunks)) {
+      return false; }
+  }
+  else if (typeCode == AIM_TYPE_CHAR_RUN_LENGTH)
+  {
+    if (!IndexCharRunLength (data, size, n, chunks)) {
+      return false; }
+  }
+  else
+  {
+    return false;
+  }
+  const vtkIdType number_of_chunks = vtkIdType(chunks.size());
+
+  auto decode = [&]()
+  {
+    vtkSMPTools::For (0, number_of_chunks,
+      [&](vtkIdType first, vtkIdType last)
+      {
+        for (vtkIdType c=first; c<last; ++c)
+        {
+          const size_t in_end = (c+1 < number_of_chunks) ? chunks[c+1].in : size;
+          size_t in = chunks[c].in;
+          char* p = out + chunks[c].out;
+          if (is_binary)
+          {
+            const char values[2] = {char(data[4]), char(data[5])};
+            int flip = chunks[c].flip;
+            for (; in < in_end; ++in)
+            {
+              const unsigned char count = data[in];
+              std::memset (p, values[flip], count);
+              p += count;
+              if (count != 255) {
+                flip ^= 1; }
+            }
+          }
+          else
+          {
+            for (; in < in_end; in += 2)
+            {
+              const unsigned char count = data[in];
+              std::memset (p, data[in+1], count);
+              p += count;
+            }
+          }
+        }
+      });
+  };
+  if (numberOfThreads > 0) {
+    vtkSMPTools::LocalScope (vtkSMPTools::Config (numberOfThreads), decode); }
+  else {
+    decode(); }
+  return true;
+}
+
+}  // namespace ScancoFileHelper
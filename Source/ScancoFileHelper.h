@@ -0,0 +1,154 @@
+/*=========================================================================
+
+                                vtkbone
+
+  VTK classes for building and analyzing Numerics88 finite element models.
+
+  Copyright (c) 2010-2025, Numerics88 Solutions.
+  All rights reserved.
+
+=========================================================================*/
+
+#ifndef __ScancoFileHelper_h
+#define __ScancoFileHelper_h
+
+#include <cstddef>
+
+/** @namespace ScancoFileHelper
+
+  Low-level access to the image data of Scanco AIM and ISQ files.
+
+  These functions are used by vtkboneAIMReader and vtkboneISQReader for
+  the cases that AimIO does not cover: memory-mapping the data, and reading
+  only part of the volume.  They apply only to uncompressed data, which is
+  stored little-endian in x-fastest order following the headers.  Headers
+  are otherwise parsed by AimIO.
+*/
+namespace ScancoFileHelper
+{
+
+  /** Locates the image data block of an AIM file from the block list in
+      its pre-header.  Returns false if the file cannot be read or the block
+      list is inconsistent with the file size. */
+  bool FindAIMDataBlock
+    (
+    const char* filename,
+    unsigned long long& offset,
+    unsigned long long& size
+    );
+
+  /** Scanco type codes of the run-length compressed encodings of AIM
+      char data: binary images (D1TbinCmp) and char images (D1TcharCmp). */
+  const int AIM_TYPE_BINARY_RUN_LENGTH = 0x00150001;
+  const int AIM_TYPE_CHAR_RUN_LENGTH = 0x00080002;
+
+  /** Reads the type code from the image structure of an AIM file.  Returns
+      false if the file cannot be read. */
+  bool ReadAIMTypeCode
+    (
+    const char* filename,
+    int& typeCode
+    );
+
+  /** Locates the image data of an ISQ file from the data offset field of
+      its header.  Returns false if the file cannot be read. */
+  bool FindISQDataBlock
+    (
+    const char* filename,
+    unsigned long long& offset
+    );
+
+  /** Maps length bytes of filename starting at offset, copy-on-write.
+      Returns a pointer to the byte at offset, or NULL on failure.  The
+      region must be released with UnmapFileRegion. */
+  void* MapFileRegion
+    (
+    const char* filename,
+    unsigned long long offset,
+    size_t length
+    );
+
+  /** Creates a zero-filled, writable scratch region of length bytes backed
+      by an anonymous temporary file (or the paging file on Windows), so
+      that it can be larger than the available memory.  Returns NULL on
+      failure.  The region must be released with UnmapFileRegion. */
+  void* CreateScratchRegion (size_t length);
+
+  /** Releases a region created by MapFileRegion or CreateScratchRegion,
+      given the pointer returned.  Suitable as a vtkAbstractArray free
+      function. */
+  void UnmapFileRegion (void* data);
+
+  /** Reads the voxels voxelExtent (inclusive, in x,x,y,y,z,z order) of
+      raw little-endian data of a volume of size dims, starting at offset.
+      Only the required rows are read.  out must have room for the
+      sub-volume, which is stored x-fastest.  Returns false on read error. */
+  bool ReadRawSubVolume
+    (
+    const char* filename,
+    unsigned long long offset,
+    int elementSize,
+    const int* dims,
+    const int* voxelExtent,
+    void* out
+    );
+
+  /** Reads size bytes of filename starting at offset into out.  Returns
+      false on read error. */
+  bool ReadFileRegion
+    (
+    const char* filename,
+    unsigned long long offset,
+    size_t size,
+    void* out
+    );
+
+  /** Decodes the run-length compressed char encodings of AIM files into n
+      voxels.  The encoding is given by typeCode, the type code of the AIM
+      header.  For AIM_TYPE_BINARY_RUN_LENGTH (binary images) there is a 6
+      byte header holding the two voxel values followed by run lengths of
+      alternating values (a run of 255 continues with the same value); for
+      AIM_TYPE_CHAR_RUN_LENGTH (char images) there is a 4 byte header
+      followed by (count,value) pairs.  A first pass indexes the stream
+      into chunks starting on run boundaries; the chunks are then decoded
+      concurrently, using up to numberOfThreads threads (0 for the
+      default).  Returns false, leaving the contents of out undefined, if
+      typeCode is not one of these encodings, or data is not a valid stream
+      of that encoding that decodes to exactly n voxels. */
+  bool DecodeAIMRunLength
+    (
+    const unsigned char* data,
+    size_t size,
+    int typeCode,
+    char* out,
+    size_t n,
+    int numberOfThreads
+    );
+
+  /** Copies the voxels voxelExtent out of a volume of size dims held in
+      memory. */
+  template <typename T>
+  void CopySubVolume
+    (
+    const T* in,
+    const int* dims,
+    const int* voxelExtent,
+    T* out
+    )
+  {
+    for (int k=voxelExtent[4]; k<=voxelExtent[5]; ++k)
+    {
+      for (int j=voxelExtent[2]; j<=voxelExtent[3]; ++j)
+      {
+        const T* row = in + ((size_t(k)*dims[1] + j)*dims[0]);
+        for (int i=voxelExtent[0]; i<=voxelExtent[1]; ++i)
+        {
+          *out++ = row[i];
+        }
+      }
+    }
+  }
+
+}  // namespace ScancoFileHelper
+
+#endif
@@ -9,19 +9,210 @@
 #include "vtkInformationVector.h"
 #include "vtkInformation.h"
 #include "vtkInformationIntegerKey.h"
+#include "vtkInformationIntegerVectorKey.h"
+#include "vtkInformationDoubleVectorKey.h"
+#include "vtkInformationStringKey.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkSmartPointer.h"
 #include "AimIO/AimIO.h"
+#include "FileHeaderCache.h"
+#include "ScancoFileHelper.h"
 #include <cassert>
+#include <string>
+#include <vector>
 
+using namespace ScancoFileHelper;
+
+namespace AIMReader_Utility
+{
+
+// The header information used by the reader.
+struct AIMHeader
+{
+  int dimensions[3];
+  int position[3];
+  double element_size[3];
+  std::string processing_log;
+  int scalar_type;   // -1 if not a supported AIM type.
+  int type_code;     // Scanco type code, or -1 if unknown.
+  bool data_found;   // Whether the image data block could be located.
+  unsigned long long data_offset;
+  unsigned long long data_size;
+};
+
+// Parses the header of filename.  Throws on error.
+bool parse_header (const char* filename, AIMHeader& header)
+{
+  AimIO::AimFile reader;
+  reader.filename = filename;
+  reader.ReadImageInfo();
+  for (int i=0; i<3; ++i)
+  {
+    header.dimensions[i] = reader.dimensions[i];
+    header.position[i] = reader.position[i];
+    header.element_size[i] = reader.element_size[i];
+  }
+  header.processing_log = reader.processing_log;
+  switch (reader.buffer_type)
+  {
+    case AimIO::AimFile::AIMFILE_TYPE_CHAR:
+      header.scalar_type = VTK_SIGNED_CHAR;
+      break;
+    case AimIO::AimFile::AIMFILE_TYPE_SHORT:
+      header.scalar_type = VTK_SHORT;
+      break;
+    case AimIO::AimFile::AIMFILE_TYPE_FLOAT:
+      header.scalar_type = VTK_FLOAT;
+      break;
+    default:
+      header.scalar_type = -1;
+  }
+  if (!ReadAIMTypeCode (filename, header.type_code)) {
+    header.type_code = -1; }
+  header.data_found = FindAIMDataBlock (filename, header.data_offset, header.data_size);
+  return true;
+}
+
+FileHeaderCache<AIMHeader> header_cache;
+
+// Returns the header of filename, parsing the file only if required.
+// Throws on error.
+bool read_header (const char* filename, AIMHeader& header)
+{
+  return header_cache.Read (filename, header, parse_header);
+}
+
+// Wraps the image data of an uncompressed AIM file in array without
+// copying.  Returns false if the file is compressed or cannot be mapped,
+// in which case array is not modified.
+template <typename TArray>
+bool map_image_data (TArray* array, const char* filename,
+                     const AIMHeader& header, vtkIdType N)
+{
+  typedef typename TArray::ValueType T;
+  // The data are stored little-endian.
+  const unsigned short one = 1;
+  if (*reinterpret_cast<const unsigned char*>(&one) != 1) {
+    return false; }
+  if (N == 0 || !header.data_found) {
+    return false; }
+  const unsigned long long offset = header.data_offset;
+  const unsigned long long size = header.data_size;
+  // Any other size indicates a compressed encoding.
+  if (size != (unsigned long long)(N) * sizeof(T) || offset % sizeof(T) != 0) {
+    return false; }
+  void* data = MapFileRegion (filename, offset, size_t(size));
+  if (data == NULL) {
+    return false; }
+  array->SetNumberOfComponents (1);
+  array->SetArray (static_cast<T*>(data), N, 0, TArray::VTK_DATA_ARRAY_USER_DEFINED);
+  array->SetArrayFreeFunction (UnmapFileRegion);
+  return true;
+}
+
+// Reads the voxels voxelExtent of the image into array.  The whole image
+// is memory-mapped if requested and possible.  Uncompressed data are read
+// directly, row by row for sub-volumes, using the data block located when
+// the header was parsed.  Run-length compressed char data is decoded in
+// parallel if runLength is true, according to the type code of header.
+// Otherwise the image is decoded by AimIO (and cropped if required); only
+// in this case is the header parsed again.  rawAccess must be false if the
+// data in the file may need conversion.  Throws on AimIO read errors.
+template <typename TArray, typename TAim>
+bool read_image_data
+  (
+  const char* filename,
+  const AIMHeader& header,
+  const int* voxelExtent,
+  bool memoryMapping,
+  bool rawAccess,
+  bool runLength,
+  int numberOfThreads,
+  TArray* array,
+  int& mapped
+  )
+{
+  typedef typename TArray::ValueType T;
+  const int* dims = header.dimensions;
+  const vtkIdType N = vtkIdType(dims[0])*vtkIdType(dims[1])*vtkIdType(dims[2]);
+  const vtkIdType n = vtkIdType(voxelExtent[1] - voxelExtent[0] + 1) *
+                      vtkIdType(voxelExtent[3] - voxelExtent[2] + 1) *
+                      vtkIdType(voxelExtent[5] - voxelExtent[4] + 1);
+  const bool whole = (n == N);
+  const bool runLengthType = (header.type_code == AIM_TYPE_BINARY_RUN_LENGTH ||
+                              header.type_code == AIM_TYPE_CHAR_RUN_LENGTH);
+  mapped = 0;
+  if (whole && memoryMapping && rawAccess && !runLengthType &&
+      map_image_data (array, filename, header, N))
+  {
+    mapped = 1;
+    return true;
+  }
+  array->SetNumberOfComponents (1);
+  array->SetNumberOfValues (n);
+  if (n == 0) {
+    return true; }
+  const unsigned long long offset = header.data_offset;
+  const unsigned long long size = header.data_size;
+  const bool found = (rawAccess || runLength) && header.data_found;
+  const bool compressed = found && (runLengthType ||
+                                    size != (unsigned long long)(N) * sizeof(T));
+  if (found && rawAccess && !compressed)
+  {
+    return ReadRawSubVolume (filename, offset, sizeof(T), dims, voxelExtent,
+                             array->GetPointer(0));
+  }
+  std::vector<T> image;
+  T* image_data = array->GetPointer(0);
+  if (!whole)
+  {
+    image.resize (N);
+    image_data = image.data();
+  }
+  bool decoded = false;
+  if (found && runLength && compressed)
+  {
+    std::vector<unsigned char> stream (size);
+    decoded = ReadFileRegion (filename, offset, size, stream.data()) &&
+              DecodeAIMRunLength (stream.data(), size, header.type_code,
+                                  reinterpret_cast<char*>(image_data),
+                                  N, numberOfThreads);
+  }
+  if (!decoded)
+  {
+    AimIO::AimFile reader;
+    reader.filename = filename;
+    reader.ReadImageInfo();
+    reader.ReadImageData (reinterpret_cast<TAim*>(image_data), N);
+  }
+  if (!whole)
+  {
+    CopySubVolume (image_data, dims, voxelExtent, array->GetPointer(0));
+  }
+  return true;
+}
+
+}  // namespace AIMReader_Utility
+
+using namespace AIMReader_Utility;
 
 vtkStandardNewMacro (vtkboneAIMReader);
 
+vtkInformationKeyMacro (vtkboneAIMReader, DIMENSION, IntegerVector);
+vtkInformationKeyMacro (vtkboneAIMReader, POSITION, IntegerVector);
+vtkInformationKeyMacro (vtkboneAIMReader, ELEMENT_SIZE, DoubleVector);
+vtkInformationKeyMacro (vtkboneAIMReader, PROCESSING_LOG, String);
+vtkInformationKeyMacro (vtkboneAIMReader, SCALAR_TYPE, Integer);
+
 //-----------------------------------------------------------------------
 vtkboneAIMReader::vtkboneAIMReader()
 {
   this->FileName = NULL;
   this->DataOnCells = -1;  // -1 indictates user has not set it yet.
+  this->MemoryMapping = 0;
+  this->DataIsMemoryMapped = 0;
+  this->ParallelRunLengthDecoding = 0;
+  this->NumberOfThreads = 0;
   this->ProcessingLog = NULL;
   this->Error = 0;
   this->ElementSize[0] = 0.01;
@@ -48,6 +239,11 @@ void vtkboneAIMReader::PrintSelf(ostream& os, vtkIndent indent)
      << (this->FileName ? this->FileName : "(none)") << "\n";
   os << indent << "ProcessingLog: "
      << (this->ProcessingLog ? this->ProcessingLog : "(none)") << "\n";
+  os << indent << "MemoryMapping: " << this->MemoryMapping << "\n";
+  os << indent << "DataIsMemoryMapped: " << this->DataIsMemoryMapped << "\n";
+  os << indent << "ParallelRunLengthDecoding: "
+     << this->ParallelRunLengthDecoding << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
   os << indent << "Error: " << this->Error << "\n";
   os << indent << "ElementSize: " << this->ElementSize[0] << ","
      << this->ElementSize[1] << ","
@@ -70,12 +266,10 @@ int vtkboneAIMReader::RequestInformation (
     return 0;
   }
 
-  AimIO::AimFile reader;
-
-  reader.filename = this->FileName;
+  AIMHeader header;
   try
   {
-    reader.ReadImageInfo();
+    read_header (this->FileName, header);
   }
   catch (const std::exception& e)
   {
@@ -83,17 +277,14 @@ int vtkboneAIMReader::RequestInformation (
     return 0;
   }
 
-  SetProcessingLog (reader.processing_log.c_str());
+  SetProcessingLog (header.processing_log.c_str());
 
-  this->ElementSize[0] = reader.element_size[0];
-  this->ElementSize[1] = reader.element_size[1];
-  this->ElementSize[2] = reader.element_size[2];
-  this->Dimension[0] = reader.dimensions[0];
-  this->Dimension[1] = reader.dimensions[1];
-  this->Dimension[2] = reader.dimensions[2];
-  this->Position[0] = reader.position[0];
-  this->Position[1] = reader.position[1];
-  this->Position[2] = reader.position[2];
+  for (int i=0; i<3; ++i)
+  {
+    this->ElementSize[i] = header.element_size[i];
+    this->Dimension[i] = header.dimensions[i];
+    this->Position[i] = header.position[i];
+  }
 
   if (DataOnCells == -1)
   {
@@ -109,47 +300,37 @@ int vtkboneAIMReader::RequestInformation (
   // This is so that rendering will be in consistent frames.
 
   double spacing[3];
-  spacing[0] = reader.element_size[0];
-  spacing[1] = reader.element_size[1];
-  spacing[2] = reader.element_size[2];
+  spacing[0] = header.element_size[0];
+  spacing[1] = header.element_size[1];
+  spacing[2] = header.element_size[2];
 
   int extent[6];
   double origin[3];
   if (DataOnCells == 0)  // on Points
   {
-    extent[0] = 0;   extent[1] = reader.dimensions[0] - 1;
-    extent[2] = 0;   extent[3] = reader.dimensions[1] - 1;
-    extent[4] = 0;   extent[5] = reader.dimensions[2] - 1;
+    extent[0] = 0;   extent[1] = header.dimensions[0] - 1;
+    extent[2] = 0;   extent[3] = header.dimensions[1] - 1;
+    extent[4] = 0;   extent[5] = header.dimensions[2] - 1;
 
-    origin[0] = (reader.position[0] + 0.5) * reader.element_size[0];
-    origin[1] = (reader.position[1] + 0.5) * reader.element_size[1];
-    origin[2] = (reader.position[2] + 0.5) * reader.element_size[2];
+    origin[0] = (header.position[0] + 0.5) * header.element_size[0];
+    origin[1] = (header.position[1] + 0.5) * header.element_size[1];
+    origin[2] = (header.position[2] + 0.5) * header.element_size[2];
   }
   else // on Cells
   {
-    extent[0] = 0;   extent[1] = reader.dimensions[0];
-    extent[2] = 0;   extent[3] = reader.dimensions[1];
-    extent[4] = 0;   extent[5] = reader.dimensions[2];
+    extent[0] = 0;   extent[1] = header.dimensions[0];
+    extent[2] = 0;   extent[3] = header.dimensions[1];
+    extent[4] = 0;   extent[5] = header.dimensions[2];
 
-    origin[0] = reader.position[0] * reader.element_size[0];
-    origin[1] = reader.position[1] * reader.element_size[1];
-    origin[2] = reader.position[2] * reader.element_size[2];
+    origin[0] = header.position[0] * header.element_size[0];
+    origin[1] = header.position[1] * header.element_size[1];
+    origin[2] = header.position[2] * header.element_size[2];
   }
 
-  int scalarType;
-  switch (reader.buffer_type)
+  int scalarType = header.scalar_type;
+  if (scalarType == -1)
   {
-    case AimIO::AimFile::AIMFILE_TYPE_CHAR:
-      scalarType = VTK_SIGNED_CHAR;
-      break;
-    case AimIO::AimFile::AIMFILE_TYPE_SHORT:
-      scalarType = VTK_SHORT;
-      break;
-    case AimIO::AimFile::AIMFILE_TYPE_FLOAT:
-      scalarType = VTK_FLOAT;
-      break;
-    default:
-      vtkErrorMacro(<< "Unknown AIM data type.");
+    vtkErrorMacro(<< "Unknown AIM data type.");
   }
 
   // get the info objects
@@ -168,6 +349,7 @@ int vtkboneAIMReader::RequestInformation (
   outInfo->Set (vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
   outInfo->Set (vtkDataObject::SPACING(), spacing, 3);
   outInfo->Set (vtkDataObject::ORIGIN(), origin, 3);
+  outInfo->Set (vtkAlgorithm::CAN_PRODUCE_SUB_EXTENT(), 1);
 
   return 1;
 }
@@ -178,16 +360,17 @@ int vtkboneAIMReader::RequestData (vtkInformation*,
                                   vtkInformationVector* outputVector)
 {
   this->Error = 1;
+  this->DataIsMemoryMapped = 0;
   this->UpdateProgress(0.1);
 
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
   vtkImageData* out = vtkImageData::GetData (outputVector);
 
-  AimIO::AimFile reader;
-  reader.filename = this->FileName;
+  // The header is normally cached from RequestInformation.
+  AIMHeader header;
   try
   {
-    reader.ReadImageInfo();
+    read_header (this->FileName, header);
   }
   catch (const std::exception& e)
   {
@@ -197,22 +380,20 @@ int vtkboneAIMReader::RequestData (vtkInformation*,
 
   this->UpdateProgress(.70);
 
-  vtkIdType N = long_product (reader.dimensions);
-
+  // Only the requested extent is read.
   int extent[6];
-  if (DataOnCells == 0)  // on Points
-  {
-    extent[0] = 0;   extent[1] = reader.dimensions[0] - 1;
-    extent[2] = 0;   extent[3] = reader.dimensions[1] - 1;
-    extent[4] = 0;   extent[5] = reader.dimensions[2] - 1;
-  }
-  else // on Cells
+  outInfo->Get (vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent);
+  out->SetExtent(extent);
+
+  int voxelExtent[6];
+  for (int i=0; i<3; ++i)
   {
-    extent[0] = 0;   extent[1] = reader.dimensions[0];
-    extent[2] = 0;   extent[3] = reader.dimensions[1];
-    extent[4] = 0;   extent[5] = reader.dimensions[2];
+    voxelExtent[2*i] = extent[2*i];
+    voxelExtent[2*i+1] = (DataOnCells == 0) ? extent[2*i+1] : extent[2*i+1] - 1;
   }
-  out->SetExtent(extent);
+  vtkIdType N = vtkIdType(voxelExtent[1] - voxelExtent[0] + 1) *
+                vtkIdType(voxelExtent[3] - voxelExtent[2] + 1) *
+                vtkIdType(voxelExtent[5] - voxelExtent[4] + 1);
 
   vtkSmartPointer<vtkDataArray> dataArray;
 
@@ -230,66 +411,58 @@ int vtkboneAIMReader::RequestData (vtkInformation*,
   }
   int scalarType = attrInfo->Get( vtkDataObject::FIELD_ARRAY_TYPE() );
 
-  switch( scalarType )
+  bool ok = false;
+  try
   {
-
-    case VTK_SIGNED_CHAR:
+    switch( scalarType )
     {
-      vtkSmartPointer<vtkSignedCharArray> carray = vtkSmartPointer<vtkSignedCharArray>::New();
-      carray->SetNumberOfComponents(1);
-      carray->SetNumberOfValues(N);
-      try
-      {
-        reader.ReadImageData((char*)(carray->WriteVoidPointer(0,N)), N);
-      }
-      catch (const std::exception& e)
-      {
-        vtkErrorMacro(<< "Error reading " << this->FileName);
-        return 0;
-      }
-      dataArray = carray;
-      break;
-    }
 
-    case VTK_SHORT:
-    {
-      vtkSmartPointer<vtkShortArray> sarray = vtkSmartPointer<vtkShortArray>::New();
-      sarray->SetNumberOfComponents(1);
-      sarray->SetNumberOfValues(N);
-      try
+      case VTK_SIGNED_CHAR:
       {
-        reader.ReadImageData((short*)(sarray->WriteVoidPointer(0,N)), N);
+        vtkSmartPointer<vtkSignedCharArray> carray = vtkSmartPointer<vtkSignedCharArray>::New();
+        ok = read_image_data<vtkSignedCharArray, char> (this->FileName, header, voxelExtent,
+                  this->MemoryMapping != 0, true,
+                  this->ParallelRunLengthDecoding != 0, this->NumberOfThreads,
+                  carray, this->DataIsMemoryMapped);
+        dataArray = carray;
+        break;
       }
-      catch (const std::exception& e)
+
+      case VTK_SHORT:
       {
-        vtkErrorMacro(<< "Error reading " << this->FileName);
-        return 0;
+        vtkSmartPointer<vtkShortArray> sarray = vtkSmartPointer<vtkShortArray>::New();
+        ok = read_image_data<vtkShortArray, short> (this->FileName, header, voxelExtent,
+                  this->MemoryMapping != 0, true, false, this->NumberOfThreads,
+                  sarray, this->DataIsMemoryMapped);
+        dataArray = sarray;
+        break;
       }
-      dataArray = sarray;
-      break;
-    }
 
-    case VTK_FLOAT:
-    {
-      vtkSmartPointer<vtkFloatArray> farray = vtkSmartPointer<vtkFloatArray>::New();
-      farray->SetNumberOfComponents(1);
-      farray->SetNumberOfValues(N);
-      try
+      case VTK_FLOAT:
       {
-        reader.ReadImageData((float*)(farray->WriteVoidPointer(0,N)), N);
+        // Float data is never accessed directly, since it may need
+        // conversion from VAX format.
+        vtkSmartPointer<vtkFloatArray> farray = vtkSmartPointer<vtkFloatArray>::New();
+        ok = read_image_data<vtkFloatArray, float> (this->FileName, header, voxelExtent,
+                  false, false, false, this->NumberOfThreads,
+                  farray, this->DataIsMemoryMapped);
+        dataArray = farray;
+        break;
       }
-      catch (const std::exception& e)
-      {
-        vtkErrorMacro(<< "Error reading " << this->FileName);
+
+      default:
+        vtkErrorMacro(<< "Unknown AIM data type.");
         return 0;
-      }
-      dataArray = farray;
-      break;
     }
-
-    default:
-      vtkErrorMacro(<< "Unknown AIM data type.");
-      return 0;
+  }
+  catch (const std::exception& e)
+  {
+    ok = false;
+  }
+  if (!ok)
+  {
+    vtkErrorMacro(<< "Error reading " << this->FileName);
+    return 0;
   }
   this->UpdateProgress(.90);
 
@@ -310,3 +483,33 @@ int vtkboneAIMReader::RequestData (vtkInformation*,
 
   return 1;
 }
+
+//----------------------------------------------------------------------------
+int vtkboneAIMReader::ReadHeader (const char* filename, vtkInformation* info)
+{
+  if (filename == NULL || info == NULL)
+  {
+    return 0;
+  }
+  AIMHeader header;
+  try
+  {
+    read_header (filename, header);
+  }
+  catch (const std::exception& e)
+  {
+    return 0;
+  }
+  info->Set (DIMENSION(), header.dimensions, 3);
+  info->Set (POSITION(), header.position, 3);
+  info->Set (ELEMENT_SIZE(), header.element_size, 3);
+  info->Set (PROCESSING_LOG(), header.processing_log.c_str());
+  info->Set (SCALAR_TYPE(), header.scalar_type);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkboneAIMReader::ClearHeaderCache ()
+{
+  header_cache.Clear();
+}
@@ -34,6 +34,19 @@
  that most VTK filters which take vtkImageData as input expect the data
  to be on the Points; VTKBONE filters generally accept input images with
  either on the Points or on the Cells.
+
+ Only the requested update extent is read, so that downstream filters that
+ crop or stream the image do not pay for reading the whole file.  For
+ uncompressed files only the required rows are read; compressed files are
+ decoded completely and then cropped.
+
+ As an option, the data of uncompressed AIM files can be memory-mapped
+ instead of read; see MemoryMapping.
+
+ Parsed headers are cached (for the process), keyed on the file name,
+ size and modification time, so that a file header is parsed only once,
+ however many times it is required.  ReadHeader gives fast access to the
+ header information without creating a pipeline.
 */
 
 #ifndef __vtkboneAIMReader_h
@@ -49,6 +62,10 @@
 // Forward declarations
 class vtkImageData;
 class vtkMath;
+class vtkInformationIntegerKey;
+class vtkInformationIntegerVectorKey;
+class vtkInformationDoubleVectorKey;
+class vtkInformationStringKey;
 
 class VTKBONE_EXPORT vtkboneAIMReader : public vtkImageAlgorithm
 {
@@ -70,6 +87,41 @@ public:
   vtkBooleanMacro(DataOnCells, int);
   //@}
 
+  //@{
+  /*! Set/Get flag to memory-map the data of uncompressed AIM files instead
+      of copying it into a newly allocated array.  Loading is then nearly
+      instantaneous, and processes reading the same file share the page
+      cache.  The mapping is private (copy-on-write), so modifying the
+      data never modifies the file.  It is released when the data array is
+      deleted.  Compressed files, files that cannot be mapped and requests
+      for a sub-extent are read normally.  Default is Off. */
+  vtkSetMacro(MemoryMapping, int);
+  vtkGetMacro(MemoryMapping, int);
+  vtkBooleanMacro(MemoryMapping, int);
+  //@}
+
+  //@{
+  /*! Set/Get flag to decode the run-length encodings of binary and char
+      AIM files in parallel, instead of with AimIO.  Other encodings are
+      always decoded by AimIO.  Default is Off. */
+  vtkSetMacro(ParallelRunLengthDecoding, int);
+  vtkGetMacro(ParallelRunLengthDecoding, int);
+  vtkBooleanMacro(ParallelRunLengthDecoding, int);
+  //@}
+
+  //@{
+  /*! Set/Get the maximum number of threads used to decode run-length
+      encoded data; see ParallelRunLengthDecoding.  0 uses the
+      vtkSMPTools default.  Default is 0. */
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+  //@}
+
+  //@{
+  /*! Was the data of the last read memory-mapped? */
+  vtkGetMacro(DataIsMemoryMapped, int);
+  //@}
+
   //@{
   /*! Was there an error on the last read performed? */
   vtkGetMacro(Error, int);
@@ -95,6 +147,24 @@ public:
   vtkGetStringMacro(ProcessingLog);
   //@}
 
+  //@{
+  /*! Keys for the header information returned by ReadHeader.
+      SCALAR_TYPE is the VTK type of the data, or -1 if not supported. */
+  static vtkInformationIntegerVectorKey* DIMENSION();
+  static vtkInformationIntegerVectorKey* POSITION();
+  static vtkInformationDoubleVectorKey* ELEMENT_SIZE();
+  static vtkInformationStringKey* PROCESSING_LOG();
+  static vtkInformationIntegerKey* SCALAR_TYPE();
+  //@}
+
+  /*! Reads only the header of an AIM file, into info using the keys
+      above.  The image data is not read.  Returns 1 on success, 0 on
+      error. */
+  static int ReadHeader(const char* filename, vtkInformation* info);
+
+  /*! Discards all cached headers. */
+  static void ClearHeaderCache();
+
 protected:
   vtkboneAIMReader();
   ~vtkboneAIMReader();
@@ -113,6 +183,10 @@ protected:
 
   char *FileName;
   int DataOnCells;  // Flag to put data on cells instead of points.
+  int MemoryMapping;
+  int DataIsMemoryMapped;
+  int ParallelRunLengthDecoding;
+  int NumberOfThreads;
 
   char* ProcessingLog;
   int Dimension[3];
@@ -6,11 +6,19 @@
 #include "vtkImageData.h"
 #include "vtkCellData.h"
 #include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkErrorCode.h"
 #include "vtkSmartPointer.h"
 #include "AimIO/AimIO.h"
+#include "ScancoFileHelper.h"
+#include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <time.h>
+#include <vector>
 #include <boost/format.hpp>
 
 using boost::format;
@@ -25,6 +33,35 @@ inline int roundFloat (const float x)
   return floor (x+0.5f);
 }
 
+//-----------------------------------------------------------------------
+// The image assembled from the slabs in streaming mode.
+class vtkboneAIMWriterStreamState
+{
+public:
+  vtkboneAIMWriterStreamState() : Scratch (NULL), Data (NULL) {}
+  ~vtkboneAIMWriterStreamState()
+  {
+    if (this->Scratch)
+    {
+      ScancoFileHelper::UnmapFileRegion (this->Scratch);
+    }
+  }
+
+  bool OnCells;
+  int WholeExtent[6];
+  int VoxelDims[3];
+  int NumberOfLayers;
+  int DataType;
+  int DataTypeSize;
+  double Origin[3];
+  double Spacing[3];
+  // The image data are in Scratch if a scratch region could be created,
+  // otherwise in Memory.
+  void* Scratch;
+  std::vector<char> Memory;
+  char* Data;
+};
+
 vtkStandardNewMacro (vtkboneAIMWriter);
 
 //-----------------------------------------------------------------------
@@ -33,6 +70,9 @@ vtkboneAIMWriter::vtkboneAIMWriter()
   this->FileName = NULL;
   this->NewProcessingLog = 1; // Default is to add the base AIM log info
   this->ProcessingLog = NULL;
+  this->NumberOfStreamDivisions = 1;
+  this->CurrentStreamDivision = 0;
+  this->StreamState = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -40,6 +80,7 @@ vtkboneAIMWriter::~vtkboneAIMWriter()
 {
   this->SetFileName(0);   // Frees memory
   this->SetProcessingLog(0);   // Frees memory
+  delete this->StreamState;
 }
 
 //----------------------------------------------------------------------------
@@ -50,6 +91,7 @@ void vtkboneAIMWriter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "NewProcessingLog: " << this->NewProcessingLog << "\n";
   os << indent << "ProcessingLog: "
      << (this->ProcessingLog ? this->ProcessingLog : "(none)") << "\n";
+  os << indent << "NumberOfStreamDivisions: " << this->NumberOfStreamDivisions << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -59,8 +101,254 @@ void vtkboneAIMWriter::AppendToLog (const char* s)
   this->SetProcessingLog ((string(ProcessingLog) + s).c_str());
 }
 
+//----------------------------------------------------------------------------
+void vtkboneAIMWriter::GetStreamDivisionRange
+(
+  const int wholeExtent[6],
+  int division,
+  int range[2]
+)
+{
+  vtkIdType n = wholeExtent[5] - wholeExtent[4] + 1;
+  vtkIdType d = std::min(vtkIdType(this->NumberOfStreamDivisions), n);
+  range[0] = int((n*division)/d);
+  range[1] = int(std::min((n*(division+1))/d, n-1));
+}
+
+//----------------------------------------------------------------------------
+int vtkboneAIMWriter::RequestUpdateExtent(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  if (this->NumberOfStreamDivisions <= 1)
+  {
+    return this->Superclass::RequestUpdateExtent(request, inputVector, outputVector);
+  }
+
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  int range[2];
+  this->GetStreamDivisionRange(wholeExtent, this->CurrentStreamDivision, range);
+  int updateExtent[6];
+  std::copy(wholeExtent, wholeExtent+6, updateExtent);
+  updateExtent[4] = wholeExtent[4] + range[0];
+  updateExtent[5] = wholeExtent[4] + range[1];
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExtent, 6);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneAIMWriter::RequestData(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  if (this->NumberOfStreamDivisions <= 1)
+  {
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+  }
+  return this->RequestDataStreaming(request, vtkImageData::GetData(inputVector[0]));
+}
+
+//----------------------------------------------------------------------------
+int vtkboneAIMWriter::RequestDataStreaming
+(
+  vtkInformation* request,
+  vtkImageData* input
+)
+{
+  if (input == NULL)
+  {
+    vtkErrorMacro(<<"Could not get data from input.");
+    this->AbortStreaming(request, vtkErrorCode::UnknownError);
+    return 0;
+  }
+  vtkInformation *inInfo = this->GetInputInformation();
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  vtkIdType numDivisions = std::min(vtkIdType(this->NumberOfStreamDivisions),
+                                    vtkIdType(wholeExtent[5] - wholeExtent[4] + 1));
+
+  vtkDataArray* inputScalars = input->GetCellData()->GetScalars();
+  bool onCells = (inputScalars != NULL);
+  if (!onCells)
+  {
+    inputScalars = input->GetPointData()->GetScalars();
+    if (inputScalars == NULL)
+    {
+      vtkErrorMacro(<<"Could not get data from input.");
+      this->AbortStreaming(request, vtkErrorCode::UnknownError);
+      return 0;
+    }
+  }
+
+  if (this->CurrentStreamDivision == 0)
+  {
+    this->SetErrorCode(vtkErrorCode::NoError);
+    if (!this->FileName)
+    {
+      vtkErrorMacro(<<"An output filename must be specified.");
+      this->AbortStreaming(request, vtkErrorCode::NoFileNameError);
+      return 0;
+    }
+    switch (inputScalars->GetDataType())
+    {
+      case VTK_CHAR:
+      case VTK_SIGNED_CHAR:
+      case VTK_SHORT:
+      case VTK_FLOAT:
+        break;
+      default:
+        vtkErrorMacro(<<"Input must be of type VTK_SIGNED_CHAR, VTK_SHORT or VTK_FLOAT.");
+        this->AbortStreaming(request, vtkErrorCode::FileFormatError);
+        return 0;
+    }
+    if (inputScalars->GetNumberOfComponents() != 1)
+    {
+      vtkErrorMacro(<<"Input scalars must have a single component.");
+      this->AbortStreaming(request, vtkErrorCode::FileFormatError);
+      return 0;
+    }
+    delete this->StreamState;
+    this->StreamState = new vtkboneAIMWriterStreamState;
+    vtkboneAIMWriterStreamState* state = this->StreamState;
+    state->OnCells = onCells;
+    std::copy(wholeExtent, wholeExtent+6, state->WholeExtent);
+    for (int a=0; a<3; ++a)
+    {
+      state->VoxelDims[a] = wholeExtent[2*a+1] - wholeExtent[2*a] + (onCells ? 0 : 1);
+    }
+    if ((state->VoxelDims[0]<1) || (state->VoxelDims[1]<1) || (state->VoxelDims[2]<1))
+    {
+      vtkErrorMacro(<<"Input image is empty.");
+      this->AbortStreaming(request, vtkErrorCode::FileFormatError);
+      return 0;
+    }
+    state->NumberOfLayers = state->VoxelDims[2];
+    state->DataType = inputScalars->GetDataType();
+    state->DataTypeSize = inputScalars->GetDataTypeSize();
+    input->GetOrigin(state->Origin);
+    input->GetSpacing(state->Spacing);
+    size_t size = size_t(state->VoxelDims[0]) * size_t(state->VoxelDims[1]) *
+                  size_t(state->VoxelDims[2]) * size_t(state->DataTypeSize);
+    state->Scratch = ScancoFileHelper::CreateScratchRegion(size);
+    if (state->Scratch)
+    {
+      state->Data = static_cast<char*>(state->Scratch);
+    }
+    else
+    {
+      vtkWarningMacro(<<"Unable to create scratch file; assembling the image in memory.");
+      state->Memory.resize(size);
+      state->Data = state->Memory.data();
+    }
+  }
+  vtkboneAIMWriterStreamState* state = this->StreamState;
+
+  // The layers of this division
+  int range[2];
+  this->GetStreamDivisionRange(wholeExtent, this->CurrentStreamDivision, range);
+  vtkIdType layerBegin = range[0];
+  bool finish = (this->CurrentStreamDivision == numDivisions - 1);
+  vtkIdType layerEnd = finish ? state->NumberOfLayers : vtkIdType(range[1]);
+
+  // Check that we received what we asked for.
+  int inExt[6];
+  input->GetExtent(inExt);
+  if (onCells != state->OnCells ||
+      inputScalars->GetDataType() != state->DataType ||
+      inExt[0] != wholeExtent[0] || inExt[1] != wholeExtent[1] ||
+      inExt[2] != wholeExtent[2] || inExt[3] != wholeExtent[3] ||
+      inExt[4] > wholeExtent[4] + range[0] ||
+      inExt[5] < wholeExtent[4] + range[1])
+  {
+    vtkErrorMacro(<< "Input does not cover the requested z-slab.");
+    this->AbortStreaming(request, vtkErrorCode::UnknownError);
+    return 0;
+  }
+
+  // Layers are contiguous in both the input and the assembled image.
+  size_t layerSize = size_t(state->VoxelDims[0]) * size_t(state->VoxelDims[1]) *
+                     size_t(state->DataTypeSize);
+  vtkIdType inputLayer = layerBegin + wholeExtent[4] - inExt[4];
+  if (layerEnd > layerBegin)
+  {
+    std::memcpy(state->Data + layerBegin*layerSize,
+                static_cast<const char*>(inputScalars->GetVoidPointer(0)) + inputLayer*layerSize,
+                (layerEnd - layerBegin)*layerSize);
+  }
+
+  if (!finish)
+  {
+    ++this->CurrentStreamDivision;
+    request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(), 1);
+    this->UpdateProgress(double(this->CurrentStreamDivision)/numDivisions);
+    return 1;
+  }
+
+  // Last division: write the assembled image.
+  request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+  this->CurrentStreamDivision = 0;
+
+  vtkSmartPointer<vtkDataArray> data = vtkSmartPointer<vtkDataArray>::Take(
+                                 vtkDataArray::CreateDataArray(state->DataType));
+  data->SetNumberOfComponents(1);
+  data->SetVoidArray(state->Data,
+                     vtkIdType(state->VoxelDims[0]) * vtkIdType(state->VoxelDims[1]) *
+                     vtkIdType(state->VoxelDims[2]),
+                     1);
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetExtent(state->WholeExtent);
+  image->SetOrigin(state->Origin);
+  image->SetSpacing(state->Spacing);
+  if (state->OnCells)
+  {
+    image->GetCellData()->SetScalars(data);
+  }
+  else
+  {
+    image->GetPointData()->SetScalars(data);
+  }
+  int status = this->WriteImage(image);
+
+  image = NULL;
+  data = NULL;
+  if (!status)
+  {
+    this->AbortStreaming(request, vtkErrorCode::CannotOpenFileError);
+    return 0;
+  }
+  delete this->StreamState;
+  this->StreamState = NULL;
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkboneAIMWriter::AbortStreaming(vtkInformation* request, unsigned long errorCode)
+{
+  request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+  this->CurrentStreamDivision = 0;
+  // Releases the scratch region and its (already unlinked) temporary file.
+  delete this->StreamState;
+  this->StreamState = NULL;
+  if (this->GetErrorCode() == vtkErrorCode::NoError)
+  {
+    this->SetErrorCode(errorCode);
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkboneAIMWriter::WriteData()
+{
+  this->WriteImage(vtkImageData::SafeDownCast(this->GetInput()));
+}
+
+//----------------------------------------------------------------------------
+int vtkboneAIMWriter::WriteImage(vtkImageData* temp_input)
 {
   AimIO::AimFile writer;
 
@@ -76,8 +364,6 @@ void vtkboneAIMWriter::WriteData()
   // struct        tm *timeinfo;
   // int position[3];
 
-  vtkImageData *temp_input= vtkImageData::SafeDownCast(this->GetInput());
-
   this->UpdateProgress(.01);
 
   // Now we are going to make sure that the image data is on the points.
@@ -110,7 +396,7 @@ void vtkboneAIMWriter::WriteData()
   else
   {
     vtkErrorMacro(<<"Could not get data from input.");
-    return;
+    return 0;
   }
 
   vtkDebugMacro(<<"Writing AIM file...");
@@ -118,7 +404,8 @@ void vtkboneAIMWriter::WriteData()
   if (!this->FileName)
   {
       vtkErrorMacro(<<"An output filename must be specified.");
-      return;
+      this->SetErrorCode(vtkErrorCode::NoFileNameError);
+      return 0;
   }
   writer.filename = this->FileName;
 
@@ -259,29 +546,39 @@ void vtkboneAIMWriter::WriteData()
 
   // Write the image
   vtkDataArray* data = input->GetPointData()->GetScalars();
-  switch (data->GetDataType())
+  try
   {
-    case VTK_CHAR:
-      vtkErrorMacro(<<"Saving VTK_CHAR is deprecated, use VTK_SIGNED_CHAR.");
-      writer.WriteImageData ((char*)(data->WriteVoidPointer(0,0)));
-      break;
-    case VTK_SIGNED_CHAR:
-      writer.WriteImageData ((char*)(data->WriteVoidPointer(0,0)));
-      break;
-    case VTK_SHORT:
-      writer.WriteImageData ((short*)(data->WriteVoidPointer(0,0)));
-      break;
-    case VTK_FLOAT:
-      writer.WriteImageData ((float*)(data->WriteVoidPointer(0,0)));
-      break;
-    default:
-      vtkErrorMacro(<<"Input must be of type VTK_SIGNED_CHAR, VTK_SHORT or VTK_FLOAT.");
-      return;
+    switch (data->GetDataType())
+    {
+      case VTK_CHAR:
+        vtkErrorMacro(<<"Saving VTK_CHAR is deprecated, use VTK_SIGNED_CHAR.");
+        writer.WriteImageData ((char*)(data->WriteVoidPointer(0,0)));
+        break;
+      case VTK_SIGNED_CHAR:
+        writer.WriteImageData ((char*)(data->WriteVoidPointer(0,0)));
+        break;
+      case VTK_SHORT:
+        writer.WriteImageData ((short*)(data->WriteVoidPointer(0,0)));
+        break;
+      case VTK_FLOAT:
+        writer.WriteImageData ((float*)(data->WriteVoidPointer(0,0)));
+        break;
+      default:
+        vtkErrorMacro(<<"Input must be of type VTK_SIGNED_CHAR, VTK_SHORT or VTK_FLOAT.");
+        this->SetErrorCode(vtkErrorCode::FileFormatError);
+        return 0;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    vtkErrorMacro(<< "Error writing " << this->FileName << ": " << e.what());
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    return 0;
   }
 
   this->UpdateProgress(1.0);
 
-  return;
+  return 1;
 }
 
 //----------------------------------------------------------------------------
@@ -24,6 +24,12 @@
  The center of Cell 0,0,0 in the input vtkImageData is written as the
  "pos" of the AIM.  Note that the AIM can only store integral pixel offsets
  for "pos".
+
+ For images produced by streaming pipelines, set NumberOfStreamDivisions
+ to a value greater than 1.  The writer then requests successive z-slab
+ update extents from the upstream pipeline, and appends each slab to a
+ scratch buffer backed by a temporary file, so that the image need never
+ be held in memory.  The AIM is written once the last slab has arrived.
 */
 
 #ifndef __vtkboneAIMWriter_h
@@ -34,6 +40,7 @@
 
 // Forward declarations
 class vtkImageData;
+class vtkboneAIMWriterStreamState;
 
 class VTKBONE_EXPORT vtkboneAIMWriter : public vtkWriter
 {
@@ -74,6 +81,14 @@ public:
   vtkBooleanMacro(NewProcessingLog, int);
   //@}
 
+  //@{
+  /*! Set/Get the number of z-slabs the input is requested in. A value of
+      1 (the default) requests the whole input at once. Values larger
+      than the number of z slices are reduced to the number of z slices. */
+  vtkSetClampMacro(NumberOfStreamDivisions, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfStreamDivisions, int);
+  //@}
+
 protected:
   vtkboneAIMWriter();
   ~vtkboneAIMWriter();
@@ -81,10 +96,39 @@ protected:
   /*! Writes the AIM. */
   void WriteData() override;
 
+  /*! Writes image as an AIM. Returns 0 on error. */
+  int WriteImage(vtkImageData* image);
+
+  virtual int RequestUpdateExtent(vtkInformation*,
+                                  vtkInformationVector**,
+                                  vtkInformationVector*) override;
+
+  virtual int RequestData(vtkInformation*,
+                          vtkInformationVector**,
+                          vtkInformationVector*) override;
+
+  /*! Appends one z-slab to the scratch buffer in streaming mode. Sets
+      CONTINUE_EXECUTING on the request until the last slab has arrived,
+      and then writes the AIM. */
+  int RequestDataStreaming(vtkInformation* request, vtkImageData* input);
+
+  /*! Ends a failed streamed write: clears CONTINUE_EXECUTING, resets the
+      division counter, releases the scratch buffer and sets ErrorCode. */
+  void AbortStreaming(vtkInformation* request, unsigned long errorCode);
+
+  /*! Computes the range of point z-indices (relative to the whole
+      extent) requested for a stream division. */
+  void GetStreamDivisionRange(const int wholeExtent[6],
+                              int division,
+                              int range[2]);
+
   char *FileName;
   char *ProcessingLog;
   int CompressData;
   int NewProcessingLog;
+  int NumberOfStreamDivisions;
+  int CurrentStreamDivision;
+  vtkboneAIMWriterStreamState* StreamState;
 
   virtual int FillInputPortInformation(int port, vtkInformation *info) override;
 
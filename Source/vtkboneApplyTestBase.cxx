@@ -357,5 +357,7 @@ int vtkboneApplyTestBase::RequestData
     return 0;
   }
 
-  return (this->AddSets(output) == VTK_OK);
+  int status = this->AddSets(output);
+  vtkboneNodeSetsByGeometry::ReleaseCoordinateIndex(output);
+  return (status == VTK_OK);
 }
@@ -13,6 +13,8 @@
 #include "vtkboneStressStrainMatrix.h"
 #include "vtkboneVersion.h"
 #include "vtkDataArrayCollection.h"
+#include "vtkDataObjectCollection.h"
+#include "vtkFieldData.h"
 #include "vtkCell.h"
 #include "vtkCellData.h"
 #include "vtkCellArray.h"
@@ -24,11 +26,17 @@
 #include "vtkInformation.h"
 #include "vtkInformationStringVectorKey.h"
 #include "vtkInformationDoubleVectorKey.h"
+#include "vtkIdTypeArray.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocalObject.h"
 #include "n88util/const_array.hpp"
 #include <sstream>
 #include <map>
 #include <set>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 vtkStandardNewMacro(vtkboneCoarsenModel);
 
@@ -87,6 +95,23 @@ void from_homminga_density_inplace (T* x, size_t count)
     x[i] = from_homminga_density (x[i]); }
 }
 
+// The location of an input cell in the output cell grid: key is the linear
+// index of the output cell, slot the position (x fastest) of the input
+// cell in the 2x2x2 block.
+struct CoarseCellEntry
+{
+  vtkTypeUInt64 key;
+  unsigned int slot;
+  vtkIdType cellId;
+
+  bool operator< (const CoarseCellEntry& other) const
+  {
+    if (key != other.key) { return key < other.key; }
+    if (slot != other.slot) { return slot < other.slot; }
+    return cellId < other.cellId;
+  }
+};
+
 }  // namespace
 
 using namespace CoarsenModel_Utility;
@@ -94,9 +119,18 @@ using namespace CoarsenModel_Utility;
 //----------------------------------------------------------------------------
 vtkboneCoarsenModel::vtkboneCoarsenModel()
   :
-  MaterialAveragingMethod (HOMMINGA_DENSITY)
+  MaterialAveragingMethod (HOMMINGA_DENSITY),
+  NumberOfLevels (1),
+  ExportMaps (0),
+  LevelOutputs (vtkDataObjectCollection::New())
   {}
 
+//----------------------------------------------------------------------------
+vtkboneCoarsenModel::~vtkboneCoarsenModel()
+{
+  this->LevelOutputs->Delete();
+}
+
 //----------------------------------------------------------------------------
 int vtkboneCoarsenModel::RequestUpdateExtent(
   vtkInformation *, vtkInformationVector **inputVector,
@@ -127,7 +161,36 @@ int vtkboneCoarsenModel::RequestData(
   vtkboneFiniteElementModel *input = vtkboneFiniteElementModel::SafeDownCast(
     inInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  return this->SimpleExecute(input, output);
+  // Each level is generated from the one before; the last is the output.
+  this->LevelOutputs->RemoveAllItems();
+  vtkSmartPointer<vtkboneFiniteElementModel> current = input;
+  for (int level=1; level<this->NumberOfLevels; ++level)
+  {
+    vtkSmartPointer<vtkboneFiniteElementModel> coarse =
+      vtkSmartPointer<vtkboneFiniteElementModel>::New();
+    int return_val = this->SimpleExecute(current, coarse);
+    if (return_val != 1) { return return_val; }
+    this->LevelOutputs->AddItem(coarse);
+    current = coarse;
+    this->UpdateProgress(double(level)/this->NumberOfLevels);
+  }
+
+  return this->SimpleExecute(current, output);
+}
+
+//----------------------------------------------------------------------------
+vtkboneFiniteElementModel* vtkboneCoarsenModel::GetLevelOutput(int level)
+{
+  if (level == this->NumberOfLevels)
+  {
+    return this->GetOutput();
+  }
+  if (level < 1 || level > this->LevelOutputs->GetNumberOfItems())
+  {
+    return NULL;
+  }
+  return vtkboneFiniteElementModel::SafeDownCast(
+           this->LevelOutputs->GetItem(level-1));
 }
 
 
@@ -147,6 +210,8 @@ void vtkboneCoarsenModel::PrintParameters (ostream& os, vtkIndent indent)
   else if (this->MaterialAveragingMethod == HOMMINGA_DENSITY)
     { os << "HOMMINGA_DENSITY"; }
   os << "\n";
+  os << indent << "NumberOfLevels: " << this->NumberOfLevels << "\n";
+  os << indent << "ExportMaps: " << this->ExportMaps << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -226,286 +291,208 @@ int vtkboneCoarsenModel::SimpleExecute(
   //           << inputDims[1] << ", "
   //           << inputDims[2] << "\n";
 
-  // ---- Generate input cell grid
-
-  n88::array<3,unsigned int> inputCellGrid(
-          inputDims[2],
-          inputDims[1],
-          inputDims[0]);
-  for (size_t i=0; i<inputCellGrid.size(); ++i)
-    { inputCellGrid[i] = EMPTY; }
-  { // scope
-    vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-    for (vtkIdType cellId=0; cellId<nInputCells; ++cellId)
-    {
-      if (input->GetCellType(cellId) != VTK_VOXEL)
-      {
-        vtkErrorMacro(<<"Unsupported cell type");
-        return VTK_ERROR;
-      }
-      input->GetCellPoints(cellId, pointIds);
-      double p0[3];
-      input->GetPoint(pointIds->GetId(0),p0);
-      unsigned int i = 0.5 + (p0[0] - bounds[0])/inputSpacing[0];
-      unsigned int j = 0.5 + (p0[1] - bounds[2])/inputSpacing[1];
-      unsigned int k = 0.5 + (p0[2] - bounds[4])/inputSpacing[2];
-      inputCellGrid(k,j,i) = cellId;
-    }
-  }
-
-  {  // scope
-    size_t count = 0;
-    for (size_t i=0; i<inputCellGrid.size(); ++i)
-      if (inputCellGrid[i] != EMPTY)
-        { ++count; }
-    // std::cout << "Number of non-empty cell grid points " << count << "\n";
-  }
-
-  // ---- Generate input point grid
-
-  n88::array<3,unsigned int> inputPointGrid(
-          inputDims[2]+1,
-          inputDims[1]+1,
-          inputDims[0]+1);
-  for (size_t i=0; i<inputPointGrid.size(); ++i)
-    { inputPointGrid[i] = EMPTY; }
-  {  // scope
-    for (vtkIdType pointId=0; pointId<nInputPoints; ++pointId)
-    {
-      double p0[3];
-      input->GetPoint(pointId,p0);
-      unsigned int i = 0.5 + (p0[0] - bounds[0])/inputSpacing[0];
-      unsigned int j = 0.5 + (p0[1] - bounds[2])/inputSpacing[1];
-      unsigned int k = 0.5 + (p0[2] - bounds[4])/inputSpacing[2];
-      inputPointGrid(k,j,i) = pointId;
-    }
-  }
-
-  {  // scope
-    size_t count = 0;
-    for (size_t i=0; i<inputPointGrid.size(); ++i)
-      if (inputPointGrid[i] != EMPTY)
-        { ++count; }
-    // std::cout << "Number of non-empty point grid points " << count << "\n";
-  }
-
   // ---- Output dimensions
 
   unsigned int outputDims[3];
   outputDims[0] = (inputDims[0] + 1)/2;   // Round up
   outputDims[1] = (inputDims[1] + 1)/2;
   outputDims[2] = (inputDims[2] + 1)/2;
-  // std::cout << "Output dimensions: "
-  //           << outputDims[0] << ", "
-  //           << outputDims[1] << ", "
-  //           << outputDims[2] << "\n";
   double outputSpacing[3];
   outputSpacing[0] = inputSpacing[0]*2;
   outputSpacing[1] = inputSpacing[1]*2;
   outputSpacing[2] = inputSpacing[2]*2;
 
-  // ---- Generate output cell grid
+  // The grids are stored sparsely, as sorted lists of the linear indices
+  // (keys) of their occupied locations, so that memory is proportional to
+  // the number of cells rather than to the bounding box.  Output cells and
+  // points are numbered in the order of their keys, which is the order of
+  // a z-major traversal of the grids.
 
-  // Note that n88::array starts out zeroed.
-  n88::array<3,unsigned int> outputCellGrid(
-          outputDims[2],
-          outputDims[1],
-          outputDims[0]);
-  // identify where we need output cells
-  { // scope
-    vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-    for (vtkIdType cellId=0; cellId<nInputCells; ++cellId)
-    {
-      input->GetCellPoints(cellId, pointIds);
-      double p0[3];
-      input->GetPoint(pointIds->GetId(0),p0);
-      // These are indices for the output cell grid
-      unsigned int i = 0.25 + (p0[0] - bounds[0])/outputSpacing[0];
-      unsigned int j = 0.25 + (p0[1] - bounds[2])/outputSpacing[1];
-      unsigned int k = 0.25 + (p0[2] - bounds[4])/outputSpacing[2];
-      outputCellGrid(k,j,i) = 1;
-    }
-  }
-  // number the output cells
-  unsigned int nOutputCells = 0;
+  // ---- Locate each input cell in the output cell grid (parallel)
+
+  std::vector<CoarseCellEntry> entries (nInputCells);
+  std::atomic<int> unsupportedCellType (0);
   { // scope
-    vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-    for (size_t i=0; i<outputCellGrid.size(); ++i)
+    vtkSMPThreadLocalObject<vtkIdList> localPointIds;
+    vtkCellArray* inputCells = input->GetCells();
+    vtkSMPTools::For(0, nInputCells, [&](vtkIdType begin, vtkIdType end)
     {
-      if (outputCellGrid[i])
-      {
-        outputCellGrid[i] = nOutputCells;
-        ++nOutputCells;
-      }
-      else
-      {
-        outputCellGrid[i] = EMPTY;
-      }
-    }
-  }
-  // std::cout << "Number of output cells " << nOutputCells << "\n";
-
-  // ---- Generate output point grid
-
-  // Note that n88::array starts out zeroed.
-  n88::array<3,unsigned int> outputPointGrid(
-          outputDims[2]+1,
-          outputDims[1]+1,
-          outputDims[0]+1);
-  // identify where we need output points
-  for (unsigned int k=0; k<outputDims[2]; ++k)
-    for (unsigned int j=0; j<outputDims[1]; ++j)
-      for (unsigned int i=0; i<outputDims[0]; ++i)
+      vtkIdList* pointIds = localPointIds.Local();
+      for (vtkIdType cellId=begin; cellId<end; ++cellId)
       {
-        if (outputCellGrid(k,j,i) != EMPTY)
+        if (input->GetCellType(cellId) != VTK_VOXEL)
         {
-          outputPointGrid(k  ,j  ,i  ) = 1;
-          outputPointGrid(k  ,j  ,i+1) = 1;
-          outputPointGrid(k  ,j+1,i  ) = 1;
-          outputPointGrid(k  ,j+1,i+1) = 1;
-          outputPointGrid(k+1,j  ,i  ) = 1;
-          outputPointGrid(k+1,j  ,i+1) = 1;
-          outputPointGrid(k+1,j+1,i  ) = 1;
-          outputPointGrid(k+1,j+1,i+1) = 1;
+          unsupportedCellType = 1;
+          return;
         }
+        inputCells->GetCellAtId(cellId, pointIds);
+        double p0[3];
+        input->GetPoint(pointIds->GetId(0),p0);
+        unsigned int i = 0.5 + (p0[0] - bounds[0])/inputSpacing[0];
+        unsigned int j = 0.5 + (p0[1] - bounds[2])/inputSpacing[1];
+        unsigned int k = 0.5 + (p0[2] - bounds[4])/inputSpacing[2];
+        CoarseCellEntry& e = entries[cellId];
+        e.key = (vtkTypeUInt64(k/2)*outputDims[1] + j/2)*outputDims[0] + i/2;
+        e.slot = (i & 1) | ((j & 1) << 1) | ((k & 1) << 2);
+        e.cellId = cellId;
       }
-  // number the output points
-  unsigned int nOutputPoints = 0;
-  { // scope
-    vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-    for (size_t i=0; i<outputPointGrid.size(); ++i)
+    });
+  }
+  if (unsupportedCellType)
+  {
+    vtkErrorMacro(<<"Unsupported cell type");
+    return VTK_ERROR;
+  }
+  vtkSMPTools::Sort(entries.begin(), entries.end());
+
+  // ---- Number the output cells; generate cell map (input to output) and
+  //      reverse cell map (output to input)
+
+  std::vector<vtkTypeUInt64> outputCellKeys;
+  n88::array<1,vtkIdType> cellMap(nInputCells);
+  std::vector<unsigned int> reverseCellMap;
+  for (size_t n=0; n<entries.size(); ++n)
+  {
+    const CoarseCellEntry& e = entries[n];
+    if (outputCellKeys.empty() || outputCellKeys.back() != e.key)
     {
-      if (outputPointGrid[i])
-      {
-        outputPointGrid[i] = nOutputPoints;
-        ++nOutputPoints;
-      }
-      else
-      {
-        outputPointGrid[i] = EMPTY;
-      }
+      outputCellKeys.push_back(e.key);
+      reverseCellMap.resize(reverseCellMap.size() + 8, EMPTY);
     }
+    // If two input cells coincide, the later one is used, as the sort
+    // is by cellId within each slot.
+    const vtkIdType outputCellId = outputCellKeys.size() - 1;
+    reverseCellMap[8*outputCellId + e.slot] = e.cellId;
+    cellMap[e.cellId] = outputCellId;
   }
-  // std::cout << "Number of output points " << nOutputPoints << "\n";
+  std::vector<CoarseCellEntry>().swap(entries);
+  const unsigned int nOutputCells = outputCellKeys.size();
 
-  // --- Generate reverse cell map (output to input)
+  // The exported map lists each input cell once, so it is copied before
+  // the odd-layer faces are duplicated.
+  std::vector<unsigned int> exportedReverseCellMap;
+  if (this->ExportMaps)
+  {
+    exportedReverseCellMap = reverseCellMap;
+  }
 
-  n88::array<2,unsigned int> reverseCellMap(nOutputCells,8);
-  {  // scope
-    size_t a = 0;
-    vtkIdType outputCellId = 0;
-    for (unsigned int k=0; k<outputDims[2]; ++k)
+  // Bring back in bounds if at odd-layer face. This has the effect
+  // of duplicating the odd-layer face.
+  vtkSMPTools::For(0, nOutputCells, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType outputCellId=begin; outputCellId<end; ++outputCellId)
     {
-      unsigned int kk = 2*k;
-      unsigned int kk_1 = kk+1;
-      // Bring back in bounds if at odd-layer face. This has the effect
-      // of duplicating the odd-layer face.
-      if (kk_1 == inputDims[2])
-        { kk_1 = kk; }
-      for (unsigned int j=0; j<outputDims[1]; ++j)
+      unsigned int* slots = &reverseCellMap[8*outputCellId];
+      const vtkTypeUInt64 key = outputCellKeys[outputCellId];
+      const unsigned int i = key % outputDims[0];
+      const unsigned int j = (key / outputDims[0]) % outputDims[1];
+      const unsigned int k = key / (vtkTypeUInt64(outputDims[0])*outputDims[1]);
+      if (2*i+1 == inputDims[0])
       {
-        unsigned int jj = 2*j;
-        unsigned int jj_1 = jj+1;
-        if (jj_1 == inputDims[1])
-          { jj_1 = jj; }
-        for (unsigned int i=0; i<outputDims[0]; ++i)
-        {
-          if (outputCellGrid[a] != EMPTY)
-          {
-            n88_assert (outputCellId == outputCellGrid[a]);
-            unsigned int ii = 2*i;
-            unsigned int ii_1 = ii+1;
-            if (ii_1 == inputDims[0])
-              { ii_1 = ii; }
-            reverseCellMap(outputCellId,0) = inputCellGrid(kk  ,jj  ,ii  );
-            reverseCellMap(outputCellId,1) = inputCellGrid(kk  ,jj  ,ii_1);
-            reverseCellMap(outputCellId,2) = inputCellGrid(kk  ,jj_1,ii  );
-            reverseCellMap(outputCellId,3) = inputCellGrid(kk  ,jj_1,ii_1);
-            reverseCellMap(outputCellId,4) = inputCellGrid(kk_1,jj  ,ii  );
-            reverseCellMap(outputCellId,5) = inputCellGrid(kk_1,jj  ,ii_1);
-            reverseCellMap(outputCellId,6) = inputCellGrid(kk_1,jj_1,ii  );
-            reverseCellMap(outputCellId,7) = inputCellGrid(kk_1,jj_1,ii_1);
-            ++outputCellId;
-          }
-          ++a;
-        }
+        slots[1] = slots[0]; slots[3] = slots[2]; slots[5] = slots[4]; slots[7] = slots[6];
+      }
+      if (2*j+1 == inputDims[1])
+      {
+        slots[2] = slots[0]; slots[3] = slots[1]; slots[6] = slots[4]; slots[7] = slots[5];
+      }
+      if (2*k+1 == inputDims[2])
+      {
+        slots[4] = slots[0]; slots[5] = slots[1]; slots[6] = slots[2]; slots[7] = slots[3];
       }
     }
-  }
+  });
 
-  // Done with input cell grid
-  inputCellGrid.destruct();
+  // ---- Generate output point grid: the corners of the output cells
 
-  // --- Generate cell map (input to output)
-
-  n88::array<1,vtkIdType> cellMap(nInputCells);
-  for (vtkIdType outputCellId=0; outputCellId<nOutputCells; ++outputCellId)
+  const vtkTypeUInt64 pd0 = outputDims[0] + 1;
+  const vtkTypeUInt64 pd1 = outputDims[1] + 1;
+  std::vector<vtkTypeUInt64> cornerKeys (8*size_t(nOutputCells));
+  vtkSMPTools::For(0, nOutputCells, [&](vtkIdType begin, vtkIdType end)
   {
-    for (unsigned int i=0; i<8; ++i)
+    for (vtkIdType outputCellId=begin; outputCellId<end; ++outputCellId)
     {
-      vtkIdType inputCellID = reverseCellMap(outputCellId,i);
-      if (inputCellID != EMPTY)
-        { cellMap(inputCellID) = outputCellId; }
+      const vtkTypeUInt64 key = outputCellKeys[outputCellId];
+      const vtkTypeUInt64 i = key % outputDims[0];
+      const vtkTypeUInt64 j = (key / outputDims[0]) % outputDims[1];
+      const vtkTypeUInt64 k = key / (vtkTypeUInt64(outputDims[0])*outputDims[1]);
+      const vtkTypeUInt64 p = (k*pd1 + j)*pd0 + i;
+      vtkTypeUInt64* c = &cornerKeys[8*outputCellId];
+      c[0] = p;
+      c[1] = p + 1;
+      c[2] = p + pd0;
+      c[3] = p + pd0 + 1;
+      c[4] = p + pd0*pd1;
+      c[5] = p + pd0*pd1 + 1;
+      c[6] = p + pd0*pd1 + pd0;
+      c[7] = p + pd0*pd1 + pd0 + 1;
     }
-  }
+  });
+  std::vector<vtkTypeUInt64> outputPointKeys (cornerKeys);
+  vtkSMPTools::Sort(outputPointKeys.begin(), outputPointKeys.end());
+  outputPointKeys.erase(std::unique(outputPointKeys.begin(), outputPointKeys.end()),
+                        outputPointKeys.end());
+  const unsigned int nOutputPoints = outputPointKeys.size();
+
+  // Cell connectivity, as output point ids.
+  std::vector<unsigned int> outputCellPoints (cornerKeys.size());
+  vtkSMPTools::For(0, vtkIdType(cornerKeys.size()), [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
+    {
+      outputCellPoints[n] = std::lower_bound(outputPointKeys.begin(),
+                                             outputPointKeys.end(),
+                                             cornerKeys[n]) - outputPointKeys.begin();
+    }
+  });
+  std::vector<vtkTypeUInt64>().swap(cornerKeys);
 
   // --- Generate point map (input to output)
 
   n88::array<1,unsigned int> pointMap(nInputPoints);
-  {  // scope
-    size_t a = 0;
-    vtkIdType inputPointId = 0;
-    for (unsigned int k=0; k<=inputDims[2]; ++k)
+  vtkSMPTools::For(0, nInputPoints, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType inputPointId=begin; inputPointId<end; ++inputPointId)
     {
+      double p0[3];
+      input->GetPoint(inputPointId,p0);
+      unsigned int i = 0.5 + (p0[0] - bounds[0])/inputSpacing[0];
+      unsigned int j = 0.5 + (p0[1] - bounds[2])/inputSpacing[1];
+      unsigned int k = 0.5 + (p0[2] - bounds[4])/inputSpacing[2];
       // Round up beyond the centre (ie. round outwards)
-      unsigned int kk = (k + (unsigned int)(2*k > inputDims[2]))/2;
-      for (unsigned int j=0; j<=inputDims[1]; ++j)
+      const vtkTypeUInt64 ii = (i + (unsigned int)(2*i > inputDims[0]))/2;
+      const vtkTypeUInt64 jj = (j + (unsigned int)(2*j > inputDims[1]))/2;
+      const vtkTypeUInt64 kk = (k + (unsigned int)(2*k > inputDims[2]))/2;
+      const vtkTypeUInt64 key = (kk*pd1 + jj)*pd0 + ii;
+      std::vector<vtkTypeUInt64>::const_iterator it =
+        std::lower_bound(outputPointKeys.begin(), outputPointKeys.end(), key);
+      if (it != outputPointKeys.end() && *it == key)
       {
-        unsigned int jj = (j + (unsigned int)(2*j > inputDims[1]))/2;
-        for (unsigned int i=0; i<=inputDims[0]; ++i)
-        {
-          if (inputPointGrid[a] != EMPTY)
-          {
-            n88_assert (inputPointId == inputPointGrid[a]);
-            unsigned int ii = (i + (unsigned int)(2*i > inputDims[0]))/2;
-            pointMap[inputPointId] = outputPointGrid(kk,jj,ii);
-            n88_assert (pointMap[inputPointId] != EMPTY);
-            ++inputPointId;
-          }
-          ++a;
-        }
+        pointMap[inputPointId] = it - outputPointKeys.begin();
+      }
+      else
+      {
+        pointMap[inputPointId] = EMPTY;
       }
     }
-  }
-
-  // Done with input point grid
-  inputPointGrid.destruct();
+  });
 
   int return_val = 0;
 
   return_val = this->GenerateCells(
     output,
-    outputPointGrid.data(),
-    outputCellGrid.data(),
-    outputDims,
+    outputCellPoints.data(),
     nOutputCells);
   if (return_val == 0) { return VTK_ERROR; }
 
-  // Done with output cell grid
-  outputCellGrid.destruct();
-
   return_val = this->GeneratePointCoordinates(
     output,
-    outputPointGrid.data(),
+    outputPointKeys.data(),
     outputDims,
     outputSpacing,
     bounds,
     nOutputPoints);
   if (return_val == 0) { return VTK_ERROR; }
 
-  // Done with output point grid
-  outputPointGrid.destruct();
-
   return_val = this->GenerateMaterials (output, input, reverseCellMap.data());
   if (return_val == 0) { return VTK_ERROR; }
 
@@ -521,6 +508,13 @@ int vtkboneCoarsenModel::SimpleExecute(
   return_val = this->GenerateAdditionalInformation (output, input);
   if (return_val == 0) { return VTK_ERROR; }
 
+  if (this->ExportMaps)
+  {
+    return_val = this->GenerateMaps (output, input, pointMap.data(),
+                                     cellMap.data(), exportedReverseCellMap.data());
+    if (return_val == 0) { return VTK_ERROR; }
+  }
+
   return 1;
 }
 
@@ -529,7 +523,7 @@ int vtkboneCoarsenModel::SimpleExecute(
 int vtkboneCoarsenModel::GeneratePointCoordinates
   (
   vtkboneFiniteElementModel* output,
-  const unsigned int* outputPointGrid,
+  const vtkTypeUInt64* outputPointKeys,
   unsigned int outputDims[3],
   double outputSpacing[3],
   double bounds[6],
@@ -537,7 +531,7 @@ int vtkboneCoarsenModel::GeneratePointCoordinates
   )
 {
   n88_assert (output != 0);
-  n88_assert (outputPointGrid != 0);
+  n88_assert (outputPointKeys != 0);
   n88_assert (outputDims[0] > 0 &&
               outputDims[1] > 0 &&
               outputDims[2] > 0);
@@ -545,26 +539,22 @@ int vtkboneCoarsenModel::GeneratePointCoordinates
   vtkSmartPointer<vtkFloatArray> pointCoord = vtkSmartPointer<vtkFloatArray>::New();
   pointCoord->SetNumberOfComponents(3);
   pointCoord->SetNumberOfTuples(nOutputPoints);
-  {  // scope
-    size_t a = 0;
-    for (unsigned int k=0; k<=outputDims[2]; ++k)
+  float* coord = pointCoord->GetPointer(0);
+  const vtkTypeUInt64 pd0 = outputDims[0] + 1;
+  const vtkTypeUInt64 pd1 = outputDims[1] + 1;
+  vtkSMPTools::For(0, nOutputPoints, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
     {
-      double z = bounds[4] + outputSpacing[2]*k;
-      for (unsigned int j=0; j<=outputDims[1]; ++j)
-      {
-        double y = bounds[2] + outputSpacing[1]*j;
-        for (unsigned int i=0; i<=outputDims[0]; ++i)
-        {
-          if (outputPointGrid[a] != EMPTY)
-          {
-            double x = bounds[0] + outputSpacing[0]*i;
-            pointCoord->SetTuple3(outputPointGrid[a],x,y,z);
-          }
-          ++a;
-        }
-      }
+      const vtkTypeUInt64 key = outputPointKeys[n];
+      const vtkTypeUInt64 i = key % pd0;
+      const vtkTypeUInt64 j = (key / pd0) % pd1;
+      const vtkTypeUInt64 k = key / (pd0*pd1);
+      coord[3*n  ] = bounds[0] + outputSpacing[0]*i;
+      coord[3*n+1] = bounds[2] + outputSpacing[1]*j;
+      coord[3*n+2] = bounds[4] + outputSpacing[2]*k;
     }
-  }
+  });
   vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
   points->SetData(pointCoord);
   output->SetPoints(points);
@@ -576,64 +566,37 @@ int vtkboneCoarsenModel::GeneratePointCoordinates
 int vtkboneCoarsenModel::GenerateCells
   (
   vtkboneFiniteElementModel* output,
-  const unsigned int* outputPointGrid_ptr,
-  const unsigned int* outputCellGrid,
-  unsigned int outputDims[3],
+  const unsigned int* outputCellPoints,
   vtkIdType nOutputCells
   )
 {
   n88_assert (output != 0);
-  n88_assert (outputPointGrid_ptr != 0);
-  n88_assert (outputCellGrid != 0);
-  n88_assert (outputDims[0] > 0 &&
-              outputDims[1] > 0 &&
-              outputDims[2] > 0);
-
-  // outputPointGrid was passed as pointer: create array reference.
-  n88::const_array<3,unsigned int> outputPointGrid (outputPointGrid_ptr,
-                                                    outputDims[2]+1,
-                                                    outputDims[1]+1,
-                                                    outputDims[0]+1);
+  n88_assert (outputCellPoints != 0);
 
-  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
-  // The following allocation is exact
   const int pointsPerCell = 8;
-  cells->Allocate(cells->EstimateSize(nOutputCells, pointsPerCell));
-  {  // scope
-    size_t a = 0;
-    vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-    pointIds->SetNumberOfIds(pointsPerCell);
-    for (unsigned int k=0; k<outputDims[2]; ++k)
+  vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+  offsets->SetNumberOfTuples(nOutputCells+1);
+  vtkIdType* offsetsPtr = offsets->GetPointer(0);
+  vtkSmartPointer<vtkIdTypeArray> connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+  connectivity->SetNumberOfTuples(pointsPerCell*nOutputCells);
+  vtkIdType* connectivityPtr = connectivity->GetPointer(0);
+  vtkSMPTools::For(0, nOutputCells+1, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
     {
-      for (unsigned int j=0; j<outputDims[1]; ++j)
-      {
-        for (unsigned int i=0; i<outputDims[0]; ++i)
-        {
-          if (outputCellGrid[a] != EMPTY)
-          {
-            pointIds->SetId (0, outputPointGrid(k  ,j  ,i  ));
-            pointIds->SetId (1, outputPointGrid(k  ,j  ,i+1));
-            pointIds->SetId (2, outputPointGrid(k  ,j+1,i  ));
-            pointIds->SetId (3, outputPointGrid(k  ,j+1,i+1));
-            pointIds->SetId (4, outputPointGrid(k+1,j  ,i  ));
-            pointIds->SetId (5, outputPointGrid(k+1,j  ,i+1));
-            pointIds->SetId (6, outputPointGrid(k+1,j+1,i  ));
-            pointIds->SetId (7, outputPointGrid(k+1,j+1,i+1));
-            n88_assert (pointIds->GetId(0) != EMPTY &&
-                        pointIds->GetId(1) != EMPTY &&
-                        pointIds->GetId(2) != EMPTY &&
-                        pointIds->GetId(3) != EMPTY &&
-                        pointIds->GetId(4) != EMPTY &&
-                        pointIds->GetId(5) != EMPTY &&
-                        pointIds->GetId(6) != EMPTY &&
-                        pointIds->GetId(7) != EMPTY);
-            cells->InsertNextCell(pointIds);
-          }
-          ++a;
-        }
-      }
+      offsetsPtr[n] = pointsPerCell*n;
     }
-  }
+  });
+  vtkSMPTools::For(0, pointsPerCell*nOutputCells, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
+    {
+      connectivityPtr[n] = outputCellPoints[n];
+    }
+  });
+
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetData(offsets, connectivity);
   output->SetCells(VTK_VOXEL, cells);
   return 1;
 }
@@ -1245,3 +1208,54 @@ int vtkboneCoarsenModel::GenerateAdditionalInformation
 
   return 1;
 }
+
+//----------------------------------------------------------------------------
+int vtkboneCoarsenModel::GenerateMaps
+  (
+  vtkboneFiniteElementModel* output,
+  vtkboneFiniteElementModel* input,
+  const unsigned int* pointMap,
+  const vtkIdType* cellMap,
+  const unsigned int* reverseCellMap
+  )
+{
+  const vtkIdType nInputPoints = input->GetNumberOfPoints();
+  const vtkIdType nInputCells = input->GetNumberOfCells();
+  const vtkIdType nOutputCells = output->GetNumberOfCells();
+
+  vtkSmartPointer<vtkIdTypeArray> cellMapArray = vtkSmartPointer<vtkIdTypeArray>::New();
+  cellMapArray->SetName("FineToCoarseCellMap");
+  cellMapArray->SetNumberOfTuples(nInputCells);
+  vtkIdType* cellMapPtr = cellMapArray->GetPointer(0);
+  std::copy(cellMap, cellMap + nInputCells, cellMapPtr);
+
+  vtkSmartPointer<vtkIdTypeArray> pointMapArray = vtkSmartPointer<vtkIdTypeArray>::New();
+  pointMapArray->SetName("FineToCoarsePointMap");
+  pointMapArray->SetNumberOfTuples(nInputPoints);
+  vtkIdType* pointMapPtr = pointMapArray->GetPointer(0);
+  vtkSMPTools::For(0, nInputPoints, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
+    {
+      pointMapPtr[n] = (pointMap[n] == EMPTY) ? -1 : vtkIdType(pointMap[n]);
+    }
+  });
+
+  vtkSmartPointer<vtkIdTypeArray> reverseCellMapArray = vtkSmartPointer<vtkIdTypeArray>::New();
+  reverseCellMapArray->SetName("CoarseToFineCellMap");
+  reverseCellMapArray->SetNumberOfComponents(8);
+  reverseCellMapArray->SetNumberOfTuples(nOutputCells);
+  vtkIdType* reverseCellMapPtr = reverseCellMapArray->GetPointer(0);
+  vtkSMPTools::For(0, 8*nOutputCells, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
+    {
+      reverseCellMapPtr[n] = (reverseCellMap[n] == EMPTY) ? -1 : vtkIdType(reverseCellMap[n]);
+    }
+  });
+
+  output->GetFieldData()->AddArray(cellMapArray);
+  output->GetFieldData()->AddArray(pointMapArray);
+  output->GetCellData()->AddArray(reverseCellMapArray);
+  return 1;
+}
@@ -42,6 +42,26 @@
  Currently, elastoplastic materials in the input are converted to
  linear materials for the output.
 
+ A hierarchy of successively coarser models can be generated in one
+ update by setting NumberOfLevels.  With ExportMaps on, each generated
+ model carries the mappings between it and the model it was generated
+ from, so that solutions can be transferred between levels without
+ reconstructing the mapping from coordinates:
+   - field data "FineToCoarseCellMap": for each finer element, the id of
+     the coarse element containing it;
+   - field data "FineToCoarsePointMap": for each finer node, the id of the
+     coarse node it is mapped to, or -1;
+   - cell data "CoarseToFineCellMap": for each coarse element, the ids of
+     the 2x2x2 finer elements (x fastest), or -1 where there is none.
+     The padding layers of odd dimensions are -1: each finer element is
+     listed exactly once, although its values are duplicated for
+     averaging the materials.
+
+ The mapping of input to output elements is computed in parallel, and
+ only the occupied locations of the element and node grids are stored,
+ so that memory use is proportional to the number of elements rather
+ than to the volume of the bounding box.
+
     @sa
  vtkboneFiniteElementModel vtkboneInterpolateCoarseSolution
 */
@@ -52,6 +72,8 @@
 #include "vtkboneFiniteElementModelAlgorithm.h"
 #include "vtkboneWin32Header.h"
 
+class vtkDataObjectCollection;
+
 class VTKBONE_EXPORT vtkboneCoarsenModel : public vtkboneFiniteElementModelAlgorithm
 {
 public:
@@ -78,11 +100,32 @@ public:
   vtkGetMacro(MaterialAveragingMethod, int);
   //@}
 
+  //@{
+  /*! Set/Get the number of successive coarsenings. The output is the
+      coarsest model. The default is 1. */
+  vtkSetClampMacro(NumberOfLevels, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfLevels, int);
+  //@}
+
+  //@{
+  /*! Set/Get whether the fine to coarse element and node maps, and the
+      coarse to fine element map, are added as arrays to each generated
+      model. The default is off. */
+  vtkSetMacro(ExportMaps, int);
+  vtkGetMacro(ExportMaps, int);
+  vtkBooleanMacro(ExportMaps, int);
+  //@}
+
+  /*! Returns the model generated at a level of the hierarchy of the last
+      update, from 1 (coarsened once) to NumberOfLevels (the output).
+      Returns NULL for other levels. */
+  vtkboneFiniteElementModel* GetLevelOutput(int level);
+
 
 protected:
 
   vtkboneCoarsenModel();
-  ~vtkboneCoarsenModel() {}
+  ~vtkboneCoarsenModel();
 
   virtual int RequestData(vtkInformation* request,
                           vtkInformationVector** inputVector,
@@ -94,15 +137,13 @@ protected:
                             vtkboneFiniteElementModel* output);
 
   virtual int GeneratePointCoordinates(vtkboneFiniteElementModel* output,
-                                       const unsigned int* outputPointGrid,
+                                       const vtkTypeUInt64* outputPointKeys,
                                        unsigned int outputDims[3],
                                        double outputSpacing[3],
                                        double bounds[6],
                                        vtkIdType nOutputPoints);
   virtual int GenerateCells(vtkboneFiniteElementModel* output,
-                            const unsigned int* outputPointGrid,
-                            const unsigned int* outputCellGrid,
-                            unsigned int outputDims[3],
+                            const unsigned int* outputCellPoints,
                             vtkIdType nOutputCells);
   virtual int GenerateMaterials(
                    vtkboneFiniteElementModel* output,
@@ -124,8 +165,16 @@ protected:
                                          const vtkIdType* cellMap);
   virtual int GenerateAdditionalInformation(vtkboneFiniteElementModel* output,
                                             vtkboneFiniteElementModel* input);
+  virtual int GenerateMaps(vtkboneFiniteElementModel* output,
+                           vtkboneFiniteElementModel* input,
+                           const unsigned int* pointMap,
+                           const vtkIdType* cellMap,
+                           const unsigned int* reverseCellMap);
 
   int MaterialAveragingMethod;
+  int NumberOfLevels;
+  int ExportMaps;
+  vtkDataObjectCollection* LevelOutputs;
 
 private:
   vtkboneCoarsenModel(const vtkboneCoarsenModel&);  // Not implemented.
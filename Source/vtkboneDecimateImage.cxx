@@ -3,15 +3,30 @@
 #include "vtkImageData.h"
 #include "vtkCellData.h"
 #include "vtkPointData.h"
+#include "vtkDataSetAttributes.h"
 #include "vtkDataArray.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkObjectFactory.h"
 #include "vtkInformationVector.h"
 #include "vtkInformation.h"
+#include "DecimateImageHelper.h"
 #include "n88util/array.hpp"
 
 vtkStandardNewMacro(vtkboneDecimateImage);
 
+//----------------------------------------------------------------------------
+vtkboneDecimateImage::vtkboneDecimateImage()
+{
+  this->ReductionMode = MAXIMUM;
+  this->DecimationFactors[0] = 2;
+  this->DecimationFactors[1] = 2;
+  this->DecimationFactors[2] = 2;
+}
+
+//----------------------------------------------------------------------------
+vtkboneDecimateImage::~vtkboneDecimateImage()
+{
+}
 
 //----------------------------------------------------------------------------
 int vtkboneDecimateImage::RequestInformation(
@@ -24,6 +39,13 @@ int vtkboneDecimateImage::RequestInformation(
   vtkImageData *input = vtkImageData::SafeDownCast(
     inInfo->Get(vtkDataObject::DATA_OBJECT()));
 
+  const int* f = this->DecimationFactors;
+  if (f[0] < 1 || f[1] < 1 || f[2] < 1)
+  {
+    vtkErrorMacro(<< "DecimationFactors must be at least 1.");
+    return 0;
+  }
+
   int inExt[6], outExt[6];
   double inSpacing[3], outSpacing[3];
   double inOrigin[3], outOrigin[3];
@@ -31,49 +53,46 @@ int vtkboneDecimateImage::RequestInformation(
   inInfo->Get(vtkDataObject::SPACING(), inSpacing);
   inInfo->Get(vtkDataObject::ORIGIN(), inOrigin);
 
-  int inDims[3], outDims[3];
-  inDims[0] = (inExt[1] - inExt[0] + 1);
-  inDims[1] = (inExt[3] - inExt[2] + 1);
-  inDims[2] = (inExt[5] - inExt[4] + 1);
+  bool onCells = (input->GetCellData()->GetScalars() != NULL);
+  DecimateImageHelper::OutputInformation(
+    onCells, inExt, inSpacing, inOrigin, f, outExt, outSpacing, outOrigin);
 
-  for (int k = 0; k < 3; k++)
+  // set the output information
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), outExt, 6);
+  outInfo->Set(vtkDataObject::SPACING(), outSpacing, 3);
+  outInfo->Set(vtkDataObject::ORIGIN(), outOrigin, 3);
+
+  // The reduction mode may change the scalar type.  Upstream algorithms
+  // need not report cell scalars, in which case those of the input are used.
+  int inputType = -1;
+  vtkInformation *scalarInfo = vtkDataObject::GetActiveFieldInformation(inInfo,
+    onCells ? vtkDataObject::FIELD_ASSOCIATION_CELLS : vtkDataObject::FIELD_ASSOCIATION_POINTS,
+    vtkDataSetAttributes::SCALARS);
+  if (scalarInfo && scalarInfo->Has(vtkDataObject::FIELD_ARRAY_TYPE()))
   {
-    outSpacing[k] = inSpacing[k] * 2;
+    inputType = scalarInfo->Get(vtkDataObject::FIELD_ARRAY_TYPE());
   }
-
-  if (input->GetCellData()->GetScalars())
+  else if (onCells)
   {
-    for (int k = 0; k < 3; k++)
-    {
-      outOrigin[k] = inOrigin[k] + inExt[2*k]*inSpacing[k];
-    }
-    for (int k = 0; k < 3; k++)
-    {
-      //  Round up to even cells (points-1), then add one more point at boundary.
-      outDims[k] = 1 + inDims[k] / 2;
-    }
+    inputType = input->GetCellData()->GetScalars()->GetDataType();
   }
-  else
+  else if (input->GetPointData()->GetScalars())
+  {
+    inputType = input->GetPointData()->GetScalars()->GetDataType();
+  }
+  if (inputType != -1)
   {
-    for (int k = 0; k < 3; k++)
+    int outputType = DecimateImageHelper::OutputType(this->ReductionMode, inputType);
+    if (onCells)
     {
-      outOrigin[k] = inOrigin[k] + (inExt[2*k] + 0.5) * inSpacing[k];
+      vtkDataObject::SetActiveAttributeInfo(outInfo, vtkDataObject::FIELD_ASSOCIATION_CELLS,
+        vtkDataSetAttributes::SCALARS, NULL, outputType, 1, -1);
     }
-    for (int k = 0; k < 3; k++)
+    else
     {
-      outDims[k] = (inDims[k]+1) / 2;  // Round up to even points
+      vtkDataObject::SetPointDataActiveScalarInfo(outInfo, outputType, 1);
     }
   }
-  for (int k = 0; k < 3; k++)
-  {
-    outExt[2*k] = 0;
-    outExt[2*k+1] = outDims[k] - 1;
-  }
-
-  // set the output information
-  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), outExt, 6);
-  outInfo->Set(vtkDataObject::SPACING(), outSpacing, 3);
-  outInfo->Set(vtkDataObject::ORIGIN(), outOrigin, 3);
 
   return 1;
 }
@@ -123,7 +142,8 @@ int vtkboneDecimateImage::RequestData(
   if (input->GetCellData()->GetScalars())
   {
     int numComp = 1;
-    int dataType = input->GetCellData()->GetScalars()->GetDataType();
+    int dataType = DecimateImageHelper::OutputType(this->ReductionMode,
+                     input->GetCellData()->GetScalars()->GetDataType());
     int dims[3];
     output->GetDimensions(dims);
     dims[0] -= 1;
@@ -155,7 +175,8 @@ int vtkboneDecimateImage::RequestData(
   }
   else
   {
-    output->AllocateScalars(outInfo);
+    output->AllocateScalars(DecimateImageHelper::OutputType(this->ReductionMode,
+                              input->GetPointData()->GetScalars()->GetDataType()), 1);
   }
 
   return this->SimpleExecute(input, output);
@@ -165,34 +186,9 @@ int vtkboneDecimateImage::RequestData(
 void vtkboneDecimateImage::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
-}
-
-template <typename T>
-void ImplementDataCopy (
-  T* iptr,
-  int idims[3],
-  T* optr,
-  int odims[3])
-{
-  n88::array<3,T> in(iptr, n88::tuplet<3,size_t>(idims[2],idims[1],idims[0]));
-  n88::array<3,T> out(optr, n88::tuplet<3,size_t>(odims[2],odims[1],odims[0]));
-
-  out.zero();
-
-  // Output value is maximum in 2x2x2 input equivalent volume.
-  for (int k=0; k<idims[2]; ++k)
-  {
-    int kk = k/2;
-    for (int j=0; j<idims[1]; ++j)
-    {
-      int jj = j/2;
-      for (int i=0; i<idims[0]; ++i)
-      {
-        int ii = i/2;
-        out(kk,jj,ii) = std::max(out(kk,jj,ii),in(k,j,i));
-      }
-    }
-  }
+  os << indent << "DecimationFactors: " << this->DecimationFactors[0] << ", "
+     << this->DecimationFactors[1] << ", " << this->DecimationFactors[2] << "\n";
+  os << indent << "ReductionMode: " << this->ReductionMode << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -218,52 +214,20 @@ int vtkboneDecimateImage::SimpleExecute(vtkImageData* input, vtkImageData* outpu
     odata = output->GetPointData()->GetScalars();
   }
 
-  void* iraw = idata->WriteVoidPointer(0,0);
+  const void* iraw = idata->GetVoidPointer(0);
   void* oraw = odata->WriteVoidPointer(0,0);
 
-  n88_assert(idata->GetDataType() == odata->GetDataType());
+  n88_assert(odata->GetDataType() ==
+             DecimateImageHelper::OutputType(this->ReductionMode, idata->GetDataType()));
   n88_assert(idata->GetNumberOfTuples() == idims[0]*idims[1]*idims[2]);
   n88_assert(odata->GetNumberOfTuples() == odims[0]*odims[1]*odims[2]);
 
-  switch (idata->GetDataType())
+  if (!DecimateImageHelper::Decimate(iraw, idata->GetDataType(), idims,
+                                     oraw, odims, this->DecimationFactors,
+                                     this->ReductionMode))
   {
-    case VTK_FLOAT:
-      ImplementDataCopy (reinterpret_cast<float*>(iraw), idims,
-                         reinterpret_cast<float*>(oraw), odims);
-      break;
-    case VTK_DOUBLE:
-      ImplementDataCopy (reinterpret_cast<double*>(iraw), idims,
-                         reinterpret_cast<double*>(oraw), odims);
-      break;
-    case VTK_CHAR:
-    case VTK_SIGNED_CHAR:
-      ImplementDataCopy (reinterpret_cast<char*>(iraw), idims,
-                         reinterpret_cast<char*>(oraw), odims);
-      break;
-    case VTK_UNSIGNED_CHAR:
-      ImplementDataCopy (reinterpret_cast<unsigned char*>(iraw), idims,
-                         reinterpret_cast<unsigned char*>(oraw), odims);
-      break;
-    case VTK_SHORT:
-      ImplementDataCopy (reinterpret_cast<short*>(iraw), idims,
-                         reinterpret_cast<short*>(oraw), odims);
-      break;
-    case VTK_UNSIGNED_SHORT:
-      ImplementDataCopy (reinterpret_cast<unsigned short*>(iraw), idims,
-                         reinterpret_cast<unsigned short*>(oraw), odims);
-      break;
-    case VTK_INT:
-      ImplementDataCopy (reinterpret_cast<int*>(iraw), idims,
-                         reinterpret_cast<int*>(oraw), odims);
-      break;
-    case VTK_UNSIGNED_INT:
-      ImplementDataCopy (reinterpret_cast<unsigned int*>(iraw), idims,
-                         reinterpret_cast<unsigned int*>(oraw), odims);
-      break;
-    default:
-      vtkErrorMacro("Unhandled data type in vtkboneDecimateImage.");
-      return 0;
-      break;
+    vtkErrorMacro("Unhandled data type in vtkboneDecimateImage.");
+    return 0;
   }
 
   return 1;
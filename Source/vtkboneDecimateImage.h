@@ -12,7 +12,7 @@
 =========================================================================*/
 
 /*! @class   vtkboneDecimateImage
-    @brief   Reduces the linear dimension by 2 in such a way that values in the input are not interpolated.
+    @brief   Reduces the linear dimensions by integer factors in such a way that values in the input are not interpolated.
 
 
  Reduces the linear dimension of an image by a factor 2 (thus 8 for the number of voxels),
@@ -25,6 +25,16 @@
  If the image has any odd dimensions, it is padded out to an even dimension by duplicating
  the outer-most layer of voxels.
 
+ Other integer factors may be set for each axis with SetDecimationFactors,
+ and other reductions of the block of voxels with SetReductionMode.  Each
+ output voxel is computed in a single pass over the input, so that
+ decimating by 4 directly is cheaper than decimating by 2 twice.  Where a
+ dimension is not a multiple of the factor, the last output layer is
+ reduced over the remaining input voxels.
+
+ The maximum is computed with SSE2 vector instructions where available,
+ and output slices are computed in parallel with vtkSMPTools.
+
  In general, it is preferable to use vtkboneCoarsenModel after generating a FE model,
  as that class can interpolate material properties, as it has access to the
  material definitions.
@@ -46,10 +56,42 @@ public:
   vtkTypeMacro(vtkboneDecimateImage,vtkImageAlgorithm);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
+  enum ReductionMode_t {
+    MAXIMUM,
+    MEAN,
+    MAJORITY,
+    OCCUPANCY_FRACTION
+  };
+
+  //@{
+  /*! Set/Get the decimation factor along each axis. The default is 2,2,2. */
+  vtkSetVector3Macro(DecimationFactors, int);
+  vtkGetVector3Macro(DecimationFactors, int);
+  //@}
+
+  //@{
+  /*! Set/Get the reduction of each block of input voxels to an output voxel.
+      MAXIMUM (the default) takes the maximum value. MAJORITY takes the most
+      frequent value, with ties going to the larger value; it is suitable for
+      material IDs. MEAN takes the mean value, as float (double for double
+      input). OCCUPANCY_FRACTION takes the fraction of non-zero voxels, as
+      float; it is suitable for partial-volume material assignment. */
+  vtkSetClampMacro(ReductionMode, int, MAXIMUM, OCCUPANCY_FRACTION);
+  vtkGetMacro(ReductionMode, int);
+  void SetReductionModeToMaximum()
+    {this->SetReductionMode(MAXIMUM);};
+  void SetReductionModeToMean()
+    {this->SetReductionMode(MEAN);};
+  void SetReductionModeToMajority()
+    {this->SetReductionMode(MAJORITY);};
+  void SetReductionModeToOccupancyFraction()
+    {this->SetReductionMode(OCCUPANCY_FRACTION);};
+  //@}
+
 protected:
 
-  vtkboneDecimateImage() {}
-  ~vtkboneDecimateImage() {}
+  vtkboneDecimateImage();
+  ~vtkboneDecimateImage();
 
   virtual int RequestInformation(vtkInformation *, vtkInformationVector **,
                                  vtkInformationVector *) override;
@@ -60,6 +102,9 @@ protected:
 
   virtual int SimpleExecute(vtkImageData* input, vtkImageData* output);
 
+  int DecimationFactors[3];
+  int ReductionMode;
+
 private:
   vtkboneDecimateImage(const vtkboneDecimateImage&);  // Not implemented.
   void operator=(const vtkboneDecimateImage&);  // Not implemented.
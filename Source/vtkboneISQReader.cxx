@@ -9,15 +9,74 @@
 #include "vtkInformationVector.h"
 #include "vtkInformation.h"
 #include "vtkInformationIntegerKey.h"
+#include "vtkInformationIntegerVectorKey.h"
+#include "vtkInformationDoubleVectorKey.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkSmartPointer.h"
 #include "AimIO/AimIO.h"
 #include "AimIO/IsqIO.h"
+#include "FileHeaderCache.h"
+#include "ScancoFileHelper.h"
 #include <cassert>
+#include <stdexcept>
 
 
+namespace ISQReader_Utility
+{
+
+// The header information used by the reader.
+struct ISQHeader
+{
+  int dimensions[3];
+  double element_size[3];
+  int scalar_type;   // -1 if not a supported ISQ type.
+  unsigned long long data_offset;
+};
+
+// Parses the header of filename.  Throws on error.
+bool parse_header (const char* filename, ISQHeader& header)
+{
+  AimIO::IsqFile reader;
+  reader.filename = filename;
+  reader.ReadImageInfo();
+  header.dimensions[0] = reader.dimensions_p[0];
+  header.dimensions[1] = reader.dimensions_p[1];
+  header.dimensions[2] = reader.dimensions_p[2];
+  header.element_size[0] = reader.slice_increment_um;
+  header.element_size[1] = reader.slice_increment_um;
+  header.element_size[2] = reader.slice_thickness_um;
+  switch (reader.buffer_type)
+  {
+    case AimIO::IsqFile::ISQFILE_TYPE_SHORT:
+      header.scalar_type = VTK_SHORT;
+      break;
+    default:
+      header.scalar_type = -1;
+  }
+  if (!ScancoFileHelper::FindISQDataBlock (filename, header.data_offset)) {
+    throw std::runtime_error ("Unable to locate ISQ data."); }
+  return true;
+}
+
+FileHeaderCache<ISQHeader> header_cache;
+
+// Returns the header of filename, parsing the file only if required.
+// Throws on error.
+bool read_header (const char* filename, ISQHeader& header)
+{
+  return header_cache.Read (filename, header, parse_header);
+}
+
+}  // namespace ISQReader_Utility
+
+using namespace ISQReader_Utility;
+
 vtkStandardNewMacro (vtkboneISQReader);
 
+vtkInformationKeyMacro (vtkboneISQReader, DIMENSION, IntegerVector);
+vtkInformationKeyMacro (vtkboneISQReader, ELEMENT_SIZE, DoubleVector);
+vtkInformationKeyMacro (vtkboneISQReader, SCALAR_TYPE, Integer);
+
 //-----------------------------------------------------------------------
 vtkboneISQReader::vtkboneISQReader()
 {
@@ -73,12 +132,10 @@ int vtkboneISQReader::RequestInformation (
     return 0;
   }
 
-  AimIO::IsqFile reader;
-
-  reader.filename = this->FileName;
+  ISQHeader header;
   try
   {
-    reader.ReadImageInfo();
+    read_header (this->FileName, header);
   }
   catch (const std::exception& e)
   {
@@ -86,12 +143,11 @@ int vtkboneISQReader::RequestInformation (
     return 0;
   }
 
-  this->ElementSize[0] = reader.slice_increment_um;
-  this->ElementSize[1] = reader.slice_increment_um;
-  this->ElementSize[2] = reader.slice_thickness_um;
-  this->Dimension[0] = reader.dimensions_p[0];
-  this->Dimension[1] = reader.dimensions_p[1];
-  this->Dimension[2] = reader.dimensions_p[2];
+  for (int i=0; i<3; ++i)
+  {
+    this->ElementSize[i] = header.element_size[i];
+    this->Dimension[i] = header.dimensions[i];
+  }
 
   if (DataOnCells == -1)
   {
@@ -104,41 +160,37 @@ int vtkboneISQReader::RequestInformation (
   // This is so that rendering will be in consistent frames.
 
   double spacing[3];
-  spacing[0] = reader.slice_increment_um;
-  spacing[1] = reader.slice_increment_um;
-  spacing[2] = reader.slice_thickness_um;
+  spacing[0] = header.element_size[0];
+  spacing[1] = header.element_size[1];
+  spacing[2] = header.element_size[2];
 
   int extent[6];
   double origin[3];
   if (DataOnCells == 0)  // on Points
   {
-    extent[0] = 0;   extent[1] = reader.dimensions_p[0] - 1;
-    extent[2] = 0;   extent[3] = reader.dimensions_p[1] - 1;
-    extent[4] = 0;   extent[5] = reader.dimensions_p[2] - 1;
+    extent[0] = 0;   extent[1] = header.dimensions[0] - 1;
+    extent[2] = 0;   extent[3] = header.dimensions[1] - 1;
+    extent[4] = 0;   extent[5] = header.dimensions[2] - 1;
 
-    origin[0] = (0.5) * reader.slice_increment_um;
-    origin[1] = (0.5) * reader.slice_increment_um;
-    origin[2] = (0.5) * reader.slice_thickness_um;
+    origin[0] = (0.5) * header.element_size[0];
+    origin[1] = (0.5) * header.element_size[1];
+    origin[2] = (0.5) * header.element_size[2];
   }
   else // on Cells
   {
-    extent[0] = 0;   extent[1] = reader.dimensions_p[0];
-    extent[2] = 0;   extent[3] = reader.dimensions_p[1];
-    extent[4] = 0;   extent[5] = reader.dimensions_p[2];
+    extent[0] = 0;   extent[1] = header.dimensions[0];
+    extent[2] = 0;   extent[3] = header.dimensions[1];
+    extent[4] = 0;   extent[5] = header.dimensions[2];
 
-    origin[0] = reader.slice_increment_um;
-    origin[1] = reader.slice_increment_um;
-    origin[2] = reader.slice_thickness_um;
+    origin[0] = header.element_size[0];
+    origin[1] = header.element_size[1];
+    origin[2] = header.element_size[2];
   }
 
-  int scalarType;
-  switch (reader.buffer_type)
+  int scalarType = header.scalar_type;
+  if (scalarType == -1)
   {
-    case AimIO::IsqFile::ISQFILE_TYPE_SHORT:
-      scalarType = VTK_SHORT;
-      break;
-    default:
-      vtkErrorMacro(<< "Unknown ISQ data type.");
+    vtkErrorMacro(<< "Unknown ISQ data type.");
   }
 
   // get the info objects
@@ -157,6 +209,7 @@ int vtkboneISQReader::RequestInformation (
   outInfo->Set (vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
   outInfo->Set (vtkDataObject::SPACING(), spacing, 3);
   outInfo->Set (vtkDataObject::ORIGIN(), origin, 3);
+  outInfo->Set (vtkAlgorithm::CAN_PRODUCE_SUB_EXTENT(), 1);
 
   return 1;
 }
@@ -172,11 +225,11 @@ int vtkboneISQReader::RequestData (vtkInformation*,
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
   vtkImageData* out = vtkImageData::GetData (outputVector);
 
-  AimIO::IsqFile reader;
-  reader.filename = this->FileName;
+  // The header is normally cached from RequestInformation.
+  ISQHeader header;
   try
   {
-    reader.ReadImageInfo();
+    read_header (this->FileName, header);
   }
   catch (const std::exception& e)
   {
@@ -186,22 +239,20 @@ int vtkboneISQReader::RequestData (vtkInformation*,
 
   this->UpdateProgress(.70);
 
-  vtkIdType N = long_product (reader.dimensions_p);
-
+  // Only the requested extent is read.
   int extent[6];
-  if (DataOnCells == 0)  // on Points
-  {
-    extent[0] = 0;   extent[1] = reader.dimensions_p[0] - 1;
-    extent[2] = 0;   extent[3] = reader.dimensions_p[1] - 1;
-    extent[4] = 0;   extent[5] = reader.dimensions_p[2] - 1;
-  }
-  else // on Cells
+  outInfo->Get (vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent);
+  out->SetExtent(extent);
+
+  int voxelExtent[6];
+  for (int i=0; i<3; ++i)
   {
-    extent[0] = 0;   extent[1] = reader.dimensions_p[0];
-    extent[2] = 0;   extent[3] = reader.dimensions_p[1];
-    extent[4] = 0;   extent[5] = reader.dimensions_p[2];
+    voxelExtent[2*i] = extent[2*i];
+    voxelExtent[2*i+1] = (DataOnCells == 0) ? extent[2*i+1] : extent[2*i+1] - 1;
   }
-  out->SetExtent(extent);
+  vtkIdType N = vtkIdType(voxelExtent[1] - voxelExtent[0] + 1) *
+                vtkIdType(voxelExtent[3] - voxelExtent[2] + 1) *
+                vtkIdType(voxelExtent[5] - voxelExtent[4] + 1);
 
   vtkSmartPointer<vtkDataArray> dataArray;
 
@@ -227,11 +278,12 @@ int vtkboneISQReader::RequestData (vtkInformation*,
       vtkSmartPointer<vtkShortArray> sarray = vtkSmartPointer<vtkShortArray>::New();
       sarray->SetNumberOfComponents(1);
       sarray->SetNumberOfValues(N);
-      try
-      {
-        reader.ReadImageData((short*)(sarray->WriteVoidPointer(0,N)), N);
-      }
-      catch (const std::exception& e)
+      // ISQ data is never compressed, so it is read directly using the
+      // cached header; for a sub-extent only the required rows are read.
+      if (N > 0 &&
+          !ScancoFileHelper::ReadRawSubVolume (this->FileName, header.data_offset,
+                  sizeof(short), header.dimensions, voxelExtent,
+                  sarray->GetPointer(0)))
       {
         vtkErrorMacro(<< "Error reading " << this->FileName);
         return 0;
@@ -263,3 +315,31 @@ int vtkboneISQReader::RequestData (vtkInformation*,
 
   return 1;
 }
+
+//----------------------------------------------------------------------------
+int vtkboneISQReader::ReadHeader (const char* filename, vtkInformation* info)
+{
+  if (filename == NULL || info == NULL)
+  {
+    return 0;
+  }
+  ISQHeader header;
+  try
+  {
+    read_header (filename, header);
+  }
+  catch (const std::exception& e)
+  {
+    return 0;
+  }
+  info->Set (DIMENSION(), header.dimensions, 3);
+  info->Set (ELEMENT_SIZE(), header.element_size, 3);
+  info->Set (SCALAR_TYPE(), header.scalar_type);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkboneISQReader::ClearHeaderCache ()
+{
+  header_cache.Clear();
+}
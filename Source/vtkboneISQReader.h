@@ -34,6 +34,14 @@
  that most VTK filters which take vtkImageData as input expect the data
  to be on the Points; VTKBONE filters generally accept input images with
  either on the Points or on the Cells.
+
+ Only the requested update extent is read, so that downstream filters that
+ crop or stream the image do not pay for reading the whole file.
+
+ Parsed headers are cached (for the process), keyed on the file name,
+ size and modification time, so that a file header is parsed only once,
+ however many times it is required.  ReadHeader gives fast access to the
+ header information without creating a pipeline.
 */
 
 #ifndef __vtkboneISQReader_h
@@ -49,6 +57,9 @@
 // Forward declarations
 class vtkImageData;
 class vtkMath;
+class vtkInformationIntegerKey;
+class vtkInformationIntegerVectorKey;
+class vtkInformationDoubleVectorKey;
 
 class VTKBONE_EXPORT vtkboneISQReader : public vtkImageAlgorithm
 {
@@ -90,6 +101,22 @@ public:
   vtkGetVector3Macro(ElementSize, double);
   //@}
 
+  //@{
+  /*! Keys for the header information returned by ReadHeader.
+      SCALAR_TYPE is the VTK type of the data, or -1 if not supported. */
+  static vtkInformationIntegerVectorKey* DIMENSION();
+  static vtkInformationDoubleVectorKey* ELEMENT_SIZE();
+  static vtkInformationIntegerKey* SCALAR_TYPE();
+  //@}
+
+  /*! Reads only the header of an ISQ file, into info using the keys
+      above.  The image data is not read.  Returns 1 on success, 0 on
+      error. */
+  static int ReadHeader(const char* filename, vtkInformation* info);
+
+  /*! Discards all cached headers. */
+  static void ClearHeaderCache();
+
 protected:
   vtkboneISQReader();
   ~vtkboneISQReader();
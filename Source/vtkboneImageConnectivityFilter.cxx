@@ -17,12 +17,24 @@
 #include "vtkIdTypeArray.h"
 #include "vtkLongLongArray.h"
 #include "vtkUnsignedLongLongArray.h"
+#include "vtkDoubleArray.h"
 #include "vtkIdList.h"
+#include "vtkTable.h"
 #include "vtkSmartPointer.h"
+#include <cmath>
 #include <limits>
+#include <vector>
 
 vtkStandardNewMacro(vtkboneImageConnectivityFilter);
 
+static_assert(int(vtkboneImageConnectivityFilter::FACE_CONNECTIVITY) ==
+              int(vtkboneImageConnectivityMap::FACE_CONNECTIVITY) &&
+              int(vtkboneImageConnectivityFilter::EDGE_CONNECTIVITY) ==
+              int(vtkboneImageConnectivityMap::EDGE_CONNECTIVITY) &&
+              int(vtkboneImageConnectivityFilter::VERTEX_CONNECTIVITY) ==
+              int(vtkboneImageConnectivityMap::VERTEX_CONNECTIVITY),
+              "Connectivity values must match vtkboneImageConnectivityMap");
+
 template <typename T> T sqr(const T x) {return x*x;}
 
 //-----------------------------------------------------------------------
@@ -63,10 +75,12 @@ vtkboneImageConnectivityFilter::vtkboneImageConnectivityFilter()
 :
   ExtractionMode (EXTRACT_LARGEST_REGION),
   MinimumRegionSize (1),
+  Connectivity (FACE_CONNECTIVITY),
   NumberOfExtractedRegions (0)
 {
   this->Seeds = vtkIdList::New();
   this->SpecifiedRegionIds = vtkIdList::New();
+  this->RegionStatistics = vtkTable::New();
   this->ClosestPoint[0] = 0;
   this->ClosestPoint[1] = 0;
   this->ClosestPoint[2] = 0;
@@ -77,6 +91,7 @@ vtkboneImageConnectivityFilter::~vtkboneImageConnectivityFilter()
 {
   if (Seeds) Seeds->Delete();
   if (SpecifiedRegionIds) SpecifiedRegionIds->Delete();
+  if (RegionStatistics) RegionStatistics->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -91,6 +106,25 @@ void vtkboneImageConnectivityFilter::PrintSelf(ostream& os, vtkIndent indent)
      << this->ClosestPoint[1] << ", " << this->ClosestPoint[2] << ")\n";
 
   os << indent << "MinimumRegionSize: " << this->MinimumRegionSize << "\n";
+
+  os << indent << "Connectivity: " << this->Connectivity << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkboneImageConnectivityFilter::SetConnectivity(int connectivity)
+{
+  if (connectivity != FACE_CONNECTIVITY &&
+      connectivity != EDGE_CONNECTIVITY &&
+      connectivity != VERTEX_CONNECTIVITY)
+  {
+    vtkErrorMacro(<< "Connectivity must be 6, 18 or 26.");
+    return;
+  }
+  if (connectivity != this->Connectivity)
+  {
+    this->Connectivity = connectivity;
+    this->Modified();
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -188,26 +222,6 @@ int vtkboneImageConnectivityFilter::RequestData(
   return 1;
 }
 
-//----------------------------------------------------------------------------
-int vtkboneImageConnectivityFilter::CalculateRegionSizes
-(
-  vtkUnsignedIntArray* cmap_data,
-  unsigned int numRegions,
-  vtkIdTypeArray* regionSizes
-)
-{
-  regionSizes->SetNumberOfTuples (numRegions+1);
-  for (int r=0; r<numRegions+1; ++r)
-    { regionSizes->SetValue(r,0); }
-  vtkIdType numPts = cmap_data->GetNumberOfTuples();
-  for (vtkIdType i=0; i<numPts; ++i)
-  {
-    unsigned int r = cmap_data->GetValue(i);
-    regionSizes->SetValue (r, regionSizes->GetValue(r) + 1);
-  }
-  return VTK_OK;
-}
-
 //----------------------------------------------------------------------------
 void vtkboneImageConnectivityFilter::SimpleExecute
   (vtkImageData* input_image,
@@ -241,14 +255,14 @@ void vtkboneImageConnectivityFilter::SimpleExecute
   if (numPts == 0) return;
 
   // Zero the output.
-  for (vtkIdType i=0; i<numPts; ++i)
-  {
-    out_data->SetTuple1 (i, 0);
-  }
+  out_data->Fill(0);
+  this->RegionStatistics->Initialize();
 
   vtkSmartPointer<vtkboneImageConnectivityMap> connectivityMapper =
                         vtkSmartPointer<vtkboneImageConnectivityMap>::New();
   connectivityMapper->SetInputData (input_image);
+  connectivityMapper->SetConnectivity (this->Connectivity);
+  connectivityMapper->SetClosestPoint (this->ClosestPoint);
   connectivityMapper->Update();
   vtkImageData* cmap = connectivityMapper->GetOutput();
   vtkUnsignedIntArray* cmap_data = vtkUnsignedIntArray::SafeDownCast(cmap->GetCellData()->GetScalars());
@@ -271,17 +285,27 @@ void vtkboneImageConnectivityFilter::SimpleExecute
   // Return an empty result if no regions
   if (numRegions == 0) return;
 
+  // All of the following modes use the region statistics collected
+  // while labelling, and do not need to scan the image again.
+  vtkTable* statistics = connectivityMapper->GetRegionStatistics();
+  this->RegionStatistics->ShallowCopy(statistics);
+  vtkIdTypeArray* regionSizes = vtkIdTypeArray::SafeDownCast(
+                                  statistics->GetColumnByName("VoxelCount"));
+  if (regionSizes == NULL || regionSizes->GetNumberOfTuples() != vtkIdType(numRegions))
+  {
+    vtkErrorMacro (<< "Internal error in vtkboneImageConnectivityFilter");
+    return;
+  }
+
   if (this->ExtractionMode == EXTRACT_LARGEST_REGION)
   {
-    vtkSmartPointer<vtkIdTypeArray> regionSizes = vtkSmartPointer<vtkIdTypeArray>::New();
-    this->CalculateRegionSizes(cmap_data, numRegions, regionSizes);
     unsigned int largestRegion = 0;
     vtkIdType largestSize = 0;
-    for (int r=1; r<numRegions+1; ++r)
+    for (unsigned int r=1; r<numRegions+1; ++r)
     {
-      if (regionSizes->GetValue(r) > largestSize)
+      if (regionSizes->GetValue(r-1) > largestSize)
       {
-        largestSize = regionSizes->GetValue(r);
+        largestSize = regionSizes->GetValue(r-1);
         largestRegion = r;
       }
     }
@@ -297,7 +321,7 @@ void vtkboneImageConnectivityFilter::SimpleExecute
   if (this->ExtractionMode == EXTRACT_ALL_REGIONS)
   {
     this->SpecifiedRegionIds->SetNumberOfIds(numRegions);
-    for (int r=0; r<numRegions; ++r)
+    for (unsigned int r=0; r<numRegions; ++r)
     {
       this->SpecifiedRegionIds->SetId(r,r+1);
     }
@@ -305,12 +329,10 @@ void vtkboneImageConnectivityFilter::SimpleExecute
 
   if (this->ExtractionMode == EXTRACT_REGIONS_OF_SPECIFIED_SIZE)
   {
-    vtkSmartPointer<vtkIdTypeArray> regionSizes = vtkSmartPointer<vtkIdTypeArray>::New();
-    this->CalculateRegionSizes(cmap_data, numRegions, regionSizes);
     this->SpecifiedRegionIds->SetNumberOfIds(0);
-    for (int r=1; r<numRegions+1; ++r)
+    for (unsigned int r=1; r<numRegions+1; ++r)
     {
-      if (regionSizes->GetValue(r) >= this->MinimumRegionSize)
+      if (regionSizes->GetValue(r-1) >= this->MinimumRegionSize)
       {
         this->SpecifiedRegionIds->InsertNextId(r);
       }
@@ -319,49 +341,41 @@ void vtkboneImageConnectivityFilter::SimpleExecute
 
   if (this->ExtractionMode == EXTRACT_CLOSEST_POINT_REGION)
   {
+    vtkDoubleArray* distances = vtkDoubleArray::SafeDownCast(
+                        statistics->GetColumnByName("ClosestPointDistance"));
+    vtkIdTypeArray* closestVoxels = vtkIdTypeArray::SafeDownCast(
+                        statistics->GetColumnByName("ClosestVoxel"));
+    if (distances == NULL || closestVoxels == NULL)
+    {
+      vtkErrorMacro (<< "Internal error in vtkboneImageConnectivityFilter");
+      return;
+    }
     int dims[3];
-    double origin[3];
     double spacing[3];
     input_image->GetDimensions(dims);
-    input_image->GetOrigin(origin);
     input_image->GetSpacing(spacing);
     if (input_image->GetCellData()->GetScalars())
     {
       --dims[0];
       --dims[1];
       --dims[2];
-      origin[0] += 0.5*spacing[0];
-      origin[1] += 0.5*spacing[1];
-      origin[2] += 0.5*spacing[2];
     }
-    double x[3];
-    vtkIdType index = 0;
-    x[2] = origin[2] - this->ClosestPoint[2];
-    double closestDistance2 = sqr(dims[0]*spacing[0]) + sqr(dims[1]*spacing[1]) + sqr(dims[2]*spacing[2]);
+    // Only regions closer than the image diagonal are considered. Ties go
+    // to the region whose closest voxel is first in raster order.
+    double closestDistance = sqrt(sqr(dims[0]*spacing[0]) + sqr(dims[1]*spacing[1]) + sqr(dims[2]*spacing[2]));
+    vtkIdType closestVoxel = numPts;
     unsigned int closestRegion = 0;
-    for (int k=0; k<dims[2]; ++k)
+    for (unsigned int r=1; r<numRegions+1; ++r)
     {
-      x[1] = origin[1] - this->ClosestPoint[1];
-      for (int j=0; j<dims[1]; ++j)
+      double distance = distances->GetValue(r-1);
+      vtkIdType voxel = closestVoxels->GetValue(r-1);
+      if (distance < closestDistance ||
+          (distance == closestDistance && closestRegion != 0 && voxel < closestVoxel))
       {
-        x[0] = origin[0] - this->ClosestPoint[0];
-        for (int i=0; i<dims[0]; ++i)
-        {
-          if (cmap_data->GetValue(index) != 0)
-          {
-            double dist2 = sqr(x[0]) + sqr(x[1]) + sqr(x[2]);
-            if (dist2 < closestDistance2)
-            {
-              closestDistance2 = dist2;
-              closestRegion = cmap_data->GetValue(index);
-            }
-          }
-          x[0] += spacing[0];
-          ++index;
-        }
-        x[1] += spacing[1];
+        closestDistance = distance;
+        closestVoxel = voxel;
+        closestRegion = r;
       }
-      x[2] += spacing[2];
     }
     this->SpecifiedRegionIds->SetNumberOfIds(1);
     this->SpecifiedRegionIds->SetId(0,closestRegion);
@@ -387,16 +401,21 @@ void vtkboneImageConnectivityFilter::SimpleExecute
   this->NumberOfExtractedRegions = this->SpecifiedRegionIds->GetNumberOfIds();
 
   // Now copy input to output for all the specified regions
+  std::vector<char> extract(numRegions+1, 0);
+  for (unsigned int r=0; r<this->NumberOfExtractedRegions; ++r)
+  {
+    vtkIdType regionId = this->SpecifiedRegionIds->GetId(r);
+    if (regionId > 0 && regionId <= vtkIdType(numRegions))
+    {
+      extract[regionId] = 1;
+    }
+  }
+  const unsigned int* regions = cmap_data->GetPointer(0);
   for (vtkIdType i=0; i<numPts; ++i)
   {
-    for (unsigned int r=0; r<this->NumberOfExtractedRegions; ++r)
+    if (extract[regions[i]])
     {
-      unsigned int regionId = cmap_data->GetValue(i);
-      if (regionId == this->SpecifiedRegionIds->GetId(r))
-      {
-        out_data->SetTuple (i, i, in_data);
-        break;
-      }
+      out_data->SetTuple (i, i, in_data);
     }
   }
 
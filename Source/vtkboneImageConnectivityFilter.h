@@ -23,6 +23,13 @@
  This filter accepts image scalars on either the cells or the points; the
  output will have scalars with the same association.
 
+ Connectivity may be across faces (6), faces and edges (18) or faces,
+ edges and corners (26); see vtkboneImageConnectivityMap.
+
+ The extraction modes are evaluated from the region statistics collected
+ by vtkboneImageConnectivityMap while labelling, without further passes
+ over the image. The statistics are available from GetRegionStatistics.
+
 */
 
 #ifndef __vtkboneImageConnectivityFilter_h
@@ -35,6 +42,7 @@
 class vtkUnsignedIntArray;
 class vtkIdList;
 class vtkIdTypeArray;
+class vtkTable;
 
 class VTKBONE_EXPORT vtkboneImageConnectivityFilter : public vtkSimpleImageToImageFilter
 {
@@ -107,11 +115,39 @@ public:
   vtkGetMacro(MinimumRegionSize,vtkIdType);
   //@}
 
+  // These match the values in vtkboneImageConnectivityMap
+  enum Connectivity_t {
+    FACE_CONNECTIVITY = 6,
+    EDGE_CONNECTIVITY = 18,
+    VERTEX_CONNECTIVITY = 26
+  };
+
+  //@{
+  /*! Set/Get the connectivity: 6, 18 or 26. The default is 6.
+      See vtkboneImageConnectivityMap::SetConnectivity. */
+  void SetConnectivity(int connectivity);
+  vtkGetMacro(Connectivity, int);
+  void SetConnectivityToFaces()
+    {this->SetConnectivity(FACE_CONNECTIVITY);};
+  void SetConnectivityToEdges()
+    {this->SetConnectivity(EDGE_CONNECTIVITY);};
+  void SetConnectivityToVertices()
+    {this->SetConnectivity(VERTEX_CONNECTIVITY);};
+  //@}
+
   //@{
   /*! Obtain the number of connected regions. */
   vtkGetMacro(NumberOfExtractedRegions,unsigned int);
   //@}
 
+  //@{
+  /*! Return the statistics of all the regions (not only the extracted
+      ones) found in the last update. Row r-1 corresponds to region r.
+      See vtkboneImageConnectivityMap for the columns; ClosestPointDistance
+      is relative to ClosestPoint. */
+  vtkGetObjectMacro(RegionStatistics, vtkTable);
+  //@}
+
 protected:
   vtkboneImageConnectivityFilter();
   ~vtkboneImageConnectivityFilter();
@@ -122,16 +158,13 @@ protected:
 
   virtual void SimpleExecute(vtkImageData*, vtkImageData*) override;
 
-  int CalculateRegionSizes(
-    vtkUnsignedIntArray* cmap_data,
-    unsigned int numRegions,
-    vtkIdTypeArray* regionSizes);
-
   int ExtractionMode; //how to extract regions
   vtkIdList *Seeds; //id's of points or cells used to seed regions
   vtkIdList *SpecifiedRegionIds; //regions specified for extraction
   double ClosestPoint[3];
   vtkIdType MinimumRegionSize;
+  vtkTable *RegionStatistics;
+  int Connectivity;
 
   unsigned int NumberOfExtractedRegions;
 
@@ -18,27 +18,67 @@
 #include "vtkUnsignedLongLongArray.h"
 #include "vtkFloatArray.h"
 #include "vtkDoubleArray.h"
-#include "vtkIdList.h"
+#include "vtkTable.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VTKBONE_CONNECTIVITY_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
 vtkStandardNewMacro(vtkboneImageConnectivityMap);
 
 //-----------------------------------------------------------------------
 vtkboneImageConnectivityMap::vtkboneImageConnectivityMap()
 {
+  this->Connectivity = FACE_CONNECTIVITY;
+  this->ClosestPoint[0] = 0;
+  this->ClosestPoint[1] = 0;
+  this->ClosestPoint[2] = 0;
   this->NumberOfRegions = 0;
+  this->RegionStatistics = vtkTable::New();
 }
 
 //----------------------------------------------------------------------------
 vtkboneImageConnectivityMap::~vtkboneImageConnectivityMap()
 {
+  this->RegionStatistics->Delete();
 }
 
 //----------------------------------------------------------------------------
 void vtkboneImageConnectivityMap::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "Connectivity: " << this->Connectivity << "\n";
+  os << indent << "Closest Point: (" << this->ClosestPoint[0] << ", "
+     << this->ClosestPoint[1] << ", " << this->ClosestPoint[2] << ")\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkboneImageConnectivityMap::SetConnectivity(int connectivity)
+{
+  if (connectivity != FACE_CONNECTIVITY &&
+      connectivity != EDGE_CONNECTIVITY &&
+      connectivity != VERTEX_CONNECTIVITY)
+  {
+    vtkErrorMacro(<< "Connectivity must be 6, 18 or 26.");
+    return;
+  }
+  if (connectivity != this->Connectivity)
+  {
+    this->Connectivity = connectivity;
+    this->Modified();
+  }
 }
 
 
@@ -150,40 +190,40 @@ void vtkboneImageConnectivityMap::SimpleExecute
   switch (in_data->GetDataType())
   {
     case VTK_CHAR:
-      returnVal = this->GenerateConnectivityMap<vtkCharArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkCharArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_UNSIGNED_CHAR:
-      returnVal = this->GenerateConnectivityMap<vtkUnsignedCharArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkUnsignedCharArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_SIGNED_CHAR:
-      returnVal = this->GenerateConnectivityMap<vtkSignedCharArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkSignedCharArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_SHORT:
-      returnVal = this->GenerateConnectivityMap<vtkShortArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkShortArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_UNSIGNED_SHORT:
-      returnVal = this->GenerateConnectivityMap<vtkUnsignedShortArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkUnsignedShortArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_INT:
-      returnVal = this->GenerateConnectivityMap<vtkIntArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkIntArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_UNSIGNED_INT:
-      returnVal = this->GenerateConnectivityMap<vtkUnsignedIntArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkUnsignedIntArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_ID_TYPE:
-      returnVal = this->GenerateConnectivityMap<vtkIdTypeArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkIdTypeArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_LONG_LONG:
-      returnVal = this->GenerateConnectivityMap<vtkLongLongArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkLongLongArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_UNSIGNED_LONG_LONG:
-      returnVal = this->GenerateConnectivityMap<vtkUnsignedLongLongArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkUnsignedLongLongArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_FLOAT:
-      returnVal = this->GenerateConnectivityMap<vtkFloatArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkFloatArray> (input_image, in_data, dims, cmap);
       break;
     case VTK_DOUBLE:
-      returnVal = this->GenerateConnectivityMap<vtkDoubleArray> (in_data, dims, cmap);
+      returnVal = this->GenerateConnectivityMap<vtkDoubleArray> (input_image, in_data, dims, cmap);
       break;
     default:
       vtkErrorMacro(<< "Unsupported data type for vtkboneImageConnectivityMap input");
@@ -192,147 +232,537 @@ void vtkboneImageConnectivityMap::SimpleExecute
   if (returnVal != VTK_OK) return;
 }
 
+namespace ImageConnectivityMap_Utility
+{
+
 //----------------------------------------------------------------------------
-template <typename TArray>
-int vtkboneImageConnectivityMap::GenerateConnectivityMap
+// Returns the index of the first voxel at or after i in row[0..n) that is
+// non-zero (if nonzero is true) or zero (if nonzero is false), or n if there
+// is no such voxel.
+template <typename T>
+inline int ConnectivityMapFindRunBoundary(const T* row, int i, int n, bool nonzero)
+{
+  for (; i<n; ++i)
+  {
+    if ((row[i] != 0) == nonzero)
+      { return i; }
+  }
+  return n;
+}
+
+#ifdef VTKBONE_CONNECTIVITY_SSE2
+
+inline int ConnectivityMapFirstSetBit(int mask)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return int(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+// For 8 and 16 bit scalars, which is what images usually are, test 16 bytes
+// at a time with SSE2 compares.
+template <int Size>
+inline int ConnectivityMapFindRunBoundarySSE2(const char* row, int i, int n, bool nonzero)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const int valuesPerBlock = 16/Size;
+  for (; i + valuesPerBlock <= n; i += valuesPerBlock)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + Size*i));
+    __m128i isZero = (Size == 1) ? _mm_cmpeq_epi8(v, zero) : _mm_cmpeq_epi16(v, zero);
+    int mask = _mm_movemask_epi8(isZero);
+    if (nonzero)
+      { mask = ~mask & 0xFFFF; }
+    if (mask)
+      { return i + ConnectivityMapFirstSetBit(mask)/Size; }
+  }
+  for (; i<n; ++i)
+  {
+    bool isNonzero = (Size == 1) ? (row[i] != 0) :
+                       (reinterpret_cast<const short*>(row)[i] != 0);
+    if (isNonzero == nonzero)
+      { return i; }
+  }
+  return n;
+}
+
+inline int ConnectivityMapFindRunBoundary(const char* row, int i, int n, bool nonzero)
+  { return ConnectivityMapFindRunBoundarySSE2<1>(row, i, n, nonzero); }
+inline int ConnectivityMapFindRunBoundary(const signed char* row, int i, int n, bool nonzero)
+  { return ConnectivityMapFindRunBoundarySSE2<1>(reinterpret_cast<const char*>(row), i, n, nonzero); }
+inline int ConnectivityMapFindRunBoundary(const unsigned char* row, int i, int n, bool nonzero)
+  { return ConnectivityMapFindRunBoundarySSE2<1>(reinterpret_cast<const char*>(row), i, n, nonzero); }
+inline int ConnectivityMapFindRunBoundary(const short* row, int i, int n, bool nonzero)
+  { return ConnectivityMapFindRunBoundarySSE2<2>(reinterpret_cast<const char*>(row), i, n, nonzero); }
+inline int ConnectivityMapFindRunBoundary(const unsigned short* row, int i, int n, bool nonzero)
+  { return ConnectivityMapFindRunBoundarySSE2<2>(reinterpret_cast<const char*>(row), i, n, nonzero); }
+
+#endif
+
+//----------------------------------------------------------------------------
+// Union-find helpers. Parent entries always point to a run with a smaller
+// index, or to the run itself for a root, so that the root of every
+// component is its first run in raster order.
+inline vtkIdType ConnectivityMapFindRoot(vtkIdType* parent, vtkIdType x)
+{
+  vtkIdType root = x;
+  while (parent[root] != root)
+    { root = parent[root]; }
+  // Path compression
+  while (parent[x] != root)
+  {
+    vtkIdType next = parent[x];
+    parent[x] = root;
+    x = next;
+  }
+  return root;
+}
+
+inline void ConnectivityMapUnion(vtkIdType* parent, vtkIdType a, vtkIdType b)
+{
+  a = ConnectivityMapFindRoot(parent, a);
+  b = ConnectivityMapFindRoot(parent, b);
+  if (a < b)
+    { parent[b] = a; }
+  else if (b < a)
+    { parent[a] = b; }
+}
+
+// Joins the runs [a,aEnd) of one row with the runs [b,bEnd) of a
+// neighbouring row. Runs are connected if they overlap after being
+// widened by tolerance (0 or 1) voxels.
+inline void ConnectivityMapUnionRows
 (
-  vtkDataArray* in_data_arg,
-  int* dims,
-  vtkUnsignedIntArray* cmap
+  const int* runBegin,
+  const int* runEnd,
+  vtkIdType* parent,
+  vtkIdType a,
+  vtkIdType aEnd,
+  vtkIdType b,
+  vtkIdType bEnd,
+  int tolerance
 )
 {
-  TArray* in_data = TArray::SafeDownCast(in_data_arg);
-  if (in_data == NULL)
+  while (a < aEnd && b < bEnd)
   {
-    vtkErrorMacro(<< "Internal error in vtkboneImageConnectivityMap");
-    return VTK_ERROR;
+    if (runBegin[a] < runEnd[b] + tolerance && runBegin[b] < runEnd[a] + tolerance)
+      { ConnectivityMapUnion(parent, a, b); }
+    if (runEnd[a] < runEnd[b])
+      { ++a; }
+    else
+      { ++b; }
   }
+}
 
-  vtkIdType numPts = vtkIdType(dims[0]) * vtkIdType(dims[1]) * vtkIdType(dims[2]);
-  cmap->SetNumberOfTuples (numPts);
-  for (vtkIdType i=0; i<numPts; ++i)
-    { cmap->SetValue(i,0); }
+// Rows preceding row (j,k) in raster order that can connect to it, and
+// the tolerance in i for each. Indexed by connectivity.
+struct ConnectivityMapRowNeighbour { int dj; int dk; int tolerance; };
+static const ConnectivityMapRowNeighbour ConnectivityMapRowNeighbours[3][4] = {
+  // 6: faces only
+  { {-1,0,0}, {0,-1,0}, {0,0,-1}, {0,0,-1} },
+  // 18: faces and edges
+  { {-1,0,1}, {0,-1,1}, {-1,-1,0}, {1,-1,0} },
+  // 26: faces, edges and vertices
+  { {-1,0,1}, {0,-1,1}, {-1,-1,1}, {1,-1,1} } };
+static const int ConnectivityMapNumberOfRowNeighbours[3] = {2, 4, 4};
 
-  vtkIdType index = 0;
-  this->NumberOfRegions = 0;
+//----------------------------------------------------------------------------
+// Geometry of the voxels, for the region statistics.
+struct ConnectivityMapGeometry
+{
+  int Extent[6];
+  double VoxelOrigin[3];   // Center of voxel (0,0,0)
+  double Spacing[3];
+  double ClosestPoint[3];
+};
+
+//----------------------------------------------------------------------------
+// Computes the region statistics from the labelled runs. This requires
+// only one pass over the runs (not the voxels), which is done serially in
+// raster order so that ties are resolved as in a serial voxel scan.
+inline void ConnectivityMapRegionStatistics
+(
+  const int* dims,
+  vtkIdType numComponents,
+  const vtkIdType* rowRunStart,
+  const int* runBegin,
+  const int* runEnd,
+  const unsigned int* runLabel,
+  const ConnectivityMapGeometry* g,
+  vtkTable* statistics
+)
+{
+  vtkSmartPointer<vtkIdTypeArray> voxelCount = vtkSmartPointer<vtkIdTypeArray>::New();
+  voxelCount->SetName("VoxelCount");
+  voxelCount->SetNumberOfTuples(numComponents);
+  voxelCount->Fill(0);
+  vtkSmartPointer<vtkIntArray> extent = vtkSmartPointer<vtkIntArray>::New();
+  extent->SetName("Extent");
+  extent->SetNumberOfComponents(6);
+  extent->SetNumberOfTuples(numComponents);
+  vtkSmartPointer<vtkDoubleArray> centroid = vtkSmartPointer<vtkDoubleArray>::New();
+  centroid->SetName("Centroid");
+  centroid->SetNumberOfComponents(3);
+  centroid->SetNumberOfTuples(numComponents);
+  centroid->Fill(0);
+  vtkSmartPointer<vtkIdTypeArray> firstVoxel = vtkSmartPointer<vtkIdTypeArray>::New();
+  firstVoxel->SetName("FirstVoxel");
+  firstVoxel->SetNumberOfTuples(numComponents);
+  firstVoxel->Fill(-1);
+  vtkSmartPointer<vtkIdTypeArray> closestVoxel = vtkSmartPointer<vtkIdTypeArray>::New();
+  closestVoxel->SetName("ClosestVoxel");
+  closestVoxel->SetNumberOfTuples(numComponents);
+  vtkSmartPointer<vtkDoubleArray> closestDistance = vtkSmartPointer<vtkDoubleArray>::New();
+  closestDistance->SetName("ClosestPointDistance");
+  closestDistance->SetNumberOfTuples(numComponents);
+  closestDistance->Fill(std::numeric_limits<double>::max());
+
+  vtkIdType* count = voxelCount->GetPointer(0);
+  int* ext = extent->GetPointer(0);
+  double* sum = centroid->GetPointer(0);
+  vtkIdType* first = firstVoxel->GetPointer(0);
+  vtkIdType* closest = closestVoxel->GetPointer(0);
+  double* dist2 = closestDistance->GetPointer(0);
+  for (vtkIdType r=0; r<numComponents; ++r)
+  {
+    ext[6*r]   = ext[6*r+2] = ext[6*r+4] = std::numeric_limits<int>::max();
+    ext[6*r+1] = ext[6*r+3] = ext[6*r+5] = std::numeric_limits<int>::min();
+  }
+
+  // Continuous i index of ClosestPoint
+  const double ti = (g->ClosestPoint[0] - g->VoxelOrigin[0]) / g->Spacing[0];
+  vtkIdType row = 0;
   for (int k=0; k<dims[2]; ++k)
-    for (int j=0; j<dims[1]; ++j)
-      for (int i=0; i<dims[0]; ++i)
+  {
+    const double dz = g->VoxelOrigin[2] + k*g->Spacing[2] - g->ClosestPoint[2];
+    for (int j=0; j<dims[1]; ++j, ++row)
+    {
+      const double dy = g->VoxelOrigin[1] + j*g->Spacing[1] - g->ClosestPoint[1];
+      const double dyz2 = dy*dy + dz*dz;
+      for (vtkIdType n = rowRunStart[row]; n < rowRunStart[row+1]; ++n)
       {
-        if ((in_data->GetValue(index) != 0) &&
-            (cmap->GetValue(index) == 0))
+        const vtkIdType r = runLabel[n] - 1;
+        const int b = runBegin[n];
+        const int e = runEnd[n];
+        const vtkIdType length = e - b;
+        count[r] += length;
+        ext[6*r]   = std::min(ext[6*r], b);
+        ext[6*r+1] = std::max(ext[6*r+1], e-1);
+        ext[6*r+2] = std::min(ext[6*r+2], j);
+        ext[6*r+3] = std::max(ext[6*r+3], j);
+        ext[6*r+4] = std::min(ext[6*r+4], k);
+        ext[6*r+5] = std::max(ext[6*r+5], k);
+        sum[3*r]   += 0.5*length*(b + e - 1);
+        sum[3*r+1] += double(length)*j;
+        sum[3*r+2] += double(length)*k;
+        const vtkIdType rowStart = row*vtkIdType(dims[0]);
+        if (first[r] == -1)
+          { first[r] = rowStart + b; }
+        // The closest voxel of the run is one of the two voxels adjacent
+        // to ti, clamped to the run.
+        double fi = std::floor(ti);
+        int candidate[2];
+        candidate[0] = fi < b ? b : (fi > e-1 ? e-1 : int(fi));
+        candidate[1] = std::min(candidate[0] + 1, e-1);
+        for (int c=0; c<2; ++c)
         {
-          // This is a voxel that is not empty, but not yet assigned to
-          // any component.
-          ++this->NumberOfRegions;
-          if (this->NumberOfRegions == std::numeric_limits<unsigned int>::max())
+          const double dx = g->VoxelOrigin[0] + candidate[c]*g->Spacing[0] - g->ClosestPoint[0];
+          const double d2 = dx*dx + dyz2;
+          if (d2 < dist2[r])
           {
-            vtkErrorMacro (<< "Number of components exceeds integer representation");
-            return VTK_ERROR;
+            dist2[r] = d2;
+            closest[r] = rowStart + candidate[c];
           }
-          int returnVal = this->MarkComponent<TArray> (in_data, dims, cmap, i, j, k, this->NumberOfRegions);
-          if (returnVal != VTK_OK) return VTK_ERROR;
         }
-        ++index;
       }
+    }
+  }
 
-  return VTK_OK;
+  for (vtkIdType r=0; r<numComponents; ++r)
+  {
+    for (int a=0; a<3; ++a)
+    {
+      sum[3*r+a] = g->VoxelOrigin[a] + (sum[3*r+a] / count[r]) * g->Spacing[a];
+      ext[6*r+2*a]   += g->Extent[2*a];
+      ext[6*r+2*a+1] += g->Extent[2*a];
+    }
+    dist2[r] = std::sqrt(dist2[r]);
+  }
+
+  statistics->Initialize();
+  statistics->AddColumn(voxelCount);
+  statistics->AddColumn(extent);
+  statistics->AddColumn(centroid);
+  statistics->AddColumn(firstVoxel);
+  statistics->AddColumn(closestVoxel);
+  statistics->AddColumn(closestDistance);
 }
 
 //----------------------------------------------------------------------------
-template <typename TArray>
-int vtkboneImageConnectivityMap::MarkComponent
+// Run-length, two-pass union-find connected component labelling,
+// parallelized over z-slabs.
+//
+// Each row is scanned into runs of non-zero voxels, and runs in
+// neighbouring rows are joined if they touch according to the connectivity.
+// The union-find forest of runs is built per slab in parallel, then the
+// slab borders are merged serially. Finally the roots are counted per slab,
+// and a prefix sum over the slab counts gives the labels, which are
+// numbered in the raster order of the first voxel of each component. This
+// is the same order in which a seed-scan labels components.
+//
+// Returns the number of components.
+//
+// If statistics is not NULL, the region statistics are added to it.
+template <typename T>
+vtkIdType ConnectivityMapLabel
 (
-  TArray* in_data,
-  int* dims,
-  vtkUnsignedIntArray* cmap,
-  int seed_i,
-  int seed_j,
-  int seed_k,
-  unsigned int label
+  const T* data,
+  const int* dims,
+  int connectivityIndex,
+  unsigned int* labels,
+  const ConnectivityMapGeometry* geometry,
+  vtkTable* statistics
 )
 {
-  vtkIdType index = (seed_k*dims[1] + seed_j)*dims[0]+ seed_i;
-  cmap->SetValue(index, label);
+  const vtkIdType d0 = dims[0];
+  const vtkIdType d1 = dims[1];
+  const vtkIdType numRows = d1*vtkIdType(dims[2]);
+  const ConnectivityMapRowNeighbour* neighbours =
+    ConnectivityMapRowNeighbours[connectivityIndex];
+  const int numNeighbours = ConnectivityMapNumberOfRowNeighbours[connectivityIndex];
+  const int numSlabs = std::max(1, std::min(dims[2],
+                         4*vtkSMPTools::GetEstimatedNumberOfThreads()));
+  std::vector<int> slabStart(numSlabs+1);
+  for (int s=0; s<=numSlabs; ++s)
+  {
+    slabStart[s] = int((vtkIdType(dims[2])*s)/numSlabs);
+  }
 
-  vtkIdType numPts = vtkIdType(dims[0]) * vtkIdType(dims[1]) * vtkIdType(dims[2]);
-  vtkSmartPointer<vtkIdList> wave1 = vtkSmartPointer<vtkIdList>::New();
-  wave1->Allocate(numPts/4+1,numPts);
-  vtkSmartPointer<vtkIdList> wave2 = vtkSmartPointer<vtkIdList>::New();
-  wave2->Allocate(numPts/4+1,numPts);
-  vtkIdList* newWave = wave1;
-  vtkIdList* oldWave = wave2;
-
-  oldWave->InsertNextId (index);
-  vtkIdType dims01 = dims[0]*dims[1];
-  do
-  {
-    newWave->SetNumberOfIds(0);
-    for (vtkIdType n=0; n<oldWave->GetNumberOfIds(); ++n)
+  // Count the runs in each row.
+  std::vector<vtkIdType> rowRunStart(numRows+1, 0);
+  vtkSMPTools::For(0, numSlabs, 1, [&](vtkIdType sBegin, vtkIdType sEnd)
+  {
+    for (vtkIdType row = slabStart[sBegin]*d1; row < slabStart[sEnd]*d1; ++row)
     {
-      vtkIdType id = oldWave->GetId(n);
-      // Reconstruct i,j,k
-      int i = id % dims[0];
-      int k = id/dims[0]; // Integer division
-      int j = k % dims[1];
-      k /= dims[1];
-      if (i > 0)
+      const T* rowData = data + row*d0;
+      vtkIdType count = 0;
+      int i = ConnectivityMapFindRunBoundary(rowData, 0, dims[0], true);
+      while (i < dims[0])
       {
-        int candidateId = id - 1;
-        if (in_data->GetValue(candidateId) != 0 && cmap->GetValue(candidateId) == 0)
-        {
-          cmap->SetValue(candidateId, label);
-          newWave->InsertNextId(candidateId);
-        }
+        ++count;
+        i = ConnectivityMapFindRunBoundary(rowData, i, dims[0], false);
+        i = ConnectivityMapFindRunBoundary(rowData, i, dims[0], true);
       }
-      if (i < dims[0] - 1)
-      {
-        int candidateId = id + 1;
-        if (in_data->GetValue(candidateId) != 0 && cmap->GetValue(candidateId) == 0)
+      rowRunStart[row+1] = count;
+    }
+  });
+  std::partial_sum(rowRunStart.begin(), rowRunStart.end(), rowRunStart.begin());
+  const vtkIdType numRuns = rowRunStart[numRows];
+  std::unique_ptr<int[]> runBegin (new int[numRuns]);
+  std::unique_ptr<int[]> runEnd (new int[numRuns]);
+  std::unique_ptr<vtkIdType[]> parent (new vtkIdType[numRuns]);
+
+  // First pass: record the runs and join them within each slab.
+  vtkSMPTools::For(0, numSlabs, 1, [&](vtkIdType sBegin, vtkIdType sEnd)
+  {
+    for (vtkIdType s=sBegin; s<sEnd; ++s)
+    {
+      const int kBegin = slabStart[s];
+      const int kEnd = slabStart[s+1];
+      for (int k=kBegin; k<kEnd; ++k)
+        for (int j=0; j<dims[1]; ++j)
         {
-          cmap->SetValue(candidateId, label);
-          newWave->InsertNextId(candidateId);
+          const vtkIdType row = k*d1 + j;
+          const T* rowData = data + row*d0;
+          vtkIdType r = rowRunStart[row];
+          int i = ConnectivityMapFindRunBoundary(rowData, 0, dims[0], true);
+          while (i < dims[0])
+          {
+            runBegin[r] = i;
+            i = ConnectivityMapFindRunBoundary(rowData, i, dims[0], false);
+            runEnd[r] = i;
+            parent[r] = r;
+            ++r;
+            i = ConnectivityMapFindRunBoundary(rowData, i, dims[0], true);
+          }
+          for (int n=0; n<numNeighbours; ++n)
+          {
+            const int jj = j + neighbours[n].dj;
+            const int kk = k + neighbours[n].dk;
+            if (jj < 0 || jj >= dims[1] || kk < kBegin)
+              { continue; }
+            const vtkIdType otherRow = kk*d1 + jj;
+            ConnectivityMapUnionRows(runBegin.get(), runEnd.get(), parent.get(),
+                                     rowRunStart[otherRow], rowRunStart[otherRow+1],
+                                     rowRunStart[row], rowRunStart[row+1],
+                                     neighbours[n].tolerance);
+          }
         }
+      // Flatten the slab. In raster order, the parent of every run has
+      // already been flattened to point to its root.
+      for (vtkIdType r = rowRunStart[kBegin*d1]; r < rowRunStart[kEnd*d1]; ++r)
+      {
+        parent[r] = parent[parent[r]];
       }
-      if (j > 0)
+    }
+  });
+
+  // Merge across the slab borders.
+  for (int s=1; s<numSlabs; ++s)
+  {
+    const int k = slabStart[s];
+    for (int j=0; j<dims[1]; ++j)
+    {
+      const vtkIdType row = k*d1 + j;
+      for (int n=0; n<numNeighbours; ++n)
       {
-        int candidateId = id - dims[0];
-        if (in_data->GetValue(candidateId) != 0 && cmap->GetValue(candidateId) == 0)
-        {
-          cmap->SetValue(candidateId, label);
-          newWave->InsertNextId(candidateId);
-        }
+        const int jj = j + neighbours[n].dj;
+        if (neighbours[n].dk != -1 || jj < 0 || jj >= dims[1])
+          { continue; }
+        const vtkIdType otherRow = (k-1)*d1 + jj;
+        ConnectivityMapUnionRows(runBegin.get(), runEnd.get(), parent.get(),
+                                 rowRunStart[otherRow], rowRunStart[otherRow+1],
+                                 rowRunStart[row], rowRunStart[row+1],
+                                 neighbours[n].tolerance);
       }
-      if (j < dims[1] - 1)
+    }
+  }
+
+  // Count the roots (i.e. components) that start in each slab.
+  std::vector<vtkIdType> labelOffset(numSlabs+1, 0);
+  vtkSMPTools::For(0, numSlabs, 1, [&](vtkIdType sBegin, vtkIdType sEnd)
+  {
+    for (vtkIdType s=sBegin; s<sEnd; ++s)
+    {
+      vtkIdType count = 0;
+      for (vtkIdType r = rowRunStart[slabStart[s]*d1]; r < rowRunStart[slabStart[s+1]*d1]; ++r)
       {
-        int candidateId = id + dims[0];
-        if (in_data->GetValue(candidateId) != 0 && cmap->GetValue(candidateId) == 0)
-        {
-          cmap->SetValue(candidateId, label);
-          newWave->InsertNextId(candidateId);
-        }
+        count += (parent[r] == r);
       }
-      if (k > 0)
+      labelOffset[s+1] = count;
+    }
+  });
+  std::partial_sum(labelOffset.begin(), labelOffset.end(), labelOffset.begin());
+  const vtkIdType numComponents = labelOffset[numSlabs];
+  if (numComponents >= vtkIdType(std::numeric_limits<unsigned int>::max()))
+  {
+    return numComponents;
+  }
+
+  // Label the roots.
+  std::unique_ptr<unsigned int[]> runLabel (new unsigned int[numRuns]);
+  vtkSMPTools::For(0, numSlabs, 1, [&](vtkIdType sBegin, vtkIdType sEnd)
+  {
+    for (vtkIdType s=sBegin; s<sEnd; ++s)
+    {
+      unsigned int label = static_cast<unsigned int>(labelOffset[s]);
+      for (vtkIdType r = rowRunStart[slabStart[s]*d1]; r < rowRunStart[slabStart[s+1]*d1]; ++r)
       {
-        int candidateId = id - dims01;
-        if (in_data->GetValue(candidateId) != 0 && cmap->GetValue(candidateId) == 0)
-        {
-          cmap->SetValue(candidateId, label);
-          newWave->InsertNextId(candidateId);
-        }
+        if (parent[r] == r)
+          { runLabel[r] = ++label; }
       }
-      if (k < dims[2] - 1)
+    }
+  });
+
+  // Label the other runs from their roots, and write the voxel labels.
+  // The parent array is only read here.
+  vtkSMPTools::For(0, numSlabs, 1, [&](vtkIdType sBegin, vtkIdType sEnd)
+  {
+    for (vtkIdType row = slabStart[sBegin]*d1; row < slabStart[sEnd]*d1; ++row)
+    {
+      unsigned int* rowLabels = labels + row*d0;
+      std::fill(rowLabels, rowLabels + d0, 0u);
+      for (vtkIdType r = rowRunStart[row]; r < rowRunStart[row+1]; ++r)
       {
-        int candidateId = id + dims01;
-        if (in_data->GetValue(candidateId) != 0 && cmap->GetValue(candidateId) == 0)
+        if (parent[r] != r)
         {
-          cmap->SetValue(candidateId, label);
-          newWave->InsertNextId(candidateId);
+          vtkIdType root = parent[r];
+          while (parent[root] != root)
+            { root = parent[root]; }
+          runLabel[r] = runLabel[root];
         }
+        std::fill(rowLabels + runBegin[r], rowLabels + runEnd[r], runLabel[r]);
       }
     }
-    std::swap (newWave, oldWave);
-  } while (oldWave->GetNumberOfIds() > 0);
+  });
+
+  if (statistics)
+  {
+    ConnectivityMapRegionStatistics(dims, numComponents, rowRunStart.data(),
+      runBegin.get(), runEnd.get(), runLabel.get(), geometry, statistics);
+  }
+
+  return numComponents;
+}
+
+}  // namespace
+
+using namespace ImageConnectivityMap_Utility;
+
+//----------------------------------------------------------------------------
+template <typename TArray>
+int vtkboneImageConnectivityMap::GenerateConnectivityMap
+(
+  vtkImageData* input_image,
+  vtkDataArray* in_data_arg,
+  int* dims,
+  vtkUnsignedIntArray* cmap
+)
+{
+  TArray* in_data = TArray::SafeDownCast(in_data_arg);
+  if (in_data == NULL)
+  {
+    vtkErrorMacro(<< "Internal error in vtkboneImageConnectivityMap");
+    return VTK_ERROR;
+  }
+
+  vtkIdType numPts = vtkIdType(dims[0]) * vtkIdType(dims[1]) * vtkIdType(dims[2]);
+  cmap->SetNumberOfTuples (numPts);
+  this->NumberOfRegions = 0;
+  this->RegionStatistics->Initialize();
+  if (numPts == 0)
+  {
+    return VTK_OK;
+  }
+
+  int connectivityIndex = 0;
+  switch (this->Connectivity)
+  {
+    case FACE_CONNECTIVITY:   connectivityIndex = 0; break;
+    case EDGE_CONNECTIVITY:   connectivityIndex = 1; break;
+    case VERTEX_CONNECTIVITY: connectivityIndex = 2; break;
+    default:
+      vtkErrorMacro(<< "Invalid Connectivity " << this->Connectivity);
+      return VTK_ERROR;
+  }
+
+  ConnectivityMapGeometry geometry;
+  double origin[3];
+  input_image->GetExtent(geometry.Extent);
+  input_image->GetOrigin(origin);
+  input_image->GetSpacing(geometry.Spacing);
+  // Voxels are at the points, or at the centers of the cells.
+  double offset = input_image->GetCellData()->GetScalars() ? 0.5 : 0.0;
+  for (int a=0; a<3; ++a)
+  {
+    geometry.VoxelOrigin[a] = origin[a] + (geometry.Extent[2*a] + offset)*geometry.Spacing[a];
+    geometry.ClosestPoint[a] = this->ClosestPoint[a];
+  }
+
+  vtkIdType numComponents = ConnectivityMapLabel(in_data->GetPointer(0), dims,
+                              connectivityIndex, cmap->GetPointer(0),
+                              &geometry, this->RegionStatistics);
+
+  if (numComponents >= vtkIdType(std::numeric_limits<unsigned int>::max()))
+  {
+    vtkErrorMacro (<< "Number of components exceeds integer representation");
+    return VTK_ERROR;
+  }
+  this->NumberOfRegions = static_cast<unsigned int>(numComponents);
 
   return VTK_OK;
 }
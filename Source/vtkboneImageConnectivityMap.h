@@ -17,13 +17,31 @@
 
 
  This filter generates a mask based on connectivity of the scalar values of
- the image.  Connectivity is considered only across faces, not across edges
- or corners.
+ the image.  By default connectivity is considered only across faces, not
+ across edges or corners; see SetConnectivity.
 
  This filter accepts image scalars on either the cells or the points; the
  output will have scalars with the same association.
 
  The output scalar data type is always vtkUnsignedInt.
+
+ Components are labelled 1,2,3,... in the raster order (X fastest, Z
+ slowest) of the first voxel of each component; 0 is background.
+ Labelling is done with a run-length, two-pass union-find algorithm that
+ is multithreaded over z-slabs.
+
+ Statistics for each region are collected while labelling, and are
+ available from GetRegionStatistics as a vtkTable with one row per region
+ (row r-1 corresponds to label r). The columns are:
+ - "VoxelCount": the number of voxels in the region.
+ - "Extent": the index extent (imin,imax,jmin,jmax,kmin,kmax) of the region.
+ - "Centroid": the mean position of the voxel centers.
+ - "FirstVoxel": the id of the first voxel of the region, in raster order.
+ - "ClosestVoxel": the id of the voxel of the region closest to
+   ClosestPoint. Ties are resolved in favour of the first voxel in raster
+   order.
+ - "ClosestPointDistance": the distance from the center of ClosestVoxel
+   to ClosestPoint.
 */
 
 #ifndef __vtkboneImageConnectivityMap_h
@@ -34,6 +52,7 @@
 
 // forward declarations
 class vtkUnsignedIntArray;
+class vtkTable;
 
 
 class VTKBONE_EXPORT vtkboneImageConnectivityMap : public vtkSimpleImageToImageFilter
@@ -44,11 +63,44 @@ public:
                        vtkSimpleImageToImageFilter);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
+  enum Connectivity_t {
+    FACE_CONNECTIVITY = 6,
+    EDGE_CONNECTIVITY = 18,
+    VERTEX_CONNECTIVITY = 26
+  };
+
+  //@{
+  /*! Set/Get the connectivity, which may be 6 (voxels sharing a face
+      are connected), 18 (voxels sharing a face or an edge are connected)
+      or 26 (voxels sharing a face, edge or corner are connected).
+      The default is 6. */
+  void SetConnectivity(int connectivity);
+  vtkGetMacro(Connectivity, int);
+  void SetConnectivityToFaces()
+    {this->SetConnectivity(FACE_CONNECTIVITY);};
+  void SetConnectivityToEdges()
+    {this->SetConnectivity(EDGE_CONNECTIVITY);};
+  void SetConnectivityToVertices()
+    {this->SetConnectivity(VERTEX_CONNECTIVITY);};
+  //@}
+
   //@{
   /*! Return the number of identified regions. */
   vtkGetMacro(NumberOfRegions, unsigned int);
   //@}
 
+  //@{
+  /*! Set/Get the point to which the ClosestVoxel and ClosestPointDistance
+      region statistics are computed. */
+  vtkSetVector3Macro(ClosestPoint, double);
+  vtkGetVectorMacro(ClosestPoint, double, 3);
+  //@}
+
+  //@{
+  /*! Return the region statistics of the last update. */
+  vtkGetObjectMacro(RegionStatistics, vtkTable);
+  //@}
+
 protected:
   vtkboneImageConnectivityMap();
   ~vtkboneImageConnectivityMap();
@@ -65,21 +117,16 @@ protected:
 
   //BTX
   template <typename TArray>
-  int GenerateConnectivityMap(vtkDataArray* in_data_arg,
+  int GenerateConnectivityMap(vtkImageData* input_image,
+                              vtkDataArray* in_data_arg,
                               int* dims,
                               vtkUnsignedIntArray* cmap);
-
-  template <typename TArray>
-  int MarkComponent(TArray* in_data_arg,
-                    int* dims,
-                    vtkUnsignedIntArray* cmap,
-                    int seed_i,
-                    int seed_j,
-                    int seed_k,
-                    unsigned int component);
   //ETX
 
+  int Connectivity;
+  double ClosestPoint[3];
   unsigned int NumberOfRegions;
+  vtkTable* RegionStatistics;
 
 private:
   // Prevent compiler from making default versions of these.
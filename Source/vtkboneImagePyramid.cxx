@@ -0,0 +1,228 @@
+#include "vtkboneImagePyramid.h"
+
+#include "vtkImageData.h"
+#include "vtkCellData.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkMultiBlockDataSet.h"
+#include "vtkCompositeDataSet.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkObjectFactory.h"
+#include "vtkInformationVector.h"
+#include "vtkInformation.h"
+#include "vtkSmartPointer.h"
+#include "vtkSMPTools.h"
+#include "DecimateImageHelper.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+vtkStandardNewMacro(vtkboneImagePyramid);
+
+//----------------------------------------------------------------------------
+vtkboneImagePyramid::vtkboneImagePyramid()
+{
+  this->NumberOfLevels = 3;
+  this->DecimationFactors[0] = 2;
+  this->DecimationFactors[1] = 2;
+  this->DecimationFactors[2] = 2;
+  this->ReductionMode = vtkboneDecimateImage::MAXIMUM;
+}
+
+//----------------------------------------------------------------------------
+vtkboneImagePyramid::~vtkboneImagePyramid()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkboneImagePyramid::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "NumberOfLevels: " << this->NumberOfLevels << "\n";
+  os << indent << "DecimationFactors: " << this->DecimationFactors[0] << ", "
+     << this->DecimationFactors[1] << ", " << this->DecimationFactors[2] << "\n";
+  os << indent << "ReductionMode: " << this->ReductionMode << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkboneImagePyramid::FillInputPortInformation(
+  int vtkNotUsed(port), vtkInformation* info )
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneImagePyramid::RequestUpdateExtent(
+  vtkInformation *, vtkInformationVector **inputVector,
+  vtkInformationVector *)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+
+  // always request the whole extent
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+              inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()),6);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneImagePyramid::RequestData(
+  vtkInformation* vtkNotUsed( request ),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(outputVector);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Missing input or output.");
+    return 0;
+  }
+
+  const int* f = this->DecimationFactors;
+  if (f[0] < 1 || f[1] < 1 || f[2] < 1)
+  {
+    vtkErrorMacro(<< "DecimationFactors must be at least 1.");
+    return 0;
+  }
+
+  vtkDataArray* inScalars = input->GetCellData()->GetScalars();
+  const bool onCells = (inScalars != NULL);
+  if (!onCells)
+  {
+    inScalars = input->GetPointData()->GetScalars();
+  }
+  if (!inScalars || inScalars->GetNumberOfComponents() != 1)
+  {
+    vtkErrorMacro(<< "Input must have single component scalars.");
+    return 0;
+  }
+
+  // Each level, with level 0 here being the input.  dims are the
+  // dimensions of the data, which are one less than the image dimensions
+  // for cell data.
+  const int numLevels = this->NumberOfLevels + 1;
+  std::vector<vtkSmartPointer<vtkImageData> > images (numLevels);
+  std::vector<vtkDataArray*> scalars (numLevels);
+  std::vector<int> modes (numLevels, this->ReductionMode);
+  std::vector<int> dims (3*numLevels);
+  images[0] = input;
+  scalars[0] = inScalars;
+  for (int l=1; l<numLevels; ++l)
+  {
+    // Fractions and means are carried down as means.
+    if (l > 1 && (this->ReductionMode == vtkboneDecimateImage::MEAN ||
+                  this->ReductionMode == vtkboneDecimateImage::OCCUPANCY_FRACTION))
+    {
+      modes[l] = vtkboneDecimateImage::MEAN;
+    }
+    int inExt[6], outExt[6];
+    double inSpacing[3], outSpacing[3];
+    double inOrigin[3], outOrigin[3];
+    images[l-1]->GetExtent(inExt);
+    images[l-1]->GetSpacing(inSpacing);
+    images[l-1]->GetOrigin(inOrigin);
+    DecimateImageHelper::OutputInformation(onCells, inExt, inSpacing, inOrigin,
+                                           f, outExt, outSpacing, outOrigin);
+    images[l] = vtkSmartPointer<vtkImageData>::New();
+    images[l]->SetExtent(outExt);
+    images[l]->SetSpacing(outSpacing);
+    images[l]->SetOrigin(outOrigin);
+    int outDims[3];
+    images[l]->GetDimensions(outDims);
+    vtkIdType n = 1;
+    for (int a=0; a<3; ++a)
+    {
+      n *= vtkIdType(onCells ? outDims[a] - 1 : outDims[a]);
+    }
+    vtkSmartPointer<vtkDataArray> array = vtkSmartPointer<vtkDataArray>::Take(
+      vtkDataArray::CreateDataArray(
+        DecimateImageHelper::OutputType(modes[l], scalars[l-1]->GetDataType())));
+    array->SetName(inScalars->GetName());
+    array->SetNumberOfTuples(n);
+    if (onCells)
+    {
+      images[l]->GetCellData()->SetScalars(array);
+    }
+    else
+    {
+      images[l]->GetPointData()->SetScalars(array);
+    }
+    scalars[l] = array;
+  }
+  for (int l=0; l<numLevels; ++l)
+  {
+    images[l]->GetDimensions(&dims[3*l]);
+    if (onCells)
+    {
+      for (int a=0; a<3; ++a) { --dims[3*l+a]; }
+    }
+  }
+  if (dims[0] < 1 || dims[1] < 1 || dims[2] < 1)
+  {
+    vtkErrorMacro(<< "Input image is empty.");
+    return 0;
+  }
+
+  // The coarsest level is computed a few slices at a time; the slices of
+  // each finer level that it depends on are computed just before it.
+  // Enough slices are taken that the first level has work for all
+  // threads.
+  vtkIdType firstLevelSlices = 1;
+  for (int l=1; l<numLevels-1 && firstLevelSlices < dims[3*1+2]; ++l)
+  {
+    firstLevelSlices *= f[2];
+  }
+  const vtkIdType wanted = 2*vtkSMPTools::GetEstimatedNumberOfThreads();
+  const int slicesPerChunk = int(std::max(vtkIdType(1),
+                                 (wanted + firstLevelSlices - 1)/firstLevelSlices));
+
+  const int coarsest = numLevels - 1;
+  const int coarsestSlices = dims[3*coarsest+2];
+  std::vector<int> begin (numLevels);
+  std::vector<int> end (numLevels);
+  for (int chunk=0; chunk<coarsestSlices; chunk+=slicesPerChunk)
+  {
+    begin[coarsest] = chunk;
+    end[coarsest] = std::min(chunk + slicesPerChunk, coarsestSlices);
+    for (int l=coarsest-1; l>=0; --l)
+    {
+      begin[l] = begin[l+1]*f[2];
+      end[l] = std::min(end[l+1]*f[2], dims[3*l+2]);
+    }
+    for (int l=1; l<numLevels; ++l)
+    {
+      const int* sdims = &dims[3*(l-1)];
+      const size_t sliceBytes = size_t(sdims[0])*size_t(sdims[1])*
+                                size_t(scalars[l-1]->GetDataTypeSize());
+      const int idims[3] = {sdims[0], sdims[1], end[l-1] - begin[l-1]};
+      const int* tdims = &dims[3*l];
+      const size_t outSliceBytes = size_t(tdims[0])*size_t(tdims[1])*
+                                   size_t(scalars[l]->GetDataTypeSize());
+      const int odims[3] = {tdims[0], tdims[1], end[l] - begin[l]};
+      const char* in = static_cast<const char*>(scalars[l-1]->GetVoidPointer(0))
+                       + size_t(begin[l-1])*sliceBytes;
+      char* out = static_cast<char*>(scalars[l]->GetVoidPointer(0))
+                  + size_t(begin[l])*outSliceBytes;
+      if (!DecimateImageHelper::Decimate(in, scalars[l-1]->GetDataType(), idims,
+                                         out, odims, f, modes[l]))
+      {
+        vtkErrorMacro(<< "Unhandled data type in vtkboneImagePyramid.");
+        return 0;
+      }
+    }
+    this->UpdateProgress(double(end[coarsest])/coarsestSlices);
+  }
+
+  output->SetNumberOfBlocks(this->NumberOfLevels);
+  for (int l=1; l<numLevels; ++l)
+  {
+    output->SetBlock(l-1, images[l]);
+    std::ostringstream name;
+    name << "Level " << l;
+    output->GetMetaData(l-1)->Set(vtkCompositeDataSet::NAME(), name.str().c_str());
+  }
+
+  return 1;
+}
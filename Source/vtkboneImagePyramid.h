@@ -0,0 +1,92 @@
+/*=========================================================================
+
+  Copyright (c) 2010-2025, Numerics88 Solutions.
+  http://www.numerics88.com/
+
+  Copyright (c) Eric Nodwell and Steven K. Boyd
+  See Copyright.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+/*! @class   vtkboneImagePyramid
+    @brief   Generates a multi-resolution pyramid of decimated images.
+
+
+ The output is a vtkMultiBlockDataSet with NumberOfLevels blocks.  Block 0
+ is the input decimated once, as by vtkboneDecimateImage with the same
+ DecimationFactors and ReductionMode, block 1 is block 0 decimated again,
+ and so on.  The input itself is not included.
+
+ All levels are computed in a single pass over the input: the input is
+ processed in z-slabs, and each slab is carried down through all the
+ levels before the next slab is read, so that each level is computed from
+ the level above while it is still in cache.
+
+ For the MAXIMUM and MAJORITY reductions every level applies the same
+ reduction to the level above.  For MEAN and OCCUPANCY_FRACTION, the levels
+ after the first take the mean of the level above; this is exact where the
+ dimensions are multiples of the factors.
+
+    @sa
+ vtkboneDecimateImage
+*/
+
+#ifndef __vtkboneImagePyramid_h
+#define __vtkboneImagePyramid_h
+
+#include "vtkMultiBlockDataSetAlgorithm.h"
+#include "vtkboneDecimateImage.h"
+#include "vtkboneWin32Header.h"
+
+class VTKBONE_EXPORT vtkboneImagePyramid : public vtkMultiBlockDataSetAlgorithm
+{
+public:
+  static vtkboneImagePyramid *New();
+  vtkTypeMacro(vtkboneImagePyramid, vtkMultiBlockDataSetAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /*! Set/Get the number of decimated levels. The default is 3. */
+  vtkSetClampMacro(NumberOfLevels, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfLevels, int);
+  //@}
+
+  //@{
+  /*! Set/Get the decimation factor along each axis between successive
+      levels. The default is 2,2,2. */
+  vtkSetVector3Macro(DecimationFactors, int);
+  vtkGetVector3Macro(DecimationFactors, int);
+  //@}
+
+  //@{
+  /*! Set/Get the reduction, as for vtkboneDecimateImage. The default is
+      vtkboneDecimateImage::MAXIMUM. */
+  vtkSetClampMacro(ReductionMode, int, vtkboneDecimateImage::MAXIMUM,
+                   vtkboneDecimateImage::OCCUPANCY_FRACTION);
+  vtkGetMacro(ReductionMode, int);
+  //@}
+
+protected:
+  vtkboneImagePyramid();
+  ~vtkboneImagePyramid();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info) override;
+
+  virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **,
+                                  vtkInformationVector *) override;
+  virtual int RequestData(vtkInformation *, vtkInformationVector **,
+                          vtkInformationVector *) override;
+
+  int NumberOfLevels;
+  int DecimationFactors[3];
+  int ReductionMode;
+
+private:
+  vtkboneImagePyramid(const vtkboneImagePyramid&);  // Not implemented.
+  void operator=(const vtkboneImagePyramid&);  // Not implemented.
+};
+
+#endif
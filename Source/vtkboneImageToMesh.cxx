@@ -18,24 +18,60 @@
 #include "vtkPolyData.h"
 #include "vtkMath.h"
 #include "vtkSmartPointer.h"
+#include "vtkIdTypeArray.h"
+#include "vtkSMPTools.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
 #include <boost/format.hpp>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 
 vtkStandardNewMacro(vtkboneImageToMesh);
 
+//----------------------------------------------------------------------------
+// State carried from one z-slab to the next when streaming.
+//
+// Voxels are processed one layer at a time. When layer k arrives, the
+// points of plane k (the top of layer k-1 and the bottom of layer k) are
+// all known, so they are numbered and the cells of layer k-1 are emitted.
+class vtkboneImageToMeshStreamState
+{
+public:
+  bool OnCells;
+  int WholeExtent[6];
+  vtkIdType VoxelDims[3];
+  vtkIdType NumberOfLayers;
+  double CornerOrigin[3];     // Only used for point scalars.
+  double Spacing[3];
+  vtkIdType NextLayer;
+  std::vector<vtkIdType> LowerIds;  // Point ids of plane NextLayer-1
+  std::vector<vtkIdType> UpperIds;  // Point ids of plane NextLayer
+  vtkSmartPointer<vtkDataArray> PreviousLayer;
+  vtkSmartPointer<vtkDoubleArray> Points;
+  vtkSmartPointer<vtkIdTypeArray> Connectivity;
+  vtkSmartPointer<vtkDataArray> Scalars;
+};
+
 //-----------------------------------------------------------------------
 vtkboneImageToMesh::vtkboneImageToMesh()
+:
+  NumberOfStreamDivisions (1),
+  CurrentStreamDivision (0),
+  StreamState (NULL)
 {
 }
 
 //----------------------------------------------------------------------------
 vtkboneImageToMesh::~vtkboneImageToMesh()
 {
+  delete this->StreamState;
 }
 
 //----------------------------------------------------------------------------
 void vtkboneImageToMesh::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfStreamDivisions: " << this->NumberOfStreamDivisions << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -92,6 +128,186 @@ int vtkboneImageToMesh::GetInputAsCellScalars
     return 1;
 }
 
+//----------------------------------------------------------------------------
+// Generates the mesh directly from (i,j,k) index arithmetic on the raw
+// scalar buffer.
+//
+// The work is divided into z-slabs with vtkSMPTools. The first pass flags
+// the used points of each point plane and counts used points and non-zero
+// cells per slab. A prefix sum over the slab counts then gives every slab
+// the first id it owns, so that the later passes can write final ids,
+// coordinates, connectivity and scalars into disjoint parts of the output
+// buffers. The numbering is therefore identical to a serial X,Y,Z scan.
+template <typename T>
+static void ImageToMeshGenerateHexahedrons
+(
+  vtkImageData* input,
+  const T* inScalars,
+  vtkUnstructuredGrid* output
+)
+{
+  int dims[3];
+  int ext[6];
+  input->GetDimensions(dims);
+  input->GetExtent(ext);
+  // Point dims and cell dims
+  const vtkIdType pd0 = dims[0];
+  const vtkIdType pd1 = dims[1];
+  const vtkIdType pd2 = dims[2];
+  const vtkIdType cd0 = pd0 - 1;
+  const vtkIdType cd1 = pd1 - 1;
+  const vtkIdType cd2 = pd2 - 1;
+  const vtkIdType pointSlice = pd0*pd1;
+  const vtkIdType cellSlice = cd0*cd1;
+
+  // Map of old Points to new Points. -1 indicates old point not used.
+  vtkSmartPointer<vtkIdTypeArray> pointMapArray = vtkSmartPointer<vtkIdTypeArray>::New();
+  pointMapArray->SetNumberOfTuples(pd2*pointSlice);
+  vtkIdType* pointMap = pointMapArray->GetPointer(0);
+
+  // Entry k+1 holds the count for point plane (or cell slab) k; after the
+  // prefix sum entry k holds the first new id of plane (or slab) k.
+  std::vector<vtkIdType> pointOffsets(pd2+1, 0);
+  std::vector<vtkIdType> cellOffsets(cd2+1, 0);
+
+  // First pass: flag used points and count.
+  vtkSMPTools::For(0, pd2, [&](vtkIdType kBegin, vtkIdType kEnd)
+  {
+    for (vtkIdType kp=kBegin; kp<kEnd; ++kp)
+    {
+      vtkIdType* plane = pointMap + kp*pointSlice;
+      std::fill(plane, plane + pointSlice, vtkIdType(-1));
+      // Both cell slabs adjacent to this point plane contribute.
+      for (vtkIdType k=std::max(kp-1, vtkIdType(0)); k<=std::min(kp, cd2-1); ++k)
+      {
+        const T* slab = inScalars + k*cellSlice;
+        vtkIdType numCells = 0;
+        for (vtkIdType j=0; j<cd1; ++j)
+        {
+          const T* row = slab + j*cd0;
+          vtkIdType* p = plane + j*pd0;
+          for (vtkIdType i=0; i<cd0; ++i)
+          {
+            if (row[i] != 0)
+            {
+              p[i] = 1;
+              p[i+1] = 1;
+              p[i+pd0] = 1;
+              p[i+pd0+1] = 1;
+              ++numCells;
+            }
+          }
+        }
+        if (k == kp)
+        {
+          cellOffsets[k+1] = numCells;
+        }
+      }
+      vtkIdType numPoints = 0;
+      for (vtkIdType n=0; n<pointSlice; ++n)
+      {
+        numPoints += (plane[n] != -1);
+      }
+      pointOffsets[kp+1] = numPoints;
+    }
+  });
+
+  std::partial_sum(pointOffsets.begin(), pointOffsets.end(), pointOffsets.begin());
+  std::partial_sum(cellOffsets.begin(), cellOffsets.end(), cellOffsets.begin());
+  const vtkIdType numOutputPoints = pointOffsets[pd2];
+  const vtkIdType numOutputCells = cellOffsets[cd2];
+
+  // Second pass: assign new point ids and generate the node coordinates.
+  vtkSmartPointer<vtkDoubleArray> pointCoord = vtkSmartPointer<vtkDoubleArray>::New();
+  pointCoord->SetNumberOfComponents(3);
+  pointCoord->SetNumberOfTuples(numOutputPoints);
+  double* coord = pointCoord->GetPointer(0);
+  vtkSMPTools::For(0, pd2, [&](vtkIdType kBegin, vtkIdType kEnd)
+  {
+    for (vtkIdType kp=kBegin; kp<kEnd; ++kp)
+    {
+      vtkIdType newId = pointOffsets[kp];
+      vtkIdType* p = pointMap + kp*pointSlice;
+      for (vtkIdType j=0; j<pd1; ++j)
+      {
+        for (vtkIdType i=0; i<pd0; ++i, ++p)
+        {
+          if (*p != -1)
+          {
+            *p = newId;
+            input->TransformIndexToPhysicalPoint(
+              ext[0] + int(i), ext[2] + int(j), ext[4] + int(kp), coord + 3*newId);
+            ++newId;
+          }
+        }
+      }
+    }
+  });
+
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetData(pointCoord);
+  output->SetPoints(points);
+
+  // Third pass: fill the connectivity and the cell scalars.
+  const int pointsPerCell = 8;
+  vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+  offsets->SetNumberOfTuples(numOutputCells+1);
+  vtkIdType* offsetsPtr = offsets->GetPointer(0);
+  vtkSmartPointer<vtkIdTypeArray> connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+  connectivity->SetNumberOfTuples(pointsPerCell*numOutputCells);
+  vtkIdType* conn = connectivity->GetPointer(0);
+
+  vtkSmartPointer<vtkDataArray> outputScalars = vtkSmartPointer<vtkDataArray>::Take(
+                vtkDataArray::CreateDataArray(input->GetCellData()->GetScalars()->GetDataType()));
+  outputScalars->SetNumberOfTuples(numOutputCells);
+  outputScalars->SetName("MaterialID");
+  T* outScalars = static_cast<T*>(outputScalars->GetVoidPointer(0));
+
+  vtkSMPTools::For(0, cd2, [&](vtkIdType kBegin, vtkIdType kEnd)
+  {
+    for (vtkIdType k=kBegin; k<kEnd; ++k)
+    {
+      vtkIdType newCellId = cellOffsets[k];
+      const T* s = inScalars + k*cellSlice;
+      for (vtkIdType j=0; j<cd1; ++j)
+      {
+        for (vtkIdType i=0; i<cd0; ++i, ++s)
+        {
+          if (*s != 0)
+          {
+            // VTK_VOXEL point order; see class documentation.
+            const vtkIdType* p = pointMap + (k*pd1 + j)*pd0 + i;
+            vtkIdType* c = conn + pointsPerCell*newCellId;
+            c[0] = p[0];
+            c[1] = p[1];
+            c[2] = p[pd0];
+            c[3] = p[pd0+1];
+            c[4] = p[pointSlice];
+            c[5] = p[pointSlice+1];
+            c[6] = p[pointSlice+pd0];
+            c[7] = p[pointSlice+pd0+1];
+            outScalars[newCellId] = *s;
+            ++newCellId;
+          }
+        }
+      }
+    }
+  });
+
+  vtkSMPTools::For(0, numOutputCells+1, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType n=begin; n<end; ++n)
+    {
+      offsetsPtr[n] = pointsPerCell*n;
+    }
+  });
+
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetData(offsets, connectivity);
+  output->SetCells(VTK_VOXEL, cells);
+  output->GetCellData()->SetScalars(outputScalars);
+}
+
 //----------------------------------------------------------------------------
 // NOTE: Assumption is that input has data on the Cells.  This corresponds
 //       more logically with FE elements.  Use the method GetInputAsCellScalars
@@ -116,108 +332,395 @@ int vtkboneImageToMesh::GenerateHexahedrons
     vtkErrorMacro(<< "Inconsistent number of cell data values.");
     return 0;
   }
+  if (inputScalars->GetNumberOfComponents() != 1)
+  {
+    vtkErrorMacro(<< "Input scalars must have a single component.");
+    return 0;
+  }
+  if (input->GetDataDimension() != 3)
+  {
+    vtkErrorMacro(<<"This filter requires 3D input data.");
+    return 0;
+  }
+
+  switch (inputScalars->GetDataType())
+  {
+    vtkTemplateMacro(
+      ImageToMeshGenerateHexahedrons(input,
+        static_cast<const VTK_TT*>(inputScalars->GetVoidPointer(0)), output));
+    default:
+      vtkErrorMacro(<< "Unsupported data type for vtkboneImageToMesh input");
+      return 0;
+  }
 
-  vtkIdType numInputCells = input->GetNumberOfCells();
-  vtkIdType numInputPoints = input->GetNumberOfPoints();
+  return 1;
+}
 
-  // Create a map of new Cells to old Cells
-  vtkSmartPointer<vtkIdTypeArray> reverseCellMap = vtkSmartPointer<vtkIdTypeArray>::New();
-  reverseCellMap->Allocate(numInputCells);   // maximum possible
-  reverseCellMap->SetNumberOfComponents(1);
-  for (int oldId=0; oldId < numInputCells; oldId++)
+//----------------------------------------------------------------------------
+// Sets the number of tuples of array to numTuples >= its current number,
+// preserving the values.  SetNumberOfTuples cannot be used for this, as it
+// reallocates to the exact size whenever the size changes, which would copy
+// the whole accumulated mesh for every plane.  InsertComponent grows the
+// capacity geometrically instead, so that the array is reallocated only
+// O(log n) times; it is trimmed once with Squeeze when streaming ends.
+static void ImageToMeshGrowArray(vtkDataArray* array, vtkIdType numTuples)
+{
+  if (numTuples > array->GetNumberOfTuples())
   {
-    if (inputScalars->GetTuple1(oldId) != 0)
-    {
-      reverseCellMap->InsertNextValue(oldId);
-    }
+    array->InsertComponent(numTuples - 1, array->GetNumberOfComponents() - 1, 0.0);
   }
-  vtkIdType numOutputCells = reverseCellMap->GetNumberOfTuples();
+}
+
+//----------------------------------------------------------------------------
+// Streaming: processes voxel layers [layerBegin, layerEnd) of the input, and
+// if finish is true, also numbers the final plane of points and emits the
+// cells of the last layer.
+template <typename T>
+static void ImageToMeshStreamLayers
+(
+  vtkboneImageToMeshStreamState* state,
+  vtkImageData* input,
+  const T* inScalars,
+  vtkIdType layerBegin,
+  vtkIdType layerEnd,
+  bool finish
+)
+{
+  const vtkIdType cd0 = state->VoxelDims[0];
+  const vtkIdType cd1 = state->VoxelDims[1];
+  const vtkIdType pd0 = cd0 + 1;
+  const vtkIdType pd1 = cd1 + 1;
+  const vtkIdType layerSize = cd0*cd1;
+  int inExt[6];
+  input->GetExtent(inExt);
+  // z-index of the first voxel layer in inScalars, relative to the whole extent.
+  const vtkIdType inFirstLayer = inExt[4] - state->WholeExtent[4];
+
+  const int pointsPerCell = 8;
+  T* previousLayer = static_cast<T*>(state->PreviousLayer->GetVoidPointer(0));
 
-  // Create a map of old Points to new Points.
-  vtkSmartPointer<vtkIdTypeArray> pointMap = vtkSmartPointer<vtkIdTypeArray>::New();
-  pointMap->SetNumberOfComponents(1);
-  pointMap->SetNumberOfTuples(numInputPoints);
-  for (vtkIdType i=0; i < numInputPoints; i++)
+  if (finish)
   {
-    pointMap->SetValue(i, -1);   // -1 indicates old point not used.
+    layerEnd += 1;
   }
-  // First step is just to flag points that are used in output.
-  {  // scope
-  vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-  for (int newCellId=0; newCellId < numOutputCells; newCellId++)
+  for (vtkIdType k=layerBegin; k<layerEnd; ++k)
   {
-    input->GetCellPoints(reverseCellMap->GetValue(newCellId), pointIds);
-    for (int p=0; p < pointIds->GetNumberOfIds(); p++)
+    // NULL past the last layer
+    const T* layer = (k < state->NumberOfLayers) ?
+                       inScalars + (k - inFirstLayer)*layerSize : NULL;
+    const T* previous = (k > 0) ? previousLayer : NULL;
+
+    // Flag the points of plane k
+    vtkIdType* upper = &state->UpperIds[0];
+    std::fill(upper, upper + pd0*pd1, vtkIdType(-1));
+    const T* adjacent[2] = {previous, layer};
+    for (int a=0; a<2; ++a)
+    {
+      if (adjacent[a] == NULL) continue;
+      const T* v = adjacent[a];
+      for (vtkIdType j=0; j<cd1; ++j)
+      {
+        vtkIdType* p = upper + j*pd0;
+        for (vtkIdType i=0; i<cd0; ++i, ++v)
+        {
+          if (*v != 0)
+          {
+            p[i] = 1;
+            p[i+1] = 1;
+            p[i+pd0] = 1;
+            p[i+pd0+1] = 1;
+          }
+        }
+      }
+    }
+
+    // Number the points of plane k and generate their coordinates
+    const vtkIdType firstId = state->Points->GetNumberOfTuples();
+    vtkIdType newId = firstId;
+    for (vtkIdType n=0; n<pd0*pd1; ++n)
+    {
+      if (upper[n] != -1)
+      {
+        upper[n] = newId;
+        ++newId;
+      }
+    }
+    ImageToMeshGrowArray(state->Points, newId);
+    double* coord = state->Points->GetPointer(3*firstId);
+    const vtkIdType* p = upper;
+    for (vtkIdType j=0; j<pd1; ++j)
+    {
+      for (vtkIdType i=0; i<pd0; ++i, ++p)
+      {
+        if (*p != -1)
+        {
+          if (state->OnCells)
+          {
+            input->TransformIndexToPhysicalPoint(state->WholeExtent[0] + int(i),
+                                                 state->WholeExtent[2] + int(j),
+                                                 state->WholeExtent[4] + int(k),
+                                                 coord);
+          }
+          else
+          {
+            coord[0] = state->CornerOrigin[0] + i*state->Spacing[0];
+            coord[1] = state->CornerOrigin[1] + j*state->Spacing[1];
+            coord[2] = state->CornerOrigin[2] + k*state->Spacing[2];
+          }
+          coord += 3;
+        }
+      }
+    }
+
+    // Emit the cells of layer k-1, which join planes k-1 and k.
+    if (previous)
+    {
+      vtkIdType newCellId = state->Scalars->GetNumberOfTuples();
+      vtkIdType numCells = newCellId;
+      for (vtkIdType n=0; n<layerSize; ++n)
+      {
+        numCells += (previous[n] != 0);
+      }
+      ImageToMeshGrowArray(state->Scalars, numCells);
+      ImageToMeshGrowArray(state->Connectivity, pointsPerCell*numCells);
+      T* outScalars = static_cast<T*>(state->Scalars->GetVoidPointer(0));
+      vtkIdType* conn = state->Connectivity->GetPointer(0);
+      const vtkIdType* lower = &state->LowerIds[0];
+      const T* v = previous;
+      for (vtkIdType j=0; j<cd1; ++j)
+      {
+        for (vtkIdType i=0; i<cd0; ++i, ++v)
+        {
+          if (*v != 0)
+          {
+            // VTK_VOXEL point order; see class documentation.
+            const vtkIdType n = j*pd0 + i;
+            vtkIdType* c = conn + pointsPerCell*newCellId;
+            c[0] = lower[n];
+            c[1] = lower[n+1];
+            c[2] = lower[n+pd0];
+            c[3] = lower[n+pd0+1];
+            c[4] = upper[n];
+            c[5] = upper[n+1];
+            c[6] = upper[n+pd0];
+            c[7] = upper[n+pd0+1];
+            outScalars[newCellId] = *v;
+            ++newCellId;
+          }
+        }
+      }
+    }
+
+    std::swap(state->LowerIds, state->UpperIds);
+    if (layer)
     {
-      pointMap->SetValue(pointIds->GetId(p), 1);   // 1 indicates old point is used.
+      std::copy(layer, layer + layerSize, previousLayer);
     }
   }
+}
+
+//----------------------------------------------------------------------------
+void vtkboneImageToMesh::GetStreamDivisionRange
+(
+  const int wholeExtent[6],
+  int division,
+  int range[2]
+)
+{
+  vtkIdType n = wholeExtent[5] - wholeExtent[4] + 1;
+  vtkIdType d = std::min(vtkIdType(this->NumberOfStreamDivisions), n);
+  // Consecutive divisions share one plane of points, so that every layer
+  // of cells is complete in exactly one division.
+  range[0] = int((n*division)/d);
+  range[1] = int(std::min((n*(division+1))/d, n-1));
+}
+
+//----------------------------------------------------------------------------
+int vtkboneImageToMesh::RequestUpdateExtent(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  if (this->NumberOfStreamDivisions <= 1)
+  {
+    return this->Superclass::RequestUpdateExtent(request, inputVector, outputVector);
   }
-  // Now go through and generate actual new Ids for new points (replacing all
-  // the 1's).
-  vtkIdType numOutputPoints = 0;
-  for (vtkIdType i=0; i<pointMap->GetNumberOfTuples(); i++)
+
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  int range[2];
+  this->GetStreamDivisionRange(wholeExtent, this->CurrentStreamDivision, range);
+  int updateExtent[6];
+  std::copy(wholeExtent, wholeExtent+6, updateExtent);
+  updateExtent[4] = wholeExtent[4] + range[0];
+  updateExtent[5] = wholeExtent[4] + range[1];
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExtent, 6);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkboneImageToMesh::AbortStreaming(vtkInformation* request)
+{
+  request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+  this->CurrentStreamDivision = 0;
+  delete this->StreamState;
+  this->StreamState = NULL;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneImageToMesh::RequestDataStreaming
+(
+  vtkInformation* request,
+  vtkImageData* input,
+  vtkUnstructuredGrid* output
+)
+{
+  vtkInformation *inInfo = this->GetInputInformation();
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  vtkIdType numDivisions = std::min(vtkIdType(this->NumberOfStreamDivisions),
+                                    vtkIdType(wholeExtent[5] - wholeExtent[4] + 1));
+
+  vtkDataArray* inputScalars = input->GetCellData()->GetScalars();
+  bool onCells = (inputScalars != NULL);
+  if (!onCells)
   {
-    if (pointMap->GetValue(i) != -1)
+    inputScalars = input->GetPointData()->GetScalars();
+    if (inputScalars == NULL)
     {
-      pointMap->SetValue(i, numOutputPoints);
-      numOutputPoints++;
+      vtkErrorMacro(<< "Image data has no data.\n");
+      this->AbortStreaming(request);
+      return 0;
     }
   }
+  if (inputScalars->GetNumberOfComponents() != 1)
+  {
+    vtkErrorMacro(<< "Input scalars must have a single component.");
+    this->AbortStreaming(request);
+    return 0;
+  }
 
-  // Generate the node coordinate list.
-  vtkSmartPointer<vtkDoubleArray> pointCoord = vtkSmartPointer<vtkDoubleArray>::New();
-  pointCoord->SetNumberOfComponents(3);
-  pointCoord->SetNumberOfTuples(numOutputPoints);
-  for (vtkIdType oldId=0; oldId < numInputPoints; oldId++)
+  if (this->CurrentStreamDivision == 0)
   {
-    vtkIdType newId = pointMap->GetValue(oldId);
-    if (newId != -1)
+    delete this->StreamState;
+    this->StreamState = new vtkboneImageToMeshStreamState;
+    vtkboneImageToMeshStreamState* state = this->StreamState;
+    state->OnCells = onCells;
+    std::copy(wholeExtent, wholeExtent+6, state->WholeExtent);
+    for (int a=0; a<3; ++a)
     {
-      pointCoord->SetTuple(newId, input->GetPoint(oldId));
+      state->VoxelDims[a] = wholeExtent[2*a+1] - wholeExtent[2*a] + (onCells ? 0 : 1);
     }
+    if ((state->VoxelDims[0]<1) || (state->VoxelDims[1]<1) || (state->VoxelDims[2]<1))
+    {
+      vtkErrorMacro(<<"This filter requires 3D input data.");
+      this->AbortStreaming(request);
+      return 0;
+    }
+    state->NumberOfLayers = state->VoxelDims[2];
+    double origin[3];
+    input->GetOrigin(origin);
+    input->GetSpacing(state->Spacing);
+    for (int a=0; a<3; ++a)
+    {
+      // Same as the origin set by GetInputAsCellScalars
+      state->CornerOrigin[a] = origin[a] + (wholeExtent[2*a] - 0.5) * state->Spacing[a];
+    }
+    state->NextLayer = 0;
+    vtkIdType planeSize = (state->VoxelDims[0]+1)*(state->VoxelDims[1]+1);
+    state->LowerIds.assign(planeSize, -1);
+    state->UpperIds.assign(planeSize, -1);
+    state->PreviousLayer = vtkSmartPointer<vtkDataArray>::Take(
+                vtkDataArray::CreateDataArray(inputScalars->GetDataType()));
+    state->PreviousLayer->SetNumberOfTuples(state->VoxelDims[0]*state->VoxelDims[1]);
+    state->Points = vtkSmartPointer<vtkDoubleArray>::New();
+    state->Points->SetNumberOfComponents(3);
+    state->Connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    state->Scalars = vtkSmartPointer<vtkDataArray>::Take(
+                vtkDataArray::CreateDataArray(inputScalars->GetDataType()));
+    state->Scalars->SetName("MaterialID");
+  }
+  vtkboneImageToMeshStreamState* state = this->StreamState;
+
+  // The layers of this division
+  int range[2];
+  this->GetStreamDivisionRange(wholeExtent, this->CurrentStreamDivision, range);
+  vtkIdType layerBegin = range[0];
+  bool finish = (this->CurrentStreamDivision == numDivisions - 1);
+  vtkIdType layerEnd = finish ? state->NumberOfLayers : vtkIdType(range[1]);
+
+  // Check that we received what we asked for.
+  int inExt[6];
+  input->GetExtent(inExt);
+  if (onCells != state->OnCells ||
+      inputScalars->GetDataType() != state->Scalars->GetDataType() ||
+      inExt[0] != wholeExtent[0] || inExt[1] != wholeExtent[1] ||
+      inExt[2] != wholeExtent[2] || inExt[3] != wholeExtent[3] ||
+      inExt[4] > wholeExtent[4] + range[0] ||
+      inExt[5] < wholeExtent[4] + range[1])
+  {
+    vtkErrorMacro(<< "Input does not cover the requested z-slab.");
+    this->AbortStreaming(request);
+    return 0;
+  }
+
+  switch (inputScalars->GetDataType())
+  {
+    vtkTemplateMacro(
+      ImageToMeshStreamLayers(state, input,
+        static_cast<const VTK_TT*>(inputScalars->GetVoidPointer(0)),
+        layerBegin, layerEnd, finish));
+    default:
+      vtkErrorMacro(<< "Unsupported data type for vtkboneImageToMesh input");
+      this->AbortStreaming(request);
+      return 0;
+  }
+  state->NextLayer = layerEnd;
+
+  if (!finish)
+  {
+    ++this->CurrentStreamDivision;
+    request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(), 1);
+    return 1;
   }
 
+  // Last division: assemble the output.
+  request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+  this->CurrentStreamDivision = 0;
+
+  const int pointsPerCell = 8;
+  vtkIdType numOutputCells = state->Scalars->GetNumberOfTuples();
+  // Release the spare capacity left by the geometric growth.
+  state->Points->Squeeze();
+  state->Connectivity->Squeeze();
+  state->Scalars->Squeeze();
+
   vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-  points->SetData(pointCoord);
+  points->SetData(state->Points);
   output->SetPoints(points);
 
-  // Generate Cell Array (i.e. list of point Ids associated with cells)
-  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
-  // The following allocation is exact
-  const int pointsPerCell = 8;
-  cells->Allocate(cells->EstimateSize(numOutputCells, pointsPerCell));
-  {  // scope
-  vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-  for (vtkIdType newCellId=0; newCellId < numOutputCells; newCellId++)
+  vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+  offsets->SetNumberOfTuples(numOutputCells+1);
+  for (vtkIdType n=0; n<=numOutputCells; ++n)
   {
-    input->GetCellPoints(reverseCellMap->GetValue(newCellId), pointIds);
-    for (int p=0; p < pointIds->GetNumberOfIds(); p++)
-    {
-      pointIds->SetId(p, pointMap->GetValue(pointIds->GetId(p)));
-    }
-    cells->InsertNextCell(pointIds);
-  }
+    offsets->SetValue(n, pointsPerCell*n);
   }
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetData(offsets, state->Connectivity);
   output->SetCells(VTK_VOXEL, cells);
+  output->GetCellData()->SetScalars(state->Scalars);
 
-  // Generate Cell scalars
-  vtkSmartPointer<vtkDataArray> outputScalars = vtkSmartPointer<vtkDataArray>::Take(
-                vtkDataArray::CreateDataArray(inputScalars->GetDataType()));
-  outputScalars->SetNumberOfTuples(numOutputCells);
-  outputScalars->SetName("MaterialID");
-  for (vtkIdType newCellId=0; newCellId < numOutputCells; newCellId++)
-  {
-    outputScalars->SetTuple(newCellId, reverseCellMap->GetValue(newCellId), inputScalars);
-  }
-  output->GetCellData()->SetScalars(outputScalars);
+  delete this->StreamState;
+  this->StreamState = NULL;
 
   return 1;
 }
 
 //----------------------------------------------------------------------------
 int vtkboneImageToMesh::RequestData(
-  vtkInformation *vtkNotUsed(request),
+  vtkInformation *request,
   vtkInformationVector **inputVector,
   vtkInformationVector *outputVector)
 {
@@ -232,6 +735,11 @@ int vtkboneImageToMesh::RequestData(
   vtkUnstructuredGrid *output = vtkUnstructuredGrid::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
+  if (this->NumberOfStreamDivisions > 1)
+  {
+    return this->RequestDataStreaming(request, unmodifiedInput, output);
+  }
+
   vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
   this->GetInputAsCellScalars(unmodifiedInput, input);
 
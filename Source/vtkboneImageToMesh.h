@@ -49,6 +49,16 @@
  The numbering of both the nodes and the elements of the output is sorted
  with increasing X,Y,Z values, with X being the fastest changing coordinate
  and Z the slowest.
+
+ Mesh generation is multithreaded with vtkSMPTools, working on z-slabs of
+ the image. The output is identical to that of a serial scan.
+
+ For images too large to hold in memory, set NumberOfStreamDivisions to a
+ value greater than 1. The filter then requests successive z-slab update
+ extents from the upstream pipeline, and appends points and cells as
+ each slab arrives. Only two planes of point ids and one layer of voxels
+ are retained between slabs, so peak memory is bounded by the output mesh
+ plus a few slices. The output is identical to the non-streaming output.
 */
 
 #ifndef __vtkboneImageToMesh_h
@@ -59,6 +69,7 @@
 
 // forward declarations
 class vtkImageData;
+class vtkboneImageToMeshStreamState;
 
 class VTKBONE_EXPORT vtkboneImageToMesh : public vtkUnstructuredGridAlgorithm
 {
@@ -68,14 +79,41 @@ public:
   void PrintSelf(ostream& os, vtkIndent indent) override;
   void Report(ostream& s);
 
+  //@{
+  /*! Set/Get the number of z-slabs the input is requested in. A value of
+      1 (the default) requests the whole input at once. Values larger
+      than the number of z slices are reduced to the number of z slices. */
+  vtkSetClampMacro(NumberOfStreamDivisions, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfStreamDivisions, int);
+  //@}
+
 protected:
   vtkboneImageToMesh();
   ~vtkboneImageToMesh();
 
   virtual int FillInputPortInformation(int port, vtkInformation* info) override;
 
+  virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
+  /*! Processes one z-slab in streaming mode. Sets CONTINUE_EXECUTING on
+      the request until the last slab has been processed. */
+  int RequestDataStreaming(vtkInformation* request,
+                           vtkImageData* input,
+                           vtkUnstructuredGrid* output);
+
+  /*! Ends streaming after an error: clears CONTINUE_EXECUTING on the
+      request and discards the partial results, so that the next update
+      starts again from the first division. */
+  void AbortStreaming(vtkInformation* request);
+
+  /*! Computes the range of point z-indices (relative to the whole
+      extent) requested for a stream division. */
+  void GetStreamDivisionRange(const int wholeExtent[6],
+                              int division,
+                              int range[2]);
+
   //@{
   /*! Returns the input if the input has the scalar data on the points;
       otherwise returns a new vtkImageData object that has the scalar data
@@ -87,6 +125,10 @@ protected:
   int GenerateHexahedrons(vtkImageData* input,
                           vtkUnstructuredGrid* output);
 
+  int NumberOfStreamDivisions;
+  int CurrentStreamDivision;
+  vtkboneImageToMeshStreamState* StreamState;
+
 private:
   // Prevent compiler from making default versions of these.
   vtkboneImageToMesh(const vtkboneImageToMesh&);
@@ -8,10 +8,20 @@
 #include "vtkObjectFactory.h"
 #include "vtkboneMacros.h"
 #include "vtkSmartPointer.h"
+#include "vtkStringArray.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkStaticCellLocator.h"
+#include "vtkGenericCell.h"
+#include "vtkPoints.h"
 #include "n88util/array.hpp"
 #include "n88util/exception.hpp"
 #include "boost/format.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <vector>
 
 #ifdef _WIN32
 #if (_MSC_VER < 1800)
@@ -26,7 +36,9 @@ vtkStandardNewMacro(vtkboneInterpolateCoarseSolution);
 //----------------------------------------------------------------------------
 vtkboneInterpolateCoarseSolution::vtkboneInterpolateCoarseSolution()
   :
-  SolutionArray (NULL)
+  SolutionArray (NULL),
+  InterpolatedData (vtkPointData::New()),
+  ArrayNames (vtkStringArray::New())
 {
   this->SetNumberOfInputPorts(2);
   this->SetNumberOfOutputPorts(0);
@@ -36,6 +48,38 @@ vtkboneInterpolateCoarseSolution::vtkboneInterpolateCoarseSolution()
 vtkboneInterpolateCoarseSolution::~vtkboneInterpolateCoarseSolution()
 {
   if (this->SolutionArray) { this->SolutionArray->Delete(); }
+  this->InterpolatedData->Delete();
+  this->ArrayNames->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkboneInterpolateCoarseSolution::AddArrayName(const char* name)
+{
+  this->ArrayNames->InsertNextValue(name);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkboneInterpolateCoarseSolution::RemoveAllArrayNames()
+{
+  this->ArrayNames->Reset();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkboneInterpolateCoarseSolution::GetNumberOfArrayNames()
+{
+  return this->ArrayNames->GetNumberOfValues();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkboneInterpolateCoarseSolution::GetArrayName(int i)
+{
+  if (i < 0 || i >= this->ArrayNames->GetNumberOfValues())
+  {
+    return NULL;
+  }
+  return this->ArrayNames->GetValue(i).c_str();
 }
 
 //----------------------------------------------------------------------------
@@ -62,13 +106,282 @@ int vtkboneInterpolateCoarseSolution::FillInputPortInformation(int port, vtkInfo
   return 1;
 }
 
-template <typename T> bool rel_comp(const T x, const T y, const T tol)
+namespace InterpolateCoarseSolution_Utility
+{
+
+//----------------------------------------------------------------------------
+// Sets grid[index] to the id of each point, where index is the linear index
+// (x fastest) of the point on the regular grid of dims and spacing.
+template <typename T>
+void InterpolateCoarseSolutionGridIds
+(
+  const T* coords,
+  vtkIdType num_points,
+  const double origin[3],
+  const double spacing[3],
+  const vtkIdType dims[3],
+  vtkIdType* grid
+)
+{
+  vtkSMPTools::For(0, num_points, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType p=begin; p<end; ++p)
+    {
+      const T* x = coords + 3*p;
+      vtkIdType index[3];
+      for (int a=0; a<3; ++a)
+      {
+        index[a] = vtkIdType(round((x[a] - origin[a])/spacing[a]));
+        index[a] = std::min(std::max(index[a], vtkIdType(0)), dims[a]-1);
+      }
+      grid[(index[2]*dims[1] + index[1])*dims[0] + index[0]] = p;
+    }
+  });
+}
+
+//----------------------------------------------------------------------------
+// A solution array of the reduced model, and the corresponding interpolated
+// array of the full model.
+struct InterpolateCoarseSolutionArray
+{
+  const void* reduced;
+  void* full;
+  int num_components;
+  int data_type;
+};
+
+//----------------------------------------------------------------------------
+// Sets tuple p of out to the weighted sum of the n tuples s of in.
+template <typename T>
+void InterpolateCoarseSolutionApply
+(
+  const T* in,
+  int num_components,
+  T* out,
+  vtkIdType p,
+  const vtkIdType* s,
+  const double* w,
+  int n
+)
+{
+  T* o = out + vtkIdType(num_components)*p;
+  for (int c=0; c<num_components; ++c)
+  {
+    double sum = 0;
+    for (int i=0; i<n; ++i)
+    {
+      sum += w[i]*in[vtkIdType(num_components)*s[i] + c];
+    }
+    o[c] = T(sum);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Applies the stencil of full point p to each array.  An empty stencil sets
+// the values to zero.
+void InterpolateCoarseSolutionApplyAll
+(
+  const std::vector<InterpolateCoarseSolutionArray>& arrays,
+  vtkIdType p,
+  const vtkIdType* s,
+  const double* w,
+  int n
+)
+{
+  for (size_t a=0; a<arrays.size(); ++a)
+  {
+    const InterpolateCoarseSolutionArray& array = arrays[a];
+    if (array.data_type == VTK_FLOAT)
+    {
+      InterpolateCoarseSolutionApply(static_cast<const float*>(array.reduced),
+        array.num_components, static_cast<float*>(array.full), p, s, w, n);
+    }
+    else
+    {
+      InterpolateCoarseSolutionApply(static_cast<const double*>(array.reduced),
+        array.num_components, static_cast<double*>(array.full), p, s, w, n);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Computes the trilinear interpolation stencil of the full point x from the
+// grid of reduced point ids, and returns its size.  The ratio of the
+// spacings is arbitrary.  A full point lying (within tol grid units) on a
+// plane of reduced points has only the reduced points on that plane in its
+// stencil, so that with a factor of two, for example, the stencils have 1,
+// 2, 4 or 8 points.  Returns 0 if any required reduced point does not exist.
+template <typename T>
+int InterpolateCoarseSolutionGridStencil
+(
+  const T* x,
+  const double origin[3],
+  const double spacing[3],
+  const vtkIdType* grid,
+  const vtkIdType dims[3],
+  double tol,
+  vtkIdType* s,
+  double* w
+)
+{
+  vtkIdType index[3];
+  double t[3];
+  vtkIdType upper[3];
+  for (int a=0; a<3; ++a)
+  {
+    const double u = (x[a] - origin[a])/spacing[a];
+    index[a] = vtkIdType(std::floor(u + tol));
+    t[a] = u - index[a];
+    if (t[a] < tol)
+    {
+      t[a] = 0;
+    }
+    else if (t[a] > 1 - tol)
+    {
+      ++index[a];
+      t[a] = 0;
+    }
+    upper[a] = (t[a] == 0) ? 0 : 1;
+    if (index[a] < 0 || index[a] + upper[a] >= dims[a])
+    {
+      return 0;
+    }
+  }
+  int n = 0;
+  for (vtkIdType dk=0; dk<=upper[2]; ++dk)
+  {
+    const double wk = dk ? t[2] : 1 - t[2];
+    for (vtkIdType dj=0; dj<=upper[1]; ++dj)
+    {
+      const double wj = dj ? t[1] : 1 - t[1];
+      const vtkIdType* row = grid + ((index[2]+dk)*dims[1] + index[1]+dj)*dims[0] + index[0];
+      for (vtkIdType di=0; di<=upper[0]; ++di)
+      {
+        if (row[di] < 0)
+        {
+          return 0;
+        }
+        s[n] = row[di];
+        w[n] = wk*wj*(di ? t[0] : 1 - t[0]);
+        ++n;
+      }
+    }
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------------
+// Interpolates each array at the full points using the grid of reduced
+// point ids.  The stencils are computed and applied block by block, so
+// that no per-point stencils are stored.  Points without a grid stencil
+// are set to zero and added to the thread-local missing lists.
+template <typename T>
+void InterpolateCoarseSolutionFromGrid
+(
+  const T* coords,
+  vtkIdType num_points,
+  const double origin[3],
+  const double spacing[3],
+  const vtkIdType* grid,
+  const vtkIdType dims[3],
+  double tol,
+  const std::vector<InterpolateCoarseSolutionArray>& arrays,
+  vtkSMPThreadLocal<std::vector<vtkIdType> >& missing
+)
+{
+  vtkSMPTools::For(0, num_points, [&](vtkIdType begin, vtkIdType end)
+  {
+    std::vector<vtkIdType>& local_missing = missing.Local();
+    vtkIdType s[8];
+    double w[8];
+    for (vtkIdType p=begin; p<end; ++p)
+    {
+      const int n = InterpolateCoarseSolutionGridStencil(coords + 3*p,
+                      origin, spacing, grid, dims, tol, s, w);
+      if (n == 0)
+      {
+        local_missing.push_back(p);
+      }
+      InterpolateCoarseSolutionApplyAll(arrays, p, s, w, n);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------
+// Interpolates each array at the missing points, using the reduced voxel
+// closest to each point.  Points outside the reduced model are assigned
+// the values at the closest point of the closest voxel.  The points are
+// processed in parallel; the locator queries are thread-safe given a
+// cell per thread.  Returns the number of points for which no voxel was
+// found, which are left at zero.
+vtkIdType InterpolateCoarseSolutionFromLocator
+(
+  vtkPoints* points,
+  vtkboneFiniteElementModel* reduced_model,
+  const std::vector<vtkIdType>& missing,
+  const std::vector<InterpolateCoarseSolutionArray>& arrays
+)
 {
-  if (x==0) return (x==y);
-  T d = std::abs((x-y)/x);
-  return (d < tol);
+  if (missing.empty())
+  {
+    return 0;
+  }
+  vtkSmartPointer<vtkStaticCellLocator> locator =
+    vtkSmartPointer<vtkStaticCellLocator>::New();
+  locator->SetDataSet(reduced_model);
+  locator->BuildLocator();
+  vtkSMPThreadLocalObject<vtkGenericCell> local_cell;
+  std::atomic<vtkIdType> unresolved (0);
+  vtkSMPTools::For(0, vtkIdType(missing.size()), [&](vtkIdType begin, vtkIdType end)
+  {
+    vtkGenericCell* cell = local_cell.Local();
+    vtkIdType s[8];
+    double w[8];
+    for (vtkIdType m=begin; m<end; ++m)
+    {
+      const vtkIdType p = missing[m];
+      double x[3];
+      points->GetPoint(p, x);
+      double closest[3];
+      vtkIdType cellId = -1;
+      int subId;
+      double dist2;
+      locator->FindClosestPoint(x, closest, cell, cellId, subId, dist2);
+      if (cellId < 0)
+      {
+        ++unresolved;
+        continue;
+      }
+      reduced_model->GetCell(cellId, cell);
+      // Voxel points are ordered x fastest, so the parametric coordinates
+      // give the trilinear weights directly.
+      double p0[3];
+      double p7[3];
+      reduced_model->GetPoint(cell->GetPointId(0), p0);
+      reduced_model->GetPoint(cell->GetPointId(7), p7);
+      double t[3];
+      for (int a=0; a<3; ++a)
+      {
+        t[a] = (closest[a] - p0[a])/(p7[a] - p0[a]);
+        t[a] = std::min(std::max(t[a], 0.0), 1.0);
+      }
+      for (int i=0; i<8; ++i)
+      {
+        s[i] = cell->GetPointId(i);
+        w[i] = ((i & 1) ? t[0] : 1 - t[0]) *
+               ((i & 2) ? t[1] : 1 - t[1]) *
+               ((i & 4) ? t[2] : 1 - t[2]);
+      }
+      InterpolateCoarseSolutionApplyAll(arrays, p, s, w, 8);
+    }
+  });
+  return unresolved;
 }
 
+}  // namespace
+
+using namespace InterpolateCoarseSolution_Utility;
+
 //----------------------------------------------------------------------------
 int vtkboneInterpolateCoarseSolution::RequestData
 (
@@ -116,14 +429,6 @@ int vtkboneInterpolateCoarseSolution::RequestData
     vtkErrorMacro(<<"Unsupported Cell Type.");
     return VTK_ERROR;
   }
-  double full_spacing[3];
-  full_spacing[0] = full_model->GetPoint(cell->GetPointId(1))[0] - full_model->GetPoint(cell->GetPointId(0))[0];
-  full_spacing[1] = full_model->GetPoint(cell->GetPointId(2))[1] - full_model->GetPoint(cell->GetPointId(0))[1];
-  full_spacing[2] = full_model->GetPoint(cell->GetPointId(4))[2] - full_model->GetPoint(cell->GetPointId(0))[2];
-  // std::cout << "full spacing = "
-  //           << full_spacing[0] << ", "
-  //           << full_spacing[1] << ", "
-  //           << full_spacing[2] << "\n";
 
   cell = reduced_model->GetCell(0);
   if (cell->GetCellType() != VTK_VOXEL)
@@ -140,18 +445,6 @@ int vtkboneInterpolateCoarseSolution::RequestData
   //           << reduced_spacing[1] << ", "
   //           << reduced_spacing[2] << "\n";
 
-  double tol = 1E-4;
-  n88_verbose_assert (rel_comp(2*full_spacing[0],reduced_spacing[0],tol) &&
-  	                  rel_comp(2*full_spacing[1],reduced_spacing[1],tol) &&
-  	                  rel_comp(2*full_spacing[2],reduced_spacing[2],tol),
-    "Spacing of reduced resolution must be exactly twice that of full resolution");
-
-  double full_bounds[6];
-  full_model->GetBounds(full_bounds);
-  // std::cout << "Full bounds:\n"
-  //           << format("  %10.4f%10.4f\n") % full_bounds[0] % full_bounds[1]
-  //           << format("  %10.4f%10.4f\n") % full_bounds[2] % full_bounds[3]
-  //           << format("  %10.4f%10.4f\n") % full_bounds[4] % full_bounds[5];
   double reduced_bounds[6];
   reduced_model->GetBounds(reduced_bounds);
   // std::cout << "Reduced bounds:\n"
@@ -159,180 +452,114 @@ int vtkboneInterpolateCoarseSolution::RequestData
   //           << format("  %10.4f%10.4f\n") % reduced_bounds[2] % reduced_bounds[3]
   //           << format("  %10.4f%10.4f\n") % reduced_bounds[4] % reduced_bounds[5];
 
-  tol = 1E-2 * full_spacing[0];  // scale tolerance by spacing.
-  n88_verbose_assert (full_bounds[0] >= reduced_bounds[0] - tol &&
-  	                  full_bounds[1] <= reduced_bounds[1] + tol &&
-  	                  full_bounds[2] >= reduced_bounds[2] - tol &&
-  	                  full_bounds[3] <= reduced_bounds[3] + tol &&
-  	                  full_bounds[4] >= reduced_bounds[4] - tol &&
-  	                  full_bounds[5] <= reduced_bounds[5] + tol,
-    "Full bounds must be interior to reduced bounds");
-
-  vtkDataArray* reduced_data = reduced_model->GetPointData()->GetArray("Displacement");
-  if (!reduced_data)
+  // The arrays to interpolate
+  std::vector<vtkDataArray*> reduced_arrays;
+  if (this->ArrayNames->GetNumberOfValues() == 0)
   {
-    vtkErrorMacro(<<"Solution not found in reduced model.");
-    return VTK_ERROR;
+    reduced_arrays.push_back(reduced_model->GetPointData()->GetArray("Displacement"));
   }
-
-  // To easily index the values of the reduced model, we will put on a regular grid.
-  // x fastest, z slowest
-  n88::tuplet<4,size_t> grid_dims(
-    (size_t)(round((reduced_bounds[5]-reduced_bounds[4])/reduced_spacing[2]) + 1),
-    (size_t)(round((reduced_bounds[3]-reduced_bounds[2])/reduced_spacing[1]) + 1),
-    (size_t)(round((reduced_bounds[1]-reduced_bounds[0])/reduced_spacing[0]) + 1),
-    3);
-  n88::array<4,float> reduced_grid (grid_dims);
-  // Set all to EMPTY in order to trap incorrect indices
-  float EMPTY = std::numeric_limits<float>::max();
-  for (size_t i=0; i<reduced_grid.size(); ++i)
+  else
   {
-    reduced_grid[i] = EMPTY;
+    for (vtkIdType n=0; n<this->ArrayNames->GetNumberOfValues(); ++n)
+    {
+      reduced_arrays.push_back(reduced_model->GetPointData()->GetArray(
+                                 this->ArrayNames->GetValue(n).c_str()));
+    }
   }
-
-  for (vtkIdType p=0; p<reduced_model->GetNumberOfPoints(); ++p)
+  for (size_t n=0; n<reduced_arrays.size(); ++n)
   {
-    double* coords = reduced_model->GetPoint(p);
-    size_t index[3];
-    index[0] = size_t(round((coords[0] - reduced_bounds[0])/reduced_spacing[0]));
-    index[1] = size_t(round((coords[1] - reduced_bounds[2])/reduced_spacing[1]));
-    index[2] = size_t(round((coords[2] - reduced_bounds[4])/reduced_spacing[2]));
-    double* displacement = reduced_data->GetTuple3(p);
-    reduced_grid(index[2],index[1],index[0],0) = displacement[0];
-    reduced_grid(index[2],index[1],index[0],1) = displacement[1];
-    reduced_grid(index[2],index[1],index[0],2) = displacement[2];
+    if (!reduced_arrays[n])
+    {
+      vtkErrorMacro(<<"Solution not found in reduced model.");
+      return VTK_ERROR;
+    }
+    if (reduced_arrays[n]->GetDataType() != VTK_FLOAT &&
+        reduced_arrays[n]->GetDataType() != VTK_DOUBLE)
+    {
+      vtkErrorMacro(<<"Solution arrays must be float or double.");
+      return VTK_ERROR;
+    }
   }
 
-  vtkFloatArray* full_data = vtkFloatArray::New();
-  full_data->SetNumberOfComponents(3);
-  full_data->SetNumberOfTuples(full_model->GetNumberOfPoints());
-  full_data->SetName("Displacement");
+  // To easily index the points of the reduced model, we will put their ids
+  // on a regular grid.  x fastest, z slowest
+  const vtkIdType grid_dims[3] = {
+    vtkIdType(round((reduced_bounds[1]-reduced_bounds[0])/reduced_spacing[0]) + 1),
+    vtkIdType(round((reduced_bounds[3]-reduced_bounds[2])/reduced_spacing[1]) + 1),
+    vtkIdType(round((reduced_bounds[5]-reduced_bounds[4])/reduced_spacing[2]) + 1)};
+  std::vector<vtkIdType> reduced_grid (grid_dims[0]*grid_dims[1]*grid_dims[2], -1);
+  {
+    const double origin[3] = {reduced_bounds[0], reduced_bounds[2], reduced_bounds[4]};
+    vtkDataArray* coords = reduced_model->GetPoints()->GetData();
+    switch (coords->GetDataType())
+    {
+      vtkTemplateMacro(InterpolateCoarseSolutionGridIds(
+        static_cast<const VTK_TT*>(coords->GetVoidPointer(0)),
+        reduced_model->GetNumberOfPoints(), origin, reduced_spacing, grid_dims,
+        reduced_grid.data()));
+    }
+  }
 
-  // Trap attempts to index nodes that do not exist in the reduced input.
-  // This will avoid generating garbage in case the two inputs do not
-  // correspond.
-  try
+  // The interpolated arrays, allocated before the interpolation so that
+  // all arrays are computed in a single pass over the full points.
+  const vtkIdType num_full_points = full_model->GetNumberOfPoints();
+  this->InterpolatedData->Initialize();
+  std::vector<InterpolateCoarseSolutionArray> arrays (reduced_arrays.size());
+  for (size_t n=0; n<reduced_arrays.size(); ++n)
   {
+    vtkDataArray* reduced_data = reduced_arrays[n];
+    vtkSmartPointer<vtkDataArray> full_data = vtkSmartPointer<vtkDataArray>::Take(
+      vtkDataArray::CreateDataArray(reduced_data->GetDataType()));
+    full_data->SetNumberOfComponents(reduced_data->GetNumberOfComponents());
+    full_data->SetNumberOfTuples(num_full_points);
+    full_data->SetName(reduced_data->GetName());
+    this->InterpolatedData->AddArray(full_data);
+    arrays[n].reduced = reduced_data->GetVoidPointer(0);
+    arrays[n].full = full_data->GetVoidPointer(0);
+    arrays[n].num_components = reduced_data->GetNumberOfComponents();
+    arrays[n].data_type = reduced_data->GetDataType();
+  }
 
-    for (vtkIdType p=0; p<full_model->GetNumberOfPoints(); ++p)
+  // Each full point is interpolated from the (up to 8) reduced points
+  // surrounding it.  When the reduced points are on the same grid as the
+  // full points, as when the spacing ratio is an integer, all points are
+  // interpolated using the grid of reduced points.  Full points not
+  // surrounded by reduced points, which can occur at the boundaries for
+  // other spacing ratios, are located using the reduced cells.
+  vtkSMPThreadLocal<std::vector<vtkIdType> > local_missing;
+  {
+    const double origin[3] = {reduced_bounds[0], reduced_bounds[2], reduced_bounds[4]};
+    vtkDataArray* coords = full_model->GetPoints()->GetData();
+    switch (coords->GetDataType())
     {
-      double* coords = full_model->GetPoint(p);
-      size_t index[3];
-      index[0] = size_t(round((coords[0] - full_bounds[0])/full_spacing[0]));
-      index[1] = size_t(round((coords[1] - full_bounds[2])/full_spacing[1]));
-      index[2] = size_t(round((coords[2] - full_bounds[4])/full_spacing[2]));
-      size_t odd[3];
-      odd[0] = index[0] % 2;
-      odd[1] = index[1] % 2;
-      odd[2] = index[2] % 2;
-      index[0] /= 2;
-      index[1] /= 2;
-      index[2] /= 2;
-      n88_assert (index[0] < reduced_grid.dims()[2]);
-      n88_assert (index[1] < reduced_grid.dims()[1]);
-      n88_assert (index[2] < reduced_grid.dims()[0]);
-      if (!odd[0] && !odd[1] && !odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          full_data->SetComponent(p,i,reduced_grid(index[2],index[1],index[0],i)); }
-      }
-      else if (odd[0] && !odd[1] && !odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1],index[0]+1,i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2],index[1],index[0]  ,i) +
-             reduced_grid(index[2],index[1],index[0]+1,i))/2); }
-      }
-      else if (!odd[0] && odd[1] && !odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1]+1,index[0],i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2],index[1]  ,index[0],i) +
-             reduced_grid(index[2],index[1]+1,index[0],i))/2); }
-      }
-      else if (!odd[0] && !odd[1] && odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1],index[0],i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2]  ,index[1],index[0],i) +
-             reduced_grid(index[2]+1,index[1],index[0],i))/2); }
-      }
-      else if (!odd[0] && odd[1] && odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1]+1,index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1]+1,index[0],i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2]  ,index[1]  ,index[0],i) +
-             reduced_grid(index[2]  ,index[1]+1,index[0],i) +
-             reduced_grid(index[2]+1,index[1]  ,index[0],i) +
-             reduced_grid(index[2]+1,index[1]+1,index[0],i))/4); }
-      }
-      else if (odd[0] && !odd[1] && odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1],index[0]+1,i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1],index[0]+1,i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2]  ,index[1],index[0]  ,i) +
-             reduced_grid(index[2]  ,index[1],index[0]+1,i) +
-             reduced_grid(index[2]+1,index[1],index[0]  ,i) +
-             reduced_grid(index[2]+1,index[1],index[0]+1,i))/4); }
-      }
-      else if (odd[0] && odd[1] && !odd[2])
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1],index[0]+1,i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1]+1,index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1]+1,index[0]+1,i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2],index[1]  ,index[0]  ,i) +
-             reduced_grid(index[2],index[1]  ,index[0]+1,i) +
-             reduced_grid(index[2],index[1]+1,index[0]  ,i) +
-             reduced_grid(index[2],index[1]+1,index[0]+1,i))/4); }
-      }
-      else // all odd
-      {
-        for (size_t i=0; i<3; ++i) {
-          n88_assert (reduced_grid(index[2],index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1],index[0]+1,i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1]+1,index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2],index[1]+1,index[0]+1,i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1],index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1],index[0]+1,i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1]+1,index[0],i) != EMPTY);
-          n88_assert (reduced_grid(index[2]+1,index[1]+1,index[0]+1,i) != EMPTY);
-          full_data->SetComponent(p,i,
-            (reduced_grid(index[2]  ,index[1]  ,index[0]  ,i) +
-             reduced_grid(index[2]  ,index[1]  ,index[0]+1,i) +
-             reduced_grid(index[2]  ,index[1]+1,index[0]  ,i) +
-             reduced_grid(index[2]  ,index[1]+1,index[0]+1,i) +
-             reduced_grid(index[2]+1,index[1]  ,index[0]  ,i) +
-             reduced_grid(index[2]+1,index[1]  ,index[0]+1,i) +
-             reduced_grid(index[2]+1,index[1]+1,index[0]  ,i) +
-             reduced_grid(index[2]+1,index[1]+1,index[0]+1,i))/8); }
-      }
+      vtkTemplateMacro(InterpolateCoarseSolutionFromGrid(
+        static_cast<const VTK_TT*>(coords->GetVoidPointer(0)),
+        num_full_points, origin, reduced_spacing, reduced_grid.data(), grid_dims,
+        1E-4, arrays, local_missing));
     }
   }
-  catch (n88::n88_exception e)
+  std::vector<vtkIdType>().swap(reduced_grid);
+  std::vector<vtkIdType> missing;
+  for (vtkSMPThreadLocal<std::vector<vtkIdType> >::iterator it = local_missing.begin();
+       it != local_missing.end(); ++it)
   {
-    vtkErrorMacro(<<"Exception: " << e.what()
-                  << " FILE: " << e.file()
-                  << " LINE: " << e.line());
-    return VTK_ERROR;
+    missing.insert(missing.end(), it->begin(), it->end());
+  }
+  const vtkIdType unresolved = InterpolateCoarseSolutionFromLocator(
+    full_model->GetPoints(), reduced_model, missing, arrays);
+  if (unresolved > 0)
+  {
+    vtkWarningMacro(<< unresolved << " points of the full model could not be located"
+                       " in the reduced model; their interpolated values are zero.");
+  }
+
+  // SolutionArray is the Displacement, or otherwise the first array.
+  vtkDataArray* full_data = this->InterpolatedData->GetArray("Displacement");
+  if (!full_data)
+  {
+    full_data = this->InterpolatedData->GetArray(0);
   }
+  full_data->Register(this);
 
   if (this->SolutionArray) { this->SolutionArray->Delete(); }
   this->SolutionArray = full_data;
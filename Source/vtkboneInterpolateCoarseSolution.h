@@ -21,6 +21,21 @@
  obtained can be added to the original model. The solution is interpolated to
  grid points (nodes) that are not present in the coarsened problem.
 
+ The solution is interpolated trilinearly. The spacing of the coarse model
+ need not be twice that of the full model: any ratio is supported. Nodes of
+ the full model are looked up on the regular grid of coarse nodes where
+ possible, which is always the case when the ratio is an integer and the
+ grids are aligned; otherwise the closest coarse element is located, and
+ nodes outside the coarse model take the values at the closest point of
+ the coarse model.
+
+ By default only the point array "Displacement" is interpolated. Any number of
+ point arrays (for example displacement together with other nodal solution
+ fields) can instead be selected with AddArrayName; they are interpolated in
+ a single pass, sharing the interpolation stencils, which are computed
+ block by block in parallel rather than stored for all nodes. Arrays must
+ be of type float or double, and the interpolated arrays have the same type.
+
     @sa
  vtkboneFiniteElementModel vtkboneCoarsenModel vtkboneDecimateImage
 */
@@ -31,6 +46,9 @@
 #include "vtkboneFiniteElementModelAlgorithm.h"
 #include "vtkboneWin32Header.h"
 
+class vtkPointData;
+class vtkStringArray;
+
 class VTKBONE_EXPORT vtkboneInterpolateCoarseSolution : public vtkboneFiniteElementModelAlgorithm
 {
 public:
@@ -38,8 +56,23 @@ public:
   vtkTypeMacro(vtkboneInterpolateCoarseSolution,vtkboneFiniteElementModelAlgorithm);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
+  /*! The interpolated "Displacement" array, or if "Displacement" was not
+      selected, the first interpolated array. */
   vtkGetObjectMacro(SolutionArray, vtkDataArray);
 
+  /*! All the interpolated arrays, with the same names as the corresponding
+      arrays of the reduced model. */
+  vtkGetObjectMacro(InterpolatedData, vtkPointData);
+
+  //@{
+  /*! Select the point arrays of the reduced model to interpolate. If none
+      are selected, "Displacement" is interpolated. */
+  void AddArrayName(const char* name);
+  void RemoveAllArrayNames();
+  int GetNumberOfArrayNames();
+  const char* GetArrayName(int i);
+  //@}
+
 protected:
   vtkboneInterpolateCoarseSolution();
   ~vtkboneInterpolateCoarseSolution();
@@ -51,6 +84,8 @@ protected:
   virtual int FillInputPortInformation(int port, vtkInformation *info) override;
 
   vtkDataArray* SolutionArray;
+  vtkPointData* InterpolatedData;
+  vtkStringArray* ArrayNames;
 
 private:
   vtkboneInterpolateCoarseSolution(const vtkboneInterpolateCoarseSolution&);  // Not implemented.
@@ -16,12 +16,14 @@
 #include "vtkObjectFactory.h"
 #include "vtkIntArray.h"
 #include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
 #include "vtkDoubleArray.h"
 #include "vtkCharArray.h"
 #include "vtkCellArray.h"
 #include "vtkDataArrayCollection.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
+#include "vtkStringArray.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
@@ -36,8 +38,11 @@
 #else
 #include "netcdf.h"
 #endif
+#include "vtkTypeInt64Array.h"
+#include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
 // This can only be used in a function that can return VTK_ERROR.
 // NOTE: This macro should be used very sparingly in the read.
@@ -53,6 +58,89 @@
   } \
 }
 
+//-----------------------------------------------------------------------
+// Returns the number of rows (extent along the first dimension) of the
+// chunks of a variable, or a default suited to 8-byte elements if the
+// variable is not chunked.
+static size_t vtkboneN88ModelReader_ChunkRows (int ncid, int varid)
+{
+  int ndims = 0;
+  if (nc_inq_varndims (ncid, varid, &ndims) == NC_NOERR &&
+      ndims >= 1 && ndims <= NC_MAX_VAR_DIMS)
+  {
+    int storage = NC_CONTIGUOUS;
+    std::vector<size_t> chunksizes (ndims);
+    if (nc_inq_var_chunking (ncid, varid, &storage, chunksizes.data()) == NC_NOERR &&
+        storage == NC_CHUNKED && chunksizes[0] > 0)
+      { return chunksizes[0]; }
+  }
+  return size_t(1) << 16;
+}
+
+//-----------------------------------------------------------------------
+// For partial reads, rows separated by at most this many unwanted rows are
+// read with a single call, as the overhead of a call exceeds the cost of
+// reading a few extra rows.
+const size_t RUN_GAP_ROWS = 16;
+
+//-----------------------------------------------------------------------
+// Reads the rows ids (0-indexed, unsorted, possibly repeated) of variable
+// varid, which has dimensions dims, into out, one row per id in the order
+// of ids.  The ids are sorted and grouped into runs of at most
+// maxRunBytes (but at least one row), and each run is read with one call
+// to nc_get_vara_float.  The ids must be in range.
+static int vtkboneN88ModelReader_ReadRows
+(
+  int ncid,
+  int varid,
+  int ndims,
+  const size_t* dims,
+  vtkIdTypeArray* ids,
+  size_t maxRunBytes,
+  float* out
+)
+{
+  size_t rowLength = 1;
+  for (int d=1; d<ndims; ++d)
+    { rowLength *= dims[d]; }
+  const vtkIdType n = ids->GetNumberOfValues();
+  std::vector<std::pair<vtkIdType,vtkIdType> > order (n);
+  for (vtkIdType i=0; i<n; ++i)
+    { order[i] = std::make_pair (ids->GetValue(i), i); }
+  std::sort (order.begin(), order.end());
+
+  size_t start[NC_MAX_VAR_DIMS];
+  size_t count[NC_MAX_VAR_DIMS];
+  for (int d=1; d<ndims; ++d)
+  {
+    start[d] = 0;
+    count[d] = dims[d];
+  }
+  const size_t maxRunRows = std::max (size_t(1), maxRunBytes / (sizeof(float)*rowLength));
+  std::vector<float> buffer;
+  vtkIdType a = 0;
+  while (a < n)
+  {
+    const vtkIdType first = order[a].first;
+    vtkIdType b = a + 1;
+    while (b < n && size_t(order[b].first - order[b-1].first) <= RUN_GAP_ROWS + 1 &&
+           size_t(order[b].first - first) < maxRunRows)
+      { ++b; }
+    start[0] = first;
+    count[0] = order[b-1].first - first + 1;
+    buffer.resize (count[0]*rowLength);
+    int status = nc_get_vara_float (ncid, varid, start, count, buffer.data());
+    if (status != NC_NOERR)
+      { return status; }
+    for (vtkIdType k=a; k<b; ++k)
+    {
+      const float* row = &buffer[(order[k].first - first)*rowLength];
+      std::copy (row, row + rowLength, out + order[k].second*rowLength);
+    }
+    a = b;
+  }
+  return NC_NOERR;
+}
 
 vtkStandardNewMacro(vtkboneN88ModelReader);
 
@@ -60,7 +148,16 @@ vtkStandardNewMacro(vtkboneN88ModelReader);
 vtkboneN88ModelReader::vtkboneN88ModelReader()
 {
   this->FileName = NULL;
+  this->ReadGeometry = 1;
   this->ReadMaterials = 1;
+  this->ReadBoundaryConditions = 1;
+  this->ReadNodeAndElementSets = 1;
+  this->ReadSolutionValues = 1;
+  this->MaximumPartialReadSize = 1<<22;
+  this->SolutionArrayNames = vtkStringArray::New();
+  this->NodeValueNames = vtkStringArray::New();
+  this->ElementValueNames = vtkStringArray::New();
+  this->GaussPointValueNames = vtkStringArray::New();
   this->SetNumberOfInputPorts(0);
   this->ActiveSolution = NULL;
   this->ActiveProblem = NULL;
@@ -74,6 +171,10 @@ vtkboneN88ModelReader::~vtkboneN88ModelReader()
   this->SetActiveSolution(NULL);
   this->SetActiveProblem(NULL);
   this->SetActivePart(NULL);
+  this->SolutionArrayNames->Delete();
+  this->NodeValueNames->Delete();
+  this->ElementValueNames->Delete();
+  this->GaussPointValueNames->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -82,6 +183,76 @@ void vtkboneN88ModelReader::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os,indent);
   os << indent << "File Name: "
      << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "ReadGeometry: " << this->ReadGeometry << "\n";
+  os << indent << "ReadMaterials: " << this->ReadMaterials << "\n";
+  os << indent << "ReadBoundaryConditions: " << this->ReadBoundaryConditions << "\n";
+  os << indent << "ReadNodeAndElementSets: " << this->ReadNodeAndElementSets << "\n";
+  os << indent << "ReadSolutionValues: " << this->ReadSolutionValues << "\n";
+  os << indent << "MaximumPartialReadSize: " << this->MaximumPartialReadSize << "\n";
+  os << indent << "SolutionArrayNames:";
+  if (this->SolutionArrayNames->GetNumberOfValues() == 0)
+    { os << " (all)"; }
+  for (vtkIdType i=0; i<this->SolutionArrayNames->GetNumberOfValues(); ++i)
+    { os << " " << this->SolutionArrayNames->GetValue(i); }
+  os << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkboneN88ModelReader::AddSolutionArrayName(const char* name)
+{
+  if (name == NULL)
+  {
+    vtkErrorMacro("Array name must be specified.");
+    return;
+  }
+  this->SolutionArrayNames->InsertNextValue(name);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkboneN88ModelReader::RemoveAllSolutionArrayNames()
+{
+  this->SolutionArrayNames->Reset();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkboneN88ModelReader::IsSolutionArraySelected(const char* name)
+{
+  return (this->SolutionArrayNames->GetNumberOfValues() == 0 ||
+          this->SolutionArrayNames->LookupValue(name) >= 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::RequestInformation(
+                               vtkInformation *,
+                               vtkInformationVector **,
+                               vtkInformationVector *)
+{
+  this->NodeValueNames->Reset();
+  this->ElementValueNames->Reset();
+  this->GaussPointValueNames->Reset();
+
+  if (!this->FileName)
+  {
+    vtkErrorMacro("FileName not set.");
+    return VTK_ERROR;
+  }
+
+  int ncid;
+  int status = nc_open (this->FileName, NC_NOWRITE, &ncid);
+  if (status != NC_NOERR)
+  {
+    vtkErrorMacro(<< "Unable to open file " << this->FileName
+                  << " ; NetCDF error " <<  nc_strerror(status) << ".");
+    return VTK_ERROR;
+  }
+
+  status = this->ListSolutionVariables (ncid);
+
+  nc_close (ncid);
+
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -140,16 +311,31 @@ int vtkboneN88ModelReader::ReadDataFromNetCDFFile
 {
   if (this->ReadAttributes(ncid, model) == VTK_ERROR) return VTK_ERROR;
   if (this->ReadProblem(ncid, model) == VTK_ERROR) return VTK_ERROR;
-  if (this->ReadNodes(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  if (this->ReadGeometry != 0)
+  {
+    if (this->ReadNodes(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  }
   if (this->ReadMaterials != 0)
   {
     if (this->ReadMaterialTable(ncid, model) == VTK_ERROR) return VTK_ERROR;
   }
-  if (this->ReadElements(ncid, model) == VTK_ERROR) return VTK_ERROR;
-  if (this->ReadConstraints(ncid, model) == VTK_ERROR) return VTK_ERROR;
-  if (this->ReadConvergenceSet(ncid, model) == VTK_ERROR) return VTK_ERROR;
-  if (this->ReadSets(ncid, model) == VTK_ERROR) return VTK_ERROR;
-  if (this->ReadSolutions(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  if (this->ReadGeometry != 0)
+  {
+    if (this->ReadElements(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  }
+  if (this->ReadBoundaryConditions != 0)
+  {
+    if (this->ReadConstraints(ncid, model) == VTK_ERROR) return VTK_ERROR;
+    if (this->ReadConvergenceSet(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  }
+  if (this->ReadNodeAndElementSets != 0)
+  {
+    if (this->ReadSets(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  }
+  if (this->ReadGeometry != 0 && this->ReadSolutionValues != 0)
+  {
+    if (this->ReadSolutions(ncid, model) == VTK_ERROR) return VTK_ERROR;
+  }
   return VTK_OK;
 }
 
@@ -1105,24 +1291,29 @@ int vtkboneN88ModelReader::ReadElements
   NC_SAFE_CALL (nc_inq_vardimid(hexahedrons_ncid, elementNumber_varid, dimid));
   size_t elementNumber_len = 0;
   NC_SAFE_CALL (nc_inq_dimlen(hexahedrons_ncid, dimid[0], &elementNumber_len));
-  std::vector<vtkIdType> ids_input;
-  ids_input.resize(elementNumber_len);
-  // The following call crashes on Linux with netCDF 4.2.  No idea why.
-  // The nc_get_vara variation seems to be OK though.
-//   NC_SAFE_CALL (nc_get_var_longlong(hexahedrons_ncid, elementNumber_varid, &ids_input[0]));
+  // Element numbers are checked one chunk at a time.
   size_t start[2] = {0,0};
   size_t count[2];
-  count[0] = elementNumber_len;
-  NC_SAFE_CALL (nc_get_vara_longlong(hexahedrons_ncid, elementNumber_varid, start, count, &ids_input[0]));
-  for (vtkIdType i=0; i<elementNumber_len; ++i)
   {
-    if (ids_input[i] != i+1)
+    const size_t blockRows = vtkboneN88ModelReader_ChunkRows (hexahedrons_ncid, elementNumber_varid);
+    std::vector<long long> buffer (std::min (blockRows, elementNumber_len));
+    for (size_t first=0; first<elementNumber_len; first+=blockRows)
     {
-      vtkErrorMacro (<< "ElementNumbers must start at 1 and be consecutive.");
-      return VTK_ERROR;
+      start[0] = first;
+      count[0] = std::min (blockRows, elementNumber_len - first);
+      // The nc_get_var variations crash on Linux with netCDF 4.2, so
+      // nc_get_vara is used.
+      NC_SAFE_CALL (nc_get_vara_longlong(hexahedrons_ncid, elementNumber_varid, start, count, buffer.data()));
+      for (size_t i=0; i<count[0]; ++i)
+      {
+        if (buffer[i] != (long long)(first + i + 1))
+        {
+          vtkErrorMacro (<< "ElementNumbers must start at 1 and be consecutive.");
+          return VTK_ERROR;
+        }
+      }
     }
   }
-  ids_input.clear();  // no longer need the data.
 
   int nodeNumbers_varid;
   if (nc_inq_varid (hexahedrons_ncid, "NodeNumbers", &nodeNumbers_varid) != NC_NOERR)
@@ -1151,28 +1342,37 @@ int vtkboneN88ModelReader::ReadElements
     vtkErrorMacro(<< "ElementNumber and NodeNumbers in Elements group must have same length.");
     return VTK_ERROR;
   }
-  ids_input.resize(nodeNumbers_len*nodesPerElement);
-  // The following call crashes on Linux with netCDF 4.2.  No idea why.
-  // The nc_get_vara variation seems to be OK though.
-//   NC_SAFE_CALL (nc_get_var_longlong(hexahedrons_ncid, nodeNumbers_varid, &ids_input[0]));
-  count[0] = nodeNumbers_len;
-  count[1] = nodesPerElement;
-  NC_SAFE_CALL (nc_get_vara_longlong(hexahedrons_ncid, nodeNumbers_varid, start, count, &ids_input[0]));
-  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
-  // The following allocation is exact
-  cells->Allocate(cells->EstimateSize(nodeNumbers_len, nodesPerElement));
-  vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
-  pointIds->SetNumberOfIds(nodesPerElement);
-  for (vtkIdType newCellId=0; newCellId < nodeNumbers_len; ++newCellId)
-  {
-    // Convert from 1-indexed to 0-indexed.
-    for (int j=0; j<nodesPerElement ; ++j)
+  // The node numbers are read a chunk at a time directly into the
+  // connectivity array of the cells, and converted there from 1-indexed to
+  // 0-indexed.  As all elements have 8 nodes, the offsets are simply
+  // multiples of 8.
+  static_assert (sizeof(vtkTypeInt64) == sizeof(long long),
+                 "vtkTypeInt64 must be long long");
+  vtkSmartPointer<vtkTypeInt64Array> connectivity = vtkSmartPointer<vtkTypeInt64Array>::New();
+  connectivity->SetNumberOfValues (vtkIdType(nodeNumbers_len*nodesPerElement));
+  {
+    const size_t blockRows = vtkboneN88ModelReader_ChunkRows (hexahedrons_ncid, nodeNumbers_varid);
+    count[1] = nodesPerElement;
+    start[1] = 0;
+    for (size_t first=0; first<nodeNumbers_len; first+=blockRows)
     {
-      pointIds->SetId(j, ids_input[nodesPerElement*newCellId + j] - 1);
+      start[0] = first;
+      count[0] = std::min (blockRows, nodeNumbers_len - first);
+      long long* block = reinterpret_cast<long long*>(
+        connectivity->GetPointer (vtkIdType(first*nodesPerElement)));
+      NC_SAFE_CALL (nc_get_vara_longlong(hexahedrons_ncid, nodeNumbers_varid, start, count, block));
+      const size_t n = count[0]*nodesPerElement;
+      for (size_t i=0; i<n; ++i)
+        { block[i] -= 1; }
     }
-    cells->InsertNextCell(pointIds);
   }
-  ids_input.clear();  // no longer need the data.
+  vtkSmartPointer<vtkTypeInt64Array> offsets = vtkSmartPointer<vtkTypeInt64Array>::New();
+  offsets->SetNumberOfValues (vtkIdType(nodeNumbers_len + 1));
+  vtkTypeInt64* offset = offsets->GetPointer(0);
+  for (size_t i=0; i<=nodeNumbers_len; ++i)
+    { offset[i] = vtkTypeInt64(i*nodesPerElement); }
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetData (offsets, connectivity);
   model->SetCells(VTK_VOXEL, cells);
 
   int materialID_varid;
@@ -1201,6 +1401,7 @@ int vtkboneN88ModelReader::ReadElements
   // The following call crashes on Linux with netCDF 4.2.  No idea why.
   // The nc_get_vara variation seems to be OK though.
 //   NC_SAFE_CALL (nc_get_var_int(hexahedrons_ncid, materialID_varid, scalars->GetPointer(0)));
+  start[0] = 0;
   count[0] = materialID_len;
   NC_SAFE_CALL (nc_get_vara_int(hexahedrons_ncid, materialID_varid, start, count, scalars->GetPointer(0)));
   model->GetCellData()->SetScalars(scalars);
@@ -1606,6 +1807,8 @@ int vtkboneN88ModelReader::ReadSolutions
     for (int v=0; v<nvars; ++v)
     {
       NC_SAFE_CALL (nc_inq_varname(nodevalues_ncid, varids[v], name));
+      if (!this->IsSolutionArraySelected(name))
+        { continue; }
       vtkSmartPointer<vtkFloatArray> data = vtkSmartPointer<vtkFloatArray>::New();
       data->SetName(name);
       int ndims = 0;
@@ -1653,6 +1856,8 @@ int vtkboneN88ModelReader::ReadSolutions
     for (int v=0; v<nvars; ++v)
     {
       NC_SAFE_CALL (nc_inq_varname(elementvalues_ncid, varids[v], name));
+      if (!this->IsSolutionArraySelected(name))
+        { continue; }
       vtkSmartPointer<vtkFloatArray> data = vtkSmartPointer<vtkFloatArray>::New();
       data->SetName(name);
       int ndims = 0;
@@ -1703,6 +1908,8 @@ int vtkboneN88ModelReader::ReadSolutions
       for (int v=0; v<nvars; ++v)
       {
         NC_SAFE_CALL (nc_inq_varname(ncids[i], varids[v], name));
+        if (!this->IsSolutionArraySelected(name))
+          { continue; }
         vtkSmartPointer<vtkFloatArray> data = vtkSmartPointer<vtkFloatArray>::New();
         data->SetName(name);
         int ndims = 0;
@@ -1742,3 +1949,351 @@ int vtkboneN88ModelReader::ReadSolutions
 
   return VTK_OK;
 }
+
+//----------------------------------------------------------------------------
+// Appends the names of all the variables of group ncid to names.
+static int vtkboneN88ModelReader_AppendVariableNames
+(
+  int ncid,
+  vtkStringArray* names
+)
+{
+  int nvars = 0;
+  int status = nc_inq_varids(ncid, &nvars, NULL);
+  if (status != NC_NOERR || nvars == 0)
+    { return status; }
+  std::vector<int> varids (nvars);
+  status = nc_inq_varids(ncid, NULL, &varids.front());
+  if (status != NC_NOERR)
+    { return status; }
+  char name[NC_MAX_NAME+1];
+  for (int v=0; v<nvars; ++v)
+  {
+    status = nc_inq_varname(ncid, varids[v], name);
+    if (status != NC_NOERR)
+      { return status; }
+    names->InsertNextValue(name);
+  }
+  return NC_NOERR;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ListSolutionVariables
+(
+  int ncid
+)
+{
+  // Only the group metadata are read here.  A missing or malformed
+  // ActiveSolution is left to be reported by RequestData.
+  size_t att_len = 0;
+  if (nc_inq_attlen (ncid, NC_GLOBAL, "ActiveSolution", &att_len) != NC_NOERR)
+    { return VTK_OK; }
+  std::string activeSolution;
+  activeSolution.resize(att_len);
+  int solutions_ncid;
+  int activeSolution_ncid;
+  if (nc_get_att_text (ncid, NC_GLOBAL, "ActiveSolution", &activeSolution[0]) != NC_NOERR ||
+      nc_inq_ncid(ncid, "Solutions", &solutions_ncid) != NC_NOERR ||
+      nc_inq_ncid(solutions_ncid, activeSolution.c_str(), &activeSolution_ncid) != NC_NOERR)
+    { return VTK_OK; }
+
+  int nodevalues_ncid;
+  if (nc_inq_ncid(activeSolution_ncid, "NodeValues", &nodevalues_ncid) == NC_NOERR)
+  {
+    NC_SAFE_CALL (vtkboneN88ModelReader_AppendVariableNames (nodevalues_ncid, this->NodeValueNames));
+  }
+
+  int elementvalues_ncid;
+  if (nc_inq_ncid(activeSolution_ncid, "ElementValues", &elementvalues_ncid) == NC_NOERR)
+  {
+    NC_SAFE_CALL (vtkboneN88ModelReader_AppendVariableNames (elementvalues_ncid, this->ElementValueNames));
+    int numGroups = 0;
+    NC_SAFE_CALL (nc_inq_grps(elementvalues_ncid, &numGroups, NULL));
+    if (numGroups > 0)
+    {
+      std::vector<int> ncids (numGroups);
+      NC_SAFE_CALL (nc_inq_grps(elementvalues_ncid, &numGroups, &ncids.front()));
+      for (int i=0; i<numGroups; ++i)
+      {
+        NC_SAFE_CALL (vtkboneN88ModelReader_AppendVariableNames (ncids[i], this->GaussPointValueNames));
+      }
+    }
+  }
+
+  return VTK_OK;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadNodeValuesForIds
+(
+  const char* arrayName,
+  vtkIdTypeArray* ids,
+  vtkFloatArray* values
+)
+{
+  if (ids == NULL)
+  {
+    vtkErrorMacro("ids must be specified.");
+    return VTK_ERROR;
+  }
+  return this->ReadPartialSolution ("NodeValues", arrayName, NULL, ids, values);
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadNodeValuesForSet
+(
+  const char* arrayName,
+  const char* setName,
+  vtkFloatArray* values
+)
+{
+  if (setName == NULL)
+  {
+    vtkErrorMacro("Set name must be specified.");
+    return VTK_ERROR;
+  }
+  return this->ReadPartialSolution ("NodeValues", arrayName, setName, NULL, values);
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadElementValuesForIds
+(
+  const char* arrayName,
+  vtkIdTypeArray* ids,
+  vtkFloatArray* values
+)
+{
+  if (ids == NULL)
+  {
+    vtkErrorMacro("ids must be specified.");
+    return VTK_ERROR;
+  }
+  return this->ReadPartialSolution ("ElementValues", arrayName, NULL, ids, values);
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadElementValuesForSet
+(
+  const char* arrayName,
+  const char* setName,
+  vtkFloatArray* values
+)
+{
+  if (setName == NULL)
+  {
+    vtkErrorMacro("Set name must be specified.");
+    return VTK_ERROR;
+  }
+  return this->ReadPartialSolution ("ElementValues", arrayName, setName, NULL, values);
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadPartialSolution
+(
+  const char* groupName,
+  const char* arrayName,
+  const char* setName,
+  vtkIdTypeArray* ids,
+  vtkFloatArray* values
+)
+{
+  if (arrayName == NULL || values == NULL)
+  {
+    vtkErrorMacro("Array name and output values must be specified.");
+    return VTK_ERROR;
+  }
+  if (!this->FileName)
+  {
+    vtkErrorMacro("FileName not set.");
+    return VTK_ERROR;
+  }
+
+  int ncid;
+  int status = nc_open (this->FileName, NC_NOWRITE, &ncid);
+  if (status != NC_NOERR)
+  {
+    vtkErrorMacro(<< "Unable to open file " << this->FileName
+                  << " ; NetCDF error " <<  nc_strerror(status) << ".");
+    return VTK_ERROR;
+  }
+
+  status = this->ReadPartialSolution (ncid, groupName, arrayName, setName, ids, values);
+
+  nc_close (ncid);
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadPartialSolution
+(
+  int ncid,
+  const char* groupName,
+  const char* arrayName,
+  const char* setName,
+  vtkIdTypeArray* ids,
+  vtkFloatArray* values
+)
+{
+  const bool nodes = (strcmp (groupName, "NodeValues") == 0);
+
+  vtkSmartPointer<vtkIdTypeArray> setIds;
+  if (setName)
+  {
+    setIds = vtkSmartPointer<vtkIdTypeArray>::New();
+    if (this->ReadSetIds (ncid, nodes ? "NodeSets" : "ElementSets", setName, setIds) == VTK_ERROR)
+      { return VTK_ERROR; }
+    ids = setIds;
+  }
+
+  size_t att_len = 0;
+  if (nc_inq_attlen (ncid, NC_GLOBAL, "ActiveSolution", &att_len) != NC_NOERR)
+  {
+    vtkErrorMacro(<< "No ActiveSolution in NetCDF file.");
+    return VTK_ERROR;
+  }
+  std::string activeSolution;
+  activeSolution.resize(att_len);
+  NC_SAFE_CALL (nc_get_att_text (ncid, NC_GLOBAL, "ActiveSolution", &activeSolution[0]));
+  int solutions_ncid;
+  int activeSolution_ncid;
+  if (nc_inq_ncid(ncid, "Solutions", &solutions_ncid) != NC_NOERR ||
+      nc_inq_ncid(solutions_ncid, activeSolution.c_str(), &activeSolution_ncid) != NC_NOERR)
+  {
+    vtkErrorMacro(<< "ActiveSolution group not found " << activeSolution << ".");
+    return VTK_ERROR;
+  }
+
+  // Look for the variable in the group; element variables may also be
+  // Gauss point values in subgroups of ElementValues.
+  int values_ncid;
+  int varid = -1;
+  bool gaussPoints = false;
+  if (nc_inq_ncid(activeSolution_ncid, groupName, &values_ncid) == NC_NOERR)
+  {
+    if (nc_inq_varid (values_ncid, arrayName, &varid) != NC_NOERR)
+      { varid = -1; }
+    if (varid < 0 && !nodes)
+    {
+      int numGroups = 0;
+      NC_SAFE_CALL (nc_inq_grps(values_ncid, &numGroups, NULL));
+      std::vector<int> ncids (numGroups);
+      if (numGroups > 0)
+        { NC_SAFE_CALL (nc_inq_grps(values_ncid, &numGroups, &ncids.front())); }
+      for (int i=0; i<numGroups && varid < 0; ++i)
+      {
+        if (nc_inq_varid (ncids[i], arrayName, &varid) == NC_NOERR)
+        {
+          values_ncid = ncids[i];
+          gaussPoints = true;
+        }
+        else
+          { varid = -1; }
+      }
+    }
+  }
+  if (varid < 0)
+  {
+    vtkErrorMacro(<< "Variable " << arrayName << " not found in " << groupName
+                  << " of ActiveSolution " << activeSolution << ".");
+    return VTK_ERROR;
+  }
+
+  int ndims = 0;
+  NC_SAFE_CALL (nc_inq_varndims(values_ncid, varid, &ndims));
+  if (ndims < (gaussPoints ? 2 : 1) || ndims > (gaussPoints ? 3 : 2))
+  {
+    vtkErrorMacro (<< "Variable " << arrayName << " has unsupported dimensions.");
+    return VTK_ERROR;
+  }
+  int dimids[3];
+  size_t dims[3] = {1,1,1};
+  NC_SAFE_CALL (nc_inq_vardimid(values_ncid, varid, dimids));
+  for (int d=0; d<ndims; ++d)
+  {
+    NC_SAFE_CALL (nc_inq_dimlen(values_ncid, dimids[d], &dims[d]));
+  }
+
+  const vtkIdType n = ids->GetNumberOfValues();
+  for (vtkIdType i=0; i<n; ++i)
+  {
+    const vtkIdType id = ids->GetValue(i);
+    if (id < 0 || size_t(id) >= dims[0])
+    {
+      vtkErrorMacro (<< "Id " << id << " out of range for variable " << arrayName << ".");
+      return VTK_ERROR;
+    }
+  }
+
+  values->Initialize();
+  values->SetName (arrayName);
+  if (gaussPoints)
+  {
+    values->SetNumberOfComponents (dims[2]);
+    values->SetNumberOfTuples (n*dims[1]);
+  }
+  else
+  {
+    values->SetNumberOfComponents (dims[1]);
+    values->SetNumberOfTuples (n);
+  }
+  if (n == 0)
+    { return VTK_OK; }
+
+  NC_SAFE_CALL (vtkboneN88ModelReader_ReadRows (values_ncid, varid, ndims, dims,
+                                              ids, size_t(this->MaximumPartialReadSize),
+                                              values->GetPointer(0)));
+
+  return VTK_OK;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelReader::ReadSetIds
+(
+  int ncid,
+  const char* groupName,
+  const char* setName,
+  vtkIdTypeArray* ids
+)
+{
+  const bool nodes = (strcmp (groupName, "NodeSets") == 0);
+  const char* varName = nodes ? "NodeNumber" : "ElementNumber";
+  int sets_ncid;
+  int group_ncid;
+  int set_ncid;
+  if (nc_inq_ncid (ncid, "Sets", &sets_ncid) != NC_NOERR ||
+      nc_inq_ncid (sets_ncid, groupName, &group_ncid) != NC_NOERR ||
+      nc_inq_ncid (group_ncid, setName, &set_ncid) != NC_NOERR)
+  {
+    vtkErrorMacro (<< (nodes ? "NodeSet " : "ElementSet ") << setName << " not found.");
+    return VTK_ERROR;
+  }
+  int varid;
+  if (nc_inq_varid (set_ncid, varName, &varid) != NC_NOERR)
+  {
+    vtkErrorMacro (<< "Unable to find variable " << varName << " for set " << setName << ".");
+    return VTK_ERROR;
+  }
+  int ndims = 0;
+  NC_SAFE_CALL (nc_inq_varndims(set_ncid, varid, &ndims));
+  if (ndims != 1)
+  {
+    vtkErrorMacro (<< varName << " variable in set " << setName << " must be 1-dimensional.");
+    return VTK_ERROR;
+  }
+  int dimid;
+  NC_SAFE_CALL (nc_inq_vardimid(set_ncid, varid, &dimid));
+  size_t len = 0;
+  NC_SAFE_CALL (nc_inq_dimlen(set_ncid, dimid, &len));
+  ids->SetName (setName);
+  ids->SetNumberOfValues(len);
+  if (len == 0)
+    { return VTK_OK; }
+  size_t start[1] = {0};
+  size_t count[1] = {len};
+  NC_SAFE_CALL (nc_get_vara_longlong(set_ncid, varid, start, count, ids->GetPointer(0)));
+  // Convert to 0-indexed
+  for (size_t i=0; i<len; ++i)
+    { --*(ids->GetPointer(i)); }
+  return VTK_OK;
+}
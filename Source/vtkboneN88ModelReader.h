@@ -19,6 +19,15 @@
 
  vtkboneN88ModelReader creates a vtkboneFiniteElementModel dataset.
 
+ By default all the groups of the file that apply to the active problem
+ are read.  Switches are provided to skip groups that are not needed;
+ skipping for example the solution values or the nodes and elements can
+ greatly reduce the time to read a large file.  The solution variables can
+ also be restricted to a list of names.
+
+ The names of the solution variables of the active solution are available
+ after UpdateInformation, which does not read any of the data.
+
     @sa
  vtkboneFiniteElementModel vtkboneN88ModelWriter
 */
@@ -31,6 +40,9 @@
 
 // Forward declarations
 class vtkUnstructuredGrid;
+class vtkStringArray;
+class vtkIdTypeArray;
+class vtkFloatArray;
 class vtkboneConstraint;
 
 class VTKBONE_EXPORT vtkboneN88ModelReader : public vtkboneFiniteElementModelAlgorithm
@@ -46,6 +58,15 @@ public:
   vtkGetStringMacro(FileName);
   //@}
 
+  //@{
+  /*! Set/get whether to read the nodes and elements.  If off, the output
+      has no points or cells, and no solution values are read.  Default
+      is on. */
+  vtkSetMacro(ReadGeometry, int);
+  vtkGetMacro(ReadGeometry, int);
+  vtkBooleanMacro(ReadGeometry, int);
+  //@}
+
   //@{
   /*! Set/get whether to read the MaterialTable. */
   vtkSetMacro(ReadMaterials, int);
@@ -53,6 +74,79 @@ public:
   vtkBooleanMacro(ReadMaterials, int);
   //@}
 
+  //@{
+  /*! Set/get whether to read the constraints and the convergence set of
+      the active problem.  Default is on. */
+  vtkSetMacro(ReadBoundaryConditions, int);
+  vtkGetMacro(ReadBoundaryConditions, int);
+  vtkBooleanMacro(ReadBoundaryConditions, int);
+  //@}
+
+  //@{
+  /*! Set/get whether to read the node sets and element sets.  Default is
+      on. */
+  vtkSetMacro(ReadNodeAndElementSets, int);
+  vtkGetMacro(ReadNodeAndElementSets, int);
+  vtkBooleanMacro(ReadNodeAndElementSets, int);
+  //@}
+
+  //@{
+  /*! Set/get whether to read the node, element and Gauss point values of
+      the active solution.  Default is on. */
+  vtkSetMacro(ReadSolutionValues, int);
+  vtkGetMacro(ReadSolutionValues, int);
+  vtkBooleanMacro(ReadSolutionValues, int);
+  //@}
+
+  /*! Adds a solution variable to read.  If no names are added, all the
+      solution variables are read; otherwise only those named, from
+      whichever of the node, element or Gauss point values they occur in. */
+  void AddSolutionArrayName(const char* name);
+
+  /*! Clears the list of solution variables to read, so that all are read. */
+  void RemoveAllSolutionArrayNames();
+
+  //@{
+  /*! Get the names of the variables in the node values, element values
+      and Gauss point values of the active solution.  These are set by
+      UpdateInformation, without reading the values. */
+  vtkGetObjectMacro(NodeValueNames, vtkStringArray);
+  vtkGetObjectMacro(ElementValueNames, vtkStringArray);
+  vtkGetObjectMacro(GaussPointValueNames, vtkStringArray);
+  //@}
+
+  //@{
+  /*! Reads the values of the node variable arrayName of the active
+      solution for only the nodes ids (0-indexed), or for only the nodes of
+      the node set setName.  values receives one tuple per node, in the
+      order of ids or of the set.  Only the required rows are read from the
+      file, so these can be used to extract for example the reaction forces
+      on a face from a very large results file without reading the whole
+      model.  The file is opened for each call; no output is generated.
+      Returns VTK_OK or VTK_ERROR. */
+  int ReadNodeValuesForIds(const char* arrayName, vtkIdTypeArray* ids, vtkFloatArray* values);
+  int ReadNodeValuesForSet(const char* arrayName, const char* setName, vtkFloatArray* values);
+  //@}
+
+  //@{
+  /*! As ReadNodeValuesForIds and ReadNodeValuesForSet, but for an element
+      variable of the active solution and element ids or an element set.
+      For Gauss point variables, values receives one tuple per Gauss point,
+      with the Gauss points of each element consecutive. */
+  int ReadElementValuesForIds(const char* arrayName, vtkIdTypeArray* ids, vtkFloatArray* values);
+  int ReadElementValuesForSet(const char* arrayName, const char* setName, vtkFloatArray* values);
+  //@}
+
+  //@{
+  /*! Set/Get the maximum size in bytes of the rows read with a single
+      call by the partial reads above.  Nearby ids are merged into runs of
+      rows read together; runs longer than this are split, so that the
+      buffer stays small even when the ids cover most of a very large
+      variable.  At least one row is always read.  Default is 4 MiB. */
+  vtkSetClampMacro(MaximumPartialReadSize, vtkIdType, 1, VTK_ID_MAX);
+  vtkGetMacro(MaximumPartialReadSize, vtkIdType);
+  //@}
+
   //@{
   /*! Get the active problem name. */
   vtkGetStringMacro(ActiveSolution);
@@ -74,6 +168,10 @@ protected:
   vtkboneN88ModelReader();
   ~vtkboneN88ModelReader();
 
+  virtual int RequestInformation(vtkInformation *,
+                                 vtkInformationVector **,
+                                 vtkInformationVector *) override;
+
   virtual int RequestData(vtkInformation *,
                           vtkInformationVector **,
                           vtkInformationVector *) override;
@@ -89,6 +187,16 @@ protected:
   int ReadConstraint(int constraints_ncid,const char* name,vtkboneConstraint*& constraint);
   int ReadSets(int ncid, vtkboneFiniteElementModel* model);
   int ReadSolutions(int ncid, vtkboneFiniteElementModel* model);
+  int ListSolutionVariables(int ncid);
+  bool IsSolutionArraySelected(const char* name);
+  int ReadPartialSolution(const char* groupName, const char* arrayName,
+                          const char* setName, vtkIdTypeArray* ids,
+                          vtkFloatArray* values);
+  int ReadPartialSolution(int ncid, const char* groupName, const char* arrayName,
+                          const char* setName, vtkIdTypeArray* ids,
+                          vtkFloatArray* values);
+  int ReadSetIds(int ncid, const char* groupName, const char* setName,
+                 vtkIdTypeArray* ids);
 
   // not publically modifiable
   vtkSetStringMacro(ActiveSolution);
@@ -96,7 +204,16 @@ protected:
   vtkSetStringMacro(ActivePart);
 
   char* FileName;
+  int ReadGeometry;
   int ReadMaterials;
+  int ReadBoundaryConditions;
+  int ReadNodeAndElementSets;
+  int ReadSolutionValues;
+  vtkIdType MaximumPartialReadSize;
+  vtkStringArray* SolutionArrayNames;
+  vtkStringArray* NodeValueNames;
+  vtkStringArray* ElementValueNames;
+  vtkStringArray* GaussPointValueNames;
   char* ActiveSolution;
   char* ActiveProblem;
   char* ActivePart;
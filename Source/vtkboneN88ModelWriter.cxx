@@ -18,6 +18,7 @@
 #include "vtkboneSolverParameters.h"
 #include "vtkCellData.h"
 #include "vtkCellArray.h"
+#include "vtkIdList.h"
 #include "vtkLongLongArray.h"
 #include "vtkUnsignedLongLongArray.h"
 #include "vtkLongArray.h"
@@ -41,20 +42,49 @@
 #include "vtkInformationDoubleKey.h"
 #include "vtkInformationDoubleVectorKey.h"
 #include "vtkInformationStringVectorKey.h"
+#include "vtkSMPTools.h"
 #ifdef VTKBONE_USE_VTKNETCDF
 #include "vtk_netcdf.h"
 #else
 #include "netcdf.h"
+#if defined(__has_include)
+#if __has_include("netcdf_meta.h")
+#include "netcdf_meta.h"
+#endif
+#endif
+#endif
+#if defined(NC_HAS_ZSTD) && NC_HAS_ZSTD
+#include "netcdf_filter.h"
+#define VTKBONE_N88_HAS_ZSTD
+#ifndef H5Z_FILTER_ZSTD
+#define H5Z_FILTER_ZSTD 32015
+#endif
+#endif
+#ifdef VTKBONE_N88_DIRECT_CHUNK_WRITE
+#ifdef VTKBONE_USE_VTKNETCDF
+#include "vtk_hdf5.h"
+#include "vtk_zlib.h"
+#else
+#include "hdf5.h"
+#include "zlib.h"
+#endif
+// H5Dwrite_chunk is available from HDF5 1.10.3.
+#if !H5_VERSION_GE(1,10,3)
+#undef VTKBONE_N88_DIRECT_CHUNK_WRITE
+#endif
 #endif
 #include "n88util/exception.hpp"
 #include <boost/format.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <vector>
 #include <set>
 #include <map>
 
 vtkStandardNewMacro(vtkboneN88ModelWriter);
 
-const int deflate_level = 7;
-
 // This can only be used in a function that can return VTK_ERROR.
 #define NC_SAFE_CALL(x) \
 { \
@@ -68,12 +98,242 @@ const int deflate_level = 7;
 
 const size_t CHUNK_SIZE = 1<<22;
 
+//----------------------------------------------------------------------------
+// Returns the number of rows (extent along the first dimension) of the
+// chunks of a variable, as chosen by SetChunking.  For variables that are
+// not chunked, returns the number of rows that fit in CHUNK_SIZE, with
+// elements of 8 bytes.
+static size_t vtkboneN88ModelWriter_ChunkRows (int ncid, int varid)
+{
+  int ndims = 0;
+  int dimids[NC_MAX_VAR_DIMS];
+  size_t rowLength = 1;
+  if (nc_inq_varndims (ncid, varid, &ndims) == NC_NOERR &&
+      ndims >= 1 && ndims <= NC_MAX_VAR_DIMS &&
+      nc_inq_vardimid (ncid, varid, dimids) == NC_NOERR)
+  {
+    for (int d=1; d<ndims; ++d)
+    {
+      size_t len = 1;
+      if (nc_inq_dimlen (ncid, dimids[d], &len) == NC_NOERR && len > 0)
+        { rowLength *= len; }
+    }
+    int storage = NC_CONTIGUOUS;
+    std::vector<size_t> chunksizes (ndims);
+    if (nc_inq_var_chunking (ncid, varid, &storage, chunksizes.data()) == NC_NOERR &&
+        storage == NC_CHUNKED && chunksizes[0] > 0)
+      { return chunksizes[0]; }
+  }
+  return std::max (size_t(1), CHUNK_SIZE / (8 * rowLength));
+}
+
+//----------------------------------------------------------------------------
+// Fills rows [first, first+count) of a variable, in the type of the
+// variable, into out.
+typedef std::function<void(size_t first, size_t count, unsigned char* out)>
+  vtkboneN88ModelWriterChunkFill;
+
+//----------------------------------------------------------------------------
+// A chunked, deflated variable written with parallel compression.
+struct vtkboneN88ModelWriterChunkedVariable
+{
+  std::string Path;          // of the HDF5 dataset
+  size_t Rows;
+  size_t RowLength;          // values per row
+  size_t ValueSize;          // bytes per value
+  size_t ChunkRows;
+  bool Shuffle;
+  int Level;
+  vtkboneN88ModelWriterChunkFill Fill;
+};
+
+//----------------------------------------------------------------------------
+// The variables defined for parallel compression, by (ncid, varid), and
+// those whose data is to be written once the netCDF file is closed.
+class vtkboneN88ModelWriterChunkedWrites
+{
+public:
+  std::map<std::pair<int,int>, vtkboneN88ModelWriterChunkedVariable> Defined;
+  std::vector<vtkboneN88ModelWriterChunkedVariable> Pending;
+};
+
+//----------------------------------------------------------------------------
+// Converts n values of in to the netCDF type xtype in out.  Returns false
+// if xtype is not a numeric type.
+template <typename T>
+static bool vtkboneN88ModelWriter_Convert (const T* in, size_t n, nc_type xtype, unsigned char* out)
+{
+  switch (xtype)
+  {
+    case NC_BYTE:   std::copy (in, in + n, reinterpret_cast<signed char*>(out)); return true;
+    case NC_UBYTE:  std::copy (in, in + n, reinterpret_cast<unsigned char*>(out)); return true;
+    case NC_SHORT:  std::copy (in, in + n, reinterpret_cast<short*>(out)); return true;
+    case NC_USHORT: std::copy (in, in + n, reinterpret_cast<unsigned short*>(out)); return true;
+    case NC_INT:    std::copy (in, in + n, reinterpret_cast<int*>(out)); return true;
+    case NC_UINT:   std::copy (in, in + n, reinterpret_cast<unsigned int*>(out)); return true;
+    case NC_INT64:  std::copy (in, in + n, reinterpret_cast<long long*>(out)); return true;
+    case NC_UINT64: std::copy (in, in + n, reinterpret_cast<unsigned long long*>(out)); return true;
+    case NC_FLOAT:  std::copy (in, in + n, reinterpret_cast<float*>(out)); return true;
+    case NC_DOUBLE: std::copy (in, in + n, reinterpret_cast<double*>(out)); return true;
+    default:        return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Converts rows [first, first+count) of data, of rowLength values each, to
+// the netCDF type xtype in out.
+static void vtkboneN88ModelWriter_ConvertRows
+(
+  vtkDataArray* data,
+  size_t rowLength,
+  nc_type xtype,
+  size_t first,
+  size_t count,
+  unsigned char* out
+)
+{
+  switch (data->GetDataType())
+  {
+    vtkTemplateMacro(vtkboneN88ModelWriter_Convert (
+      static_cast<const VTK_TT*>(data->GetVoidPointer(0)) + first*rowLength,
+      count*rowLength, xtype, out));
+  }
+}
+
+//----------------------------------------------------------------------------
+// Writes the 1-indexed node numbers of cells [first, first+count) to out,
+// 8 per cell, in n88model order.  The cells must be voxels or hexahedrons
+// of 8 points.  cellPoints is a work list.
+static void vtkboneN88ModelWriter_NodeNumbers
+(
+  vtkCellArray* cells,
+  const unsigned char* cellTypes,
+  vtkIdType first,
+  vtkIdType count,
+  vtkIdList* cellPoints,
+  long long* out
+)
+{
+  const vtkIdType voxel_transform[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+  const vtkIdType hexahedron_transform[8] = {0, 1, 3, 2, 4, 5, 7, 6};
+  for (vtkIdType cellid = first; cellid < first + count; ++cellid)
+  {
+    const vtkIdType* transform =
+      (cellTypes[cellid] == VTK_HEXAHEDRON) ? hexahedron_transform : voxel_transform;
+    vtkIdType npts = 0;
+    const vtkIdType* pts = NULL;
+    cells->GetCellAtId (cellid, npts, pts, cellPoints);
+    // Convert to 1-indexed
+    for (int i=0; i<8; ++i)
+      { out[i] = pts[transform[i]] + 1; }
+    out += 8;
+  }
+}
+
+//----------------------------------------------------------------------------
+// If variable varid of group ncid is defined for parallel compression,
+// records fill to produce its data when the netCDF file is closed, and
+// returns true.  Otherwise returns false, and the data must be written
+// with netCDF.
+static bool vtkboneN88ModelWriter_DeferWrite
+(
+  vtkboneN88ModelWriterChunkedWrites* writes,
+  int ncid,
+  int varid,
+  const vtkboneN88ModelWriterChunkFill& fill
+)
+{
+  if (writes == NULL)
+    { return false; }
+  std::map<std::pair<int,int>, vtkboneN88ModelWriterChunkedVariable>::const_iterator it =
+    writes->Defined.find (std::make_pair (ncid, varid));
+  if (it == writes->Defined.end())
+    { return false; }
+  writes->Pending.push_back (it->second);
+  writes->Pending.back().Fill = fill;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// As vtkboneN88ModelWriter_DeferWrite, for a variable whose data are the
+// values of data, which must match the size of the variable.
+static bool vtkboneN88ModelWriter_DeferArrayWrite
+(
+  vtkboneN88ModelWriterChunkedWrites* writes,
+  int ncid,
+  int varid,
+  vtkDataArray* data
+)
+{
+  if (writes == NULL)
+    { return false; }
+  std::map<std::pair<int,int>, vtkboneN88ModelWriterChunkedVariable>::const_iterator it =
+    writes->Defined.find (std::make_pair (ncid, varid));
+  nc_type xtype;
+  if (it == writes->Defined.end() ||
+      size_t(data->GetNumberOfValues()) != it->second.Rows * it->second.RowLength ||
+      nc_inq_vartype (ncid, varid, &xtype) != NC_NOERR)
+    { return false; }
+  const size_t rowLength = it->second.RowLength;
+  return vtkboneN88ModelWriter_DeferWrite (writes, ncid, varid,
+    [data, rowLength, xtype] (size_t first, size_t count, unsigned char* out)
+    {
+      vtkboneN88ModelWriter_ConvertRows (data, rowLength, xtype, first, count, out);
+    });
+}
+
+#ifdef VTKBONE_N88_DIRECT_CHUNK_WRITE
+//----------------------------------------------------------------------------
+// Fills, shuffles (if required) and deflates chunk c of variable, as the
+// HDF5 shuffle and deflate filters would.  The last chunk is padded with
+// zeros to the full chunk size.  raw and shuffled are work buffers.
+// Returns false on a zlib error.
+static bool vtkboneN88ModelWriter_CompressChunk
+(
+  const vtkboneN88ModelWriterChunkedVariable& variable,
+  size_t c,
+  std::vector<unsigned char>& raw,
+  std::vector<unsigned char>& shuffled,
+  std::vector<unsigned char>& compressed
+)
+{
+  const size_t rowBytes = variable.RowLength * variable.ValueSize;
+  const size_t first = c * variable.ChunkRows;
+  const size_t count = std::min (variable.ChunkRows, variable.Rows - first);
+  raw.assign (variable.ChunkRows * rowBytes, 0);
+  variable.Fill (first, count, raw.data());
+  const std::vector<unsigned char>* source = &raw;
+  if (variable.Shuffle && variable.ValueSize > 1)
+  {
+    const size_t n = raw.size() / variable.ValueSize;
+    shuffled.resize (raw.size());
+    for (size_t i=0; i<n; ++i)
+      for (size_t b=0; b<variable.ValueSize; ++b)
+        { shuffled[b*n + i] = raw[i*variable.ValueSize + b]; }
+    source = &shuffled;
+  }
+  uLongf size = compressBound (uLong(source->size()));
+  compressed.resize (size);
+  if (compress2 (compressed.data(), &size, source->data(), uLong(source->size()),
+                 variable.Level) != Z_OK)
+    { return false; }
+  compressed.resize (size);
+  return true;
+}
+#endif
+
 
 //----------------------------------------------------------------------------
 vtkboneN88ModelWriter::vtkboneN88ModelWriter()
 :
   FileName (NULL),
-  Compression (0)
+  Compression (0),
+  CompressionCodec (DEFLATE),
+  CompressionLevel (7),
+  Shuffle (0),
+  ParallelCompression (0),
+  CodecWarningIssued (false),
+  ChunkedWrites (NULL)
 {
 }
 
@@ -81,6 +341,7 @@ vtkboneN88ModelWriter::vtkboneN88ModelWriter()
 vtkboneN88ModelWriter::~vtkboneN88ModelWriter()
 {
   this->SetFileName(0);
+  delete this->ChunkedWrites;
 }
 
 //----------------------------------------------------------------------------
@@ -90,6 +351,73 @@ void vtkboneN88ModelWriter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "File Name: "
      << (this->FileName ? this->FileName : "(none)") << "\n";
   os << indent << "Compression: " << this->Compression << "\n";
+  os << indent << "CompressionCodec: "
+     << (this->CompressionCodec == ZSTANDARD ? "ZSTANDARD" : "DEFLATE") << "\n";
+  os << indent << "CompressionLevel: " << this->CompressionLevel << "\n";
+  os << indent << "Shuffle: " << this->Shuffle << "\n";
+  os << indent << "ParallelCompression: " << this->ParallelCompression << "\n";
+  for (std::map<std::string, std::pair<int,int> >::const_iterator it = this->VariableCompression.begin();
+       it != this->VariableCompression.end(); ++it)
+  {
+    os << indent << "VariableCompression " << it->first << ": "
+       << (it->second.first == ZSTANDARD ? "ZSTANDARD" : "DEFLATE")
+       << " " << it->second.second << "\n";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkboneN88ModelWriter::IsCompressionCodecAvailable(int codec)
+{
+  switch (codec)
+  {
+    case DEFLATE:
+      return true;
+    case ZSTANDARD:
+#ifdef VTKBONE_N88_HAS_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkboneN88ModelWriter::IsParallelCompressionAvailable()
+{
+#ifdef VTKBONE_N88_DIRECT_CHUNK_WRITE
+  return true;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void vtkboneN88ModelWriter::SetVariableCompression(const char* name, int codec, int level)
+{
+  if (name == NULL)
+  {
+    vtkErrorMacro(<< "Variable name must be specified.");
+    return;
+  }
+  if (codec != DEFLATE && codec != ZSTANDARD)
+  {
+    vtkErrorMacro(<< "Unknown compression codec " << codec << ".");
+    return;
+  }
+  level = std::max(0, std::min(level, 22));
+  this->VariableCompression[name] = std::make_pair(codec, level);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkboneN88ModelWriter::RemoveAllVariableCompressions()
+{
+  if (this->VariableCompression.empty())
+    { return; }
+  this->VariableCompression.clear();
+  this->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -128,6 +456,13 @@ void vtkboneN88ModelWriter::WriteData()
   // write data as we go, but it is faster to define first and write
   // the later subsequently, when the file is completely defined.
 
+  this->CodecWarningIssued = false;
+  delete this->ChunkedWrites;
+  this->ChunkedWrites = NULL;
+  if (this->Compression && this->ParallelCompression && IsParallelCompressionAvailable())
+  {
+    this->ChunkedWrites = new vtkboneN88ModelWriterChunkedWrites;
+  }
   int vtk_status = this->DefineNetCDFFile(ncid, model);
   if (vtk_status == VTK_ERROR)
   {
@@ -161,6 +496,15 @@ void vtkboneN88ModelWriter::WriteData()
     return;
   }
 
+  // The data of variables with parallel compression is written once
+  // netCDF has closed the file.
+  if (this->ChunkedWrites)
+  {
+    this->WriteChunkedVariables();
+    delete this->ChunkedWrites;
+    this->ChunkedWrites = NULL;
+  }
+
   return;
 }
 
@@ -1291,81 +1635,79 @@ int vtkboneN88ModelWriter::WriteElements
   int hexahedrons_ncid;
   NC_SAFE_CALL (nc_inq_ncid (elements_ncid, "Hexahedrons", &hexahedrons_ncid));
 
+  const vtkIdType numberOfElements = model->GetNumberOfCells();
+
+  // Element numbers are simply 1 to numberOfElements.  They are written
+  // one chunk at a time from a single buffer.
   int elementNumber_varid;
   NC_SAFE_CALL (nc_inq_varid (hexahedrons_ncid, "ElementNumber", &elementNumber_varid));
-  size_t tableindex[1];
-  tableindex[0] = 0;
-  size_t count[2] = {1,1};
-  // Note that elementid is 1-indexed
-  for (vtkIdType elementid = 1; elementid <= model->GetNumberOfCells(); ++elementid)
-  {
-    // The following call crashes on Linux with netCDF 4.2.  No idea why.
-    // The nc_put_vara variation seems to be OK though.
-//     NC_SAFE_CALL (nc_put_var1_longlong (hexahedrons_ncid, elementNumber_varid, tableindex, &elementid));
-    NC_SAFE_CALL (nc_put_vara_longlong (hexahedrons_ncid, elementNumber_varid, tableindex, count, &elementid));
-    ++(tableindex[0]);
+  if (!vtkboneN88ModelWriter_DeferWrite (this->ChunkedWrites, hexahedrons_ncid, elementNumber_varid,
+        [] (size_t first, size_t count, unsigned char* out)
+        {
+          std::vector<long long> numbers (count);
+          std::iota (numbers.begin(), numbers.end(), (long long)(first + 1));
+          vtkboneN88ModelWriter_Convert (numbers.data(), count, NC_UINT, out);
+        }))
+  {
+    size_t blockRows = vtkboneN88ModelWriter_ChunkRows (hexahedrons_ncid, elementNumber_varid);
+    std::vector<long long> buffer (std::min (blockRows, size_t(numberOfElements)));
+    for (vtkIdType first = 0; first < numberOfElements; first += blockRows)
+    {
+      size_t start[1] = {size_t(first)};
+      size_t count[1] = {std::min (blockRows, size_t(numberOfElements - first))};
+      // Note that element numbers are 1-indexed
+      std::iota (buffer.begin(), buffer.begin() + count[0], (long long)(first + 1));
+      NC_SAFE_CALL (nc_put_vara_longlong (hexahedrons_ncid, elementNumber_varid, start, count, buffer.data()));
+    }
   }
 
-  int nodeNumbers_varid;
-  NC_SAFE_CALL (nc_inq_varid (hexahedrons_ncid, "NodeNumbers", &nodeNumbers_varid));
-
+  // vtkboneFiniteElementModel can in principle be composed of mixed
+  // types, so the type is checked for each element.
   vtkCellArray* cells = model->GetCells();
-  cells->InitTraversal();
-  vtkIdType npts = 0;
-  const vtkIdType* pts = NULL;
-  vtkIdType pts1[8];
-  size_t start[2];
-  start[0] = 0;
-  start[1] = 0;
-  count[0] = 1;
-  count[1] = 8;
-  vtkIdType cellid = 0;
-  vtkIdType transform[8];
-  while (cells->GetNextCell(npts, pts))
-  {
-    // Note that for now we do this on an element-by-element basis, as
-    // vtkboneFiniteElementModel can in principle be composed of mixed types.
-    switch (model->GetCellType(cellid))
-    {
-      case VTK_VOXEL:
-        transform[0] = 0;
-        transform[1] = 1;
-        transform[2] = 2;
-        transform[3] = 3;
-        transform[4] = 4;
-        transform[5] = 5;
-        transform[6] = 6;
-        transform[7] = 7;
-        break;
-      case VTK_HEXAHEDRON:
-        transform[0] = 0;
-        transform[1] = 1;
-        transform[2] = 3;
-        transform[3] = 2;
-        transform[4] = 4;
-        transform[5] = 5;
-        transform[6] = 7;
-        transform[7] = 6;
-        break;
-      default:
-        vtkErrorMacro(<<"Unsupported Element Type.");
-        return VTK_ERROR;
+  const unsigned char* cellTypes = model->GetCellTypesArray()->GetPointer(0);
+  for (vtkIdType cellid = 0; cellid < numberOfElements; ++cellid)
+  {
+    if (cellTypes[cellid] != VTK_VOXEL && cellTypes[cellid] != VTK_HEXAHEDRON)
+    {
+      vtkErrorMacro(<<"Unsupported Element Type.");
+      return VTK_ERROR;
     }
-    if (npts != 8)
+    if (cells->GetCellSize (cellid) != 8)
     {
       vtkErrorMacro(<<"Unexpected number of cell points.");
       return VTK_ERROR;
     }
-    // Convert to 1-indexed
-    for (int i=0; i<8; ++i)
-      { pts1[i] = pts[transform[i]] + 1; }
-    NC_SAFE_CALL (nc_put_vara_longlong (hexahedrons_ncid,
-                                        nodeNumbers_varid,
-                                        start,
-                                        count,
-                                        pts1));
-    ++(start[0]);
-    ++cellid;
+  }
+
+  // Node numbers are converted (reordered and 1-indexed) a block of
+  // elements at a time, with block boundaries aligned to the chunks.
+  int nodeNumbers_varid;
+  NC_SAFE_CALL (nc_inq_varid (hexahedrons_ncid, "NodeNumbers", &nodeNumbers_varid));
+  if (!vtkboneN88ModelWriter_DeferWrite (this->ChunkedWrites, hexahedrons_ncid, nodeNumbers_varid,
+        [cells, cellTypes] (size_t first, size_t count, unsigned char* out)
+        {
+          vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+          std::vector<long long> numbers (8 * count);
+          vtkboneN88ModelWriter_NodeNumbers (cells, cellTypes, vtkIdType(first),
+                                             vtkIdType(count), cellPoints, numbers.data());
+          vtkboneN88ModelWriter_Convert (numbers.data(), numbers.size(), NC_UINT, out);
+        }))
+  {
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    size_t blockRows = vtkboneN88ModelWriter_ChunkRows (hexahedrons_ncid, nodeNumbers_varid);
+    std::vector<long long> buffer (8 * std::min (blockRows, size_t(numberOfElements)));
+    for (vtkIdType first = 0; first < numberOfElements; first += blockRows)
+    {
+      size_t start[2] = {size_t(first), 0};
+      size_t count[2] = {std::min (blockRows, size_t(numberOfElements - first)), 8};
+      vtkboneN88ModelWriter_NodeNumbers (cells, cellTypes, first, vtkIdType(count[0]),
+                                         cellPoints, buffer.data());
+      NC_SAFE_CALL (nc_put_vara_longlong (hexahedrons_ncid,
+                                          nodeNumbers_varid,
+                                          start,
+                                          count,
+                                          buffer.data()));
+    }
   }
 
   vtkDataArray* scalars = model->GetCellData()->GetScalars();
@@ -1636,6 +1978,8 @@ int vtkboneN88ModelWriter::WriteVTKDataArrayToNetCDF
   vtkDataArray* data
 )
 {
+  if (vtkboneN88ModelWriter_DeferArrayWrite (this->ChunkedWrites, ncid, varid, data))
+    { return VTK_OK; }
   // nc_get_vara calls crashes on Linux with netCDF 4.2.  No idea why.
   // The nc_get_vara variation seems to be OK though.
   size_t start[2] = {0,0};
@@ -1696,6 +2040,8 @@ int vtkboneN88ModelWriter::WriteVTKDataArrayToNetCDF
 )
 {
   n88_assert (data->GetNumberOfTuples() % dim1 == 0);
+  if (vtkboneN88ModelWriter_DeferArrayWrite (this->ChunkedWrites, ncid, varid, data))
+    { return VTK_OK; }
   // nc_get_vara calls crashes on Linux with netCDF 4.2.  No idea why.
   // The nc_get_vara variation seems to be OK though.
   size_t start[3] = {0,0,0};
@@ -1894,9 +2240,56 @@ int vtkboneN88ModelWriter::WriteVTKDataArrayToNetCDFOneIndexed
 
 int vtkboneN88ModelWriter::SetChunking (int ncid, int varid)
 {
+  int deflateLevel = 0;
   if (this->Compression)
   {
-    NC_SAFE_CALL (nc_def_var_deflate(ncid, varid, 0, 1, deflate_level));
+    int codec = this->CompressionCodec;
+    int level = this->CompressionLevel;
+    if (!this->VariableCompression.empty())
+    {
+      char name[NC_MAX_NAME+1];
+      NC_SAFE_CALL (nc_inq_varname (ncid, varid, name));
+      std::map<std::string, std::pair<int,int> >::const_iterator it =
+        this->VariableCompression.find(name);
+      if (it != this->VariableCompression.end())
+      {
+        codec = it->second.first;
+        level = it->second.second;
+      }
+    }
+    if (level > 0)
+    {
+      bool available = IsCompressionCodecAvailable(codec);
+#ifdef VTKBONE_N88_HAS_ZSTD
+      // The zstd filter is an HDF5 plugin, which is located at run time.
+      if (available && codec == ZSTANDARD)
+      {
+        available = (nc_inq_filter_avail(ncid, H5Z_FILTER_ZSTD) == NC_NOERR);
+      }
+#endif
+      if (!available)
+      {
+        if (!this->CodecWarningIssued)
+        {
+          vtkWarningMacro(<< "Zstandard compression is not available (netCDF library or HDF5 filter plugin); using deflate.");
+          this->CodecWarningIssued = true;
+        }
+        codec = DEFLATE;
+      }
+      if (codec == DEFLATE)
+      {
+        deflateLevel = std::min(level, 9);
+        NC_SAFE_CALL (nc_def_var_deflate(ncid, varid, this->Shuffle ? 1 : 0, 1, deflateLevel));
+      }
+#ifdef VTKBONE_N88_HAS_ZSTD
+      else
+      {
+        if (this->Shuffle)
+          { NC_SAFE_CALL (nc_def_var_deflate(ncid, varid, 1, 0, 0)); }
+        NC_SAFE_CALL (nc_def_var_zstandard(ncid, varid, level));
+      }
+#endif
+    }
   }
 
   int return_val = NC_NOERR;
@@ -1960,5 +2353,128 @@ int vtkboneN88ModelWriter::SetChunking (int ncid, int varid)
     chunksizes[0] = dims[0];
   }
   return_val = nc_def_var_chunking (ncid, varid, NC_CHUNKED, chunksizes);
-  return return_val;
+  if (return_val != NC_NOERR) { return return_val; }
+
+  // Deflated variables can be compressed in parallel.  netCDF stores a
+  // variable as the HDF5 dataset of the same name in the group, except if
+  // it clashes with a dimension name, in which case it is left to netCDF.
+  if (this->ChunkedWrites && deflateLevel > 0 && dims[0] > 0)
+  {
+    char name[NC_MAX_NAME+1];
+    return_val = nc_inq_varname (ncid, varid, name);
+    if (return_val != NC_NOERR) { return return_val; }
+    int dimid;
+    if (nc_inq_dimid (ncid, name, &dimid) != NC_NOERR)
+    {
+      size_t len = 0;
+      return_val = nc_inq_grpname_full (ncid, &len, NULL);
+      if (return_val != NC_NOERR) { return return_val; }
+      std::vector<char> group (len + 1);
+      return_val = nc_inq_grpname_full (ncid, NULL, group.data());
+      if (return_val != NC_NOERR) { return return_val; }
+      vtkboneN88ModelWriterChunkedVariable variable;
+      variable.Path = group.data();
+      if (variable.Path.empty() || variable.Path[variable.Path.size()-1] != '/')
+        { variable.Path += "/"; }
+      variable.Path += name;
+      variable.Rows = dims[0];
+      variable.RowLength = dims[1] * dims[2];
+      variable.ValueSize = varsize;
+      variable.ChunkRows = chunksizes[0];
+      variable.Shuffle = (this->Shuffle != 0);
+      variable.Level = deflateLevel;
+      this->ChunkedWrites->Defined[std::make_pair (ncid, varid)] = variable;
+    }
+  }
+  return NC_NOERR;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneN88ModelWriter::WriteChunkedVariables()
+{
+  if (this->ChunkedWrites == NULL || this->ChunkedWrites->Pending.empty())
+    { return VTK_OK; }
+#ifdef VTKBONE_N88_DIRECT_CHUNK_WRITE
+  hid_t file_id = H5Fopen (this->FileName, H5F_ACC_RDWR, H5P_DEFAULT);
+  if (file_id < 0)
+  {
+    vtkErrorMacro(<< "Unable to open file " << this->FileName << " with HDF5.");
+    return VTK_ERROR;
+  }
+  // Chunks are compressed in batches, so that the compressed data of only
+  // a few chunks per thread is held at once.
+  const size_t batchSize = 4 * size_t(std::max (1, vtkSMPTools::GetEstimatedNumberOfThreads()));
+  int status = VTK_OK;
+  for (size_t v = 0; v < this->ChunkedWrites->Pending.size() && status == VTK_OK; ++v)
+  {
+    const vtkboneN88ModelWriterChunkedVariable& variable = this->ChunkedWrites->Pending[v];
+    hid_t dataset_id = H5Dopen2 (file_id, variable.Path.c_str(), H5P_DEFAULT);
+    if (dataset_id < 0)
+    {
+      vtkErrorMacro(<< "Unable to open HDF5 dataset " << variable.Path << ".");
+      status = VTK_ERROR;
+      break;
+    }
+    // The chunks are written in the native byte order, which is that of
+    // the variables defined by netCDF.
+    hid_t type_id = H5Dget_type (dataset_id);
+    hid_t space_id = H5Dget_space (dataset_id);
+    const int ndims = H5Sget_simple_extent_ndims (space_id);
+    if (type_id < 0 || space_id < 0 || ndims < 1 || ndims > 3 ||
+        H5Tget_size (type_id) != variable.ValueSize ||
+        (variable.ValueSize > 1 && H5Tget_order (type_id) != H5Tget_order (H5T_NATIVE_INT)))
+    {
+      vtkErrorMacro(<< "Unexpected layout of HDF5 dataset " << variable.Path << ".");
+      status = VTK_ERROR;
+    }
+    if (type_id >= 0) { H5Tclose (type_id); }
+    if (space_id >= 0) { H5Sclose (space_id); }
+    const size_t numberOfChunks = (variable.Rows + variable.ChunkRows - 1) / variable.ChunkRows;
+    std::vector<std::vector<unsigned char> > compressed;
+    for (size_t batch = 0; batch < numberOfChunks && status == VTK_OK; batch += batchSize)
+    {
+      const size_t n = std::min (batchSize, numberOfChunks - batch);
+      compressed.resize (n);
+      std::atomic<bool> failed (false);
+      vtkSMPTools::For (0, vtkIdType(n), [&](vtkIdType begin, vtkIdType end)
+      {
+        std::vector<unsigned char> raw;
+        std::vector<unsigned char> shuffled;
+        for (vtkIdType i = begin; i < end; ++i)
+        {
+          if (!vtkboneN88ModelWriter_CompressChunk (variable, batch + i, raw, shuffled,
+                                                    compressed[i]))
+            { failed = true; }
+        }
+      });
+      if (failed)
+      {
+        vtkErrorMacro(<< "Error compressing HDF5 dataset " << variable.Path << ".");
+        status = VTK_ERROR;
+        break;
+      }
+      for (size_t i = 0; i < n; ++i)
+      {
+        hsize_t offset[3] = {hsize_t((batch + i) * variable.ChunkRows), 0, 0};
+        if (H5Dwrite_chunk (dataset_id, H5P_DEFAULT, 0, offset,
+                            compressed[i].size(), compressed[i].data()) < 0)
+        {
+          vtkErrorMacro(<< "Error writing HDF5 dataset " << variable.Path << ".");
+          status = VTK_ERROR;
+          break;
+        }
+      }
+    }
+    H5Dclose (dataset_id);
+  }
+  if (H5Fclose (file_id) < 0 && status == VTK_OK)
+  {
+    vtkErrorMacro(<< "Error writing file " << this->FileName << ".");
+    status = VTK_ERROR;
+  }
+  return status;
+#else
+  vtkErrorMacro(<< "Parallel compression is not supported by this build.");
+  return VTK_ERROR;
+#endif
 }
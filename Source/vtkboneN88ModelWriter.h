@@ -34,6 +34,8 @@
 #include "vtkWriter.h"
 #include "vtkboneWin32Header.h"
 #include <set>
+#include <map>
+#include <string>
 
 // Forward declarations
 class vtkPoints;
@@ -45,6 +47,7 @@ class vtkCharArray;
 class vtkDataArrayCollection;
 class vtkboneConstraint;
 class vtkDataSetAttributes;
+class vtkboneN88ModelWriterChunkedWrites;
 
 class VTKBONE_EXPORT vtkboneN88ModelWriter : public vtkWriter
 {
@@ -66,6 +69,75 @@ public:
   vtkBooleanMacro(Compression, int);
   //@}
 
+  /*! Compression codecs. */
+  enum CompressionCodec_t {
+    DEFLATE,
+    ZSTANDARD
+  };
+
+  //@{
+  /*! Set/get the codec used when Compression is on.  The default is
+      DEFLATE, which any netCDF-4 library can read.  ZSTANDARD is usually
+      faster at a similar ratio, but requires a netCDF library built with
+      zstd support, and readers need the corresponding HDF5 filter plugin.
+      If this library lacks zstd support, or the HDF5 zstd filter plugin is
+      not found when writing, DEFLATE is used instead and a warning is
+      issued. */
+  vtkSetClampMacro(CompressionCodec, int, DEFLATE, ZSTANDARD);
+  vtkGetMacro(CompressionCodec, int);
+  void SetCompressionCodecToDeflate() {this->SetCompressionCodec(DEFLATE);}
+  void SetCompressionCodecToZstandard() {this->SetCompressionCodec(ZSTANDARD);}
+  //@}
+
+  /*! Returns true if codec can be used by this build.  ZSTANDARD also
+      requires the HDF5 filter plugin at run time. */
+  static bool IsCompressionCodecAvailable(int codec);
+
+  //@{
+  /*! Set/get the compression level.  Valid values are 1 to 9 for DEFLATE
+      (larger values are reduced to 9), and 1 to 22 for ZSTANDARD.  The
+      default is 7. */
+  vtkSetClampMacro(CompressionLevel, int, 1, 22);
+  vtkGetMacro(CompressionLevel, int);
+  //@}
+
+  //@{
+  /*! Set/get whether the HDF5 shuffle filter is applied before compression.
+      Shuffling usually improves the compression of floating point arrays.
+      The default is off. */
+  vtkSetMacro(Shuffle, int);
+  vtkGetMacro(Shuffle, int);
+  vtkBooleanMacro(Shuffle, int);
+  //@}
+
+  /*! Overrides the codec and level for all variables with the given name
+      (e.g. "NodeNumbers" or "Displacement"), in whichever group they occur.
+      A level of 0 stores the variable uncompressed.  Has no effect unless
+      Compression is on. */
+  void SetVariableCompression(const char* name, int codec, int level);
+
+  /*! Removes all overrides set with SetVariableCompression. */
+  void RemoveAllVariableCompressions();
+
+  //@{
+  /*! Set/get whether chunks are compressed in parallel.  When on, the
+      data of variables compressed with DEFLATE is written after netCDF
+      has closed the file: their chunks are filled, shuffled if requested
+      and deflated on vtkSMPTools threads, and the compressed chunks are
+      written one at a time to the HDF5 datasets that netCDF defined, so
+      that the file is read as any other.  Variables compressed with
+      ZSTANDARD are compressed by the netCDF library.  Has no effect
+      unless Compression is on and IsParallelCompressionAvailable returns
+      true.  Default is Off. */
+  vtkSetMacro(ParallelCompression, int);
+  vtkGetMacro(ParallelCompression, int);
+  vtkBooleanMacro(ParallelCompression, int);
+  //@}
+
+  /*! Returns true if this build can write directly to HDF5 chunks, as
+      required by ParallelCompression. */
+  static bool IsParallelCompressionAvailable();
+
 protected:
   vtkboneN88ModelWriter();
   ~vtkboneN88ModelWriter();
@@ -101,9 +173,19 @@ protected:
   int WriteVTKDataArrayToNetCDF(int ncid, int varid, vtkDataArray* data, size_t dim1);
   int WriteVTKDataArrayToNetCDFOneIndexed(int ncid, int varid, vtkDataArray* data);
   int SetChunking (int ncid, int varid);
+  int WriteChunkedVariables();
 
   char* FileName;
   int Compression;
+  int CompressionCodec;
+  int CompressionLevel;
+  int Shuffle;
+  int ParallelCompression;
+  //BTX
+  std::map<std::string, std::pair<int,int> > VariableCompression;
+  //ETX
+  bool CodecWarningIssued;
+  vtkboneN88ModelWriterChunkedWrites* ChunkedWrites;
 
 private:
   vtkboneN88ModelWriter(const vtkboneN88ModelWriter&); // Not implemented
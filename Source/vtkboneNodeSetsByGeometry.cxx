@@ -22,21 +22,230 @@
 #include "vtkGeometryFilter.h"
 #include "vtkSelectionNode.h"
 #include "vtkSelection.h"
+#include "vtkInformation.h"
 #include "vtkInformationObjectBaseKey.h"
 #include "vtkSmartPointer.h"
 #include "vtkExtractSelection.h"
+#include "vtkSMPTools.h"
 #include "n88util/floating_point_comparisons.hpp"
+#include <algorithm>
 #include <limits>
+#include <map>
+#include <utility>
+#include <vector>
 #include <assert.h>
 
 vtkStandardNewMacro(vtkboneNodeSetsByGeometry);
 
+vtkInformationKeyMacro(vtkboneNodeSetsByGeometry, COORDINATE_INDEX, ObjectBase);
+
+//----------------------------------------------------------------------------
+// Index of the points of a data set, cached in the information of the data
+// set under vtkboneNodeSetsByGeometry::COORDINATE_INDEX:
+//
+// - for each axis, the point ids sorted by coordinate along that axis, so
+//   that the points on a plane are a contiguous range found by binary
+//   search;
+// - for each material queried, a mask of the points belonging to at least
+//   one cell of that material.
+//
+// The coordinate index is rebuilt if the points change, and the masks if
+// the data set changes.
+class vtkboneNodeSetsByGeometryIndex : public vtkObject
+{
+public:
+  static vtkboneNodeSetsByGeometryIndex* New();
+  vtkTypeMacro(vtkboneNodeSetsByGeometryIndex, vtkObject);
+
+  // Returns the index cached on data, creating it if required.
+  static vtkboneNodeSetsByGeometryIndex* Get (vtkDataSet* data)
+  {
+    vtkInformation* info = data->GetInformation();
+    vtkboneNodeSetsByGeometryIndex* index = vtkboneNodeSetsByGeometryIndex::SafeDownCast(
+      info->Get(vtkboneNodeSetsByGeometry::COORDINATE_INDEX()));
+    if (!index)
+    {
+      vtkSmartPointer<vtkboneNodeSetsByGeometryIndex> newIndex =
+        vtkSmartPointer<vtkboneNodeSetsByGeometryIndex>::New();
+      info->Set(vtkboneNodeSetsByGeometry::COORDINATE_INDEX(), newIndex);
+      index = newIndex;
+    }
+    return index;
+  }
+
+  // Sets range to the positions in Order[axis] of the points with
+  // coordinate along axis approximately equal to val.
+  void FindRange (vtkDataSet* data, int axis, float val, vtkIdType range[2])
+  {
+    this->UpdateCoordinates (data);
+    const std::vector<double>& coords = this->Coordinates[axis];
+    vtkIdType lower = std::lower_bound (coords.begin(), coords.end(), double(val))
+                      - coords.begin();
+    vtkIdType upper = lower;
+    while (lower > 0 && bonelabMisc::ApproximatelyEqual(coords[lower-1], val))
+      { --lower; }
+    while (upper < vtkIdType(coords.size()) &&
+           bonelabMisc::ApproximatelyEqual(coords[upper], val))
+      { ++upper; }
+    range[0] = lower;
+    range[1] = upper;
+  }
+
+  // Returns the mask of points of data belonging to at least one cell with
+  // scalar value material.
+  const std::vector<unsigned char>& GetMaterialMask (vtkDataSet* data, int material)
+  {
+    if (data->GetMTime() != this->MasksMTime ||
+        data->GetNumberOfPoints() != this->MasksNumberOfPoints)
+    {
+      this->MaterialMasks.clear();
+      this->MasksMTime = data->GetMTime();
+      this->MasksNumberOfPoints = data->GetNumberOfPoints();
+    }
+    std::map<int, std::vector<unsigned char> >::iterator it =
+      this->MaterialMasks.find (material);
+    if (it != this->MaterialMasks.end())
+      { return it->second; }
+    std::vector<unsigned char>& mask = this->MaterialMasks[material];
+    mask.assign (data->GetNumberOfPoints(), 0);
+    vtkDataArray* scalars = data->GetCellData()->GetScalars();
+    if (scalars)
+    {
+      vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
+      for (vtkIdType c=0; c<data->GetNumberOfCells(); ++c)
+      {
+        if (int(scalars->GetTuple1(c)) == material)
+        {
+          data->GetCellPoints (c, pointIds);
+          for (vtkIdType i=0; i<pointIds->GetNumberOfIds(); ++i)
+            { mask[pointIds->GetId(i)] = 1; }
+        }
+      }
+    }
+    return mask;
+  }
+
+  std::vector<double> Coordinates[3];
+  std::vector<vtkIdType> Order[3];
+
+protected:
+  vtkboneNodeSetsByGeometryIndex()
+    : Points (NULL), PointsMTime (0), MasksMTime (0), MasksNumberOfPoints (0) {}
+  ~vtkboneNodeSetsByGeometryIndex() {}
+
+  void UpdateCoordinates (vtkDataSet* data)
+  {
+    vtkPointSet* pointSet = vtkPointSet::SafeDownCast (data);
+    vtkPoints* points = pointSet ? pointSet->GetPoints() : NULL;
+    vtkMTimeType mtime = points ? points->GetMTime() : data->GetMTime();
+    const vtkIdType n = data->GetNumberOfPoints();
+    if (points == this->Points && mtime == this->PointsMTime &&
+        n == vtkIdType(this->Coordinates[0].size()))
+      { return; }
+    std::vector<std::pair<double, vtkIdType> > sorted (n);
+    for (int axis=0; axis<3; ++axis)
+    {
+      vtkSMPTools::For (0, n, [&](vtkIdType begin, vtkIdType end)
+      {
+        double x[3];
+        for (vtkIdType i=begin; i<end; ++i)
+        {
+          data->GetPoint (i, x);
+          sorted[i] = std::make_pair (x[axis], i);
+        }
+      });
+      vtkSMPTools::Sort (sorted.begin(), sorted.end());
+      this->Coordinates[axis].resize (n);
+      this->Order[axis].resize (n);
+      for (vtkIdType i=0; i<n; ++i)
+      {
+        this->Coordinates[axis][i] = sorted[i].first;
+        this->Order[axis][i] = sorted[i].second;
+      }
+    }
+    this->Points = points;
+    this->PointsMTime = mtime;
+  }
+
+  vtkPoints* Points;
+  vtkMTimeType PointsMTime;
+  vtkMTimeType MasksMTime;
+  vtkIdType MasksNumberOfPoints;
+  std::map<int, std::vector<unsigned char> > MaterialMasks;
+
+private:
+  vtkboneNodeSetsByGeometryIndex(const vtkboneNodeSetsByGeometryIndex&);  // Not implemented.
+  void operator=(const vtkboneNodeSetsByGeometryIndex&);  // Not implemented.
+};
+
+vtkStandardNewMacro(vtkboneNodeSetsByGeometryIndex);
+
+//----------------------------------------------------------------------------
+// Appends to ids, in increasing order, the ids of the points of data lying
+// on all of numPlanes planes (axes[i], vals[i]) and belonging to a cell of
+// material specificMaterial (or any cell if specificMaterial is -1).  The
+// candidates are the points of the plane with the fewest points.
+static void vtkboneNodeSetsByGeometry_FindNodes
+(
+  int numPlanes,
+  const int* axes,
+  const float* vals,
+  vtkIdTypeArray* ids,
+  vtkDataSet* data,
+  int specificMaterial
+)
+{
+  vtkboneNodeSetsByGeometryIndex* index = vtkboneNodeSetsByGeometryIndex::Get (data);
+  int best = 0;
+  vtkIdType bestRange[2] = {0, 0};
+  for (int p=0; p<numPlanes; ++p)
+  {
+    vtkIdType range[2];
+    index->FindRange (data, axes[p], vals[p], range);
+    if (p == 0 || range[1] - range[0] < bestRange[1] - bestRange[0])
+    {
+      best = p;
+      bestRange[0] = range[0];
+      bestRange[1] = range[1];
+    }
+  }
+  const vtkIdType* order = index->Order[axes[best]].data();
+  std::vector<vtkIdType> hits (order + bestRange[0], order + bestRange[1]);
+  std::sort (hits.begin(), hits.end());
+
+  const std::vector<unsigned char>* mask = NULL;
+  if (specificMaterial != -1)
+    { mask = &index->GetMaterialMask (data, specificMaterial); }
+  double x[3];
+  for (size_t i=0; i<hits.size(); ++i)
+  {
+    const vtkIdType id = hits[i];
+    if (mask && !(*mask)[id])
+      { continue; }
+    data->GetPoint (id, x);
+    bool onAll = true;
+    for (int p=0; p<numPlanes && onAll; ++p)
+    {
+      if (p != best)
+        { onAll = bonelabMisc::ApproximatelyEqual(x[axes[p]], vals[p]); }
+    }
+    if (onAll)
+      { ids->InsertNextValue(id); }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkboneNodeSetsByGeometry::PrintSelf (ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
 }
 
+//----------------------------------------------------------------------------
+void vtkboneNodeSetsByGeometry::ReleaseCoordinateIndex (vtkDataSet* data)
+{
+  data->GetInformation()->Remove(vtkboneNodeSetsByGeometry::COORDINATE_INDEX());
+}
+
 //----------------------------------------------------------------------------
 void vtkboneNodeSetsByGeometry::DetermineMaterialBounds
 (
@@ -96,22 +305,12 @@ int vtkboneNodeSetsByGeometry::FilterPointListByCellScalar
 {
   output_ids->Initialize();
   output_ids->Allocate(input_ids->GetNumberOfTuples());
-  vtkSmartPointer<vtkIdList> cellIds = vtkSmartPointer<vtkIdList>::New();
+  const std::vector<unsigned char>& mask =
+    vtkboneNodeSetsByGeometryIndex::Get(data)->GetMaterialMask(data, targetCellScalar);
   for (vtkIdType i=0; i<input_ids->GetNumberOfTuples(); i++)
   {
     vtkIdType pointId = input_ids->GetValue(i);
-    data->GetPointCells(pointId, cellIds);
-    int haveMatch = 0;
-    for (int j=0; j<cellIds->GetNumberOfIds(); j++)
-    {
-      int val = data->GetCellData()->GetScalars()->GetTuple1(cellIds->GetId(j));
-      if (val == targetCellScalar)
-      {
-        haveMatch = 1;
-        break;
-      }
-    }
-    if (haveMatch)
+    if (mask[pointId])
     {
       output_ids->InsertNextValue(pointId);
     }
@@ -131,24 +330,7 @@ int vtkboneNodeSetsByGeometry::FindNodesOnPlane
 {
   bonelabMisc::SanityCheck();
 
-  vtkSmartPointer<vtkIdList> cellIds = vtkSmartPointer<vtkIdList>::New();
-
-  for (vtkIdType i=0; i<ug->GetNumberOfPoints(); i++) {
-    if (bonelabMisc::ApproximatelyEqual(ug->GetPoint(i)[axis],val)) {
-      if (specificMaterial == -1) {
-        ids->InsertNextValue(i);
-      } else {
-        ug->GetPointCells(i,cellIds);
-        for (int j=0; j<cellIds->GetNumberOfIds(); j++) {
-          int material = ug->GetCellData()->GetScalars()->GetTuple1(cellIds->GetId(j));
-          if (material == specificMaterial) {
-            ids->InsertNextValue(i);
-            break;
-          }
-        }
-      }
-    }
-  }
+  vtkboneNodeSetsByGeometry_FindNodes (1, &axis, &val, ids, ug, specificMaterial);
 
   return VTK_OK;
 }
@@ -206,26 +388,10 @@ int vtkboneNodeSetsByGeometry::FindNodesIntersectingTwoPlanes
 {
   bonelabMisc::SanityCheck();
 
-  vtkSmartPointer<vtkIdList> cellIds = vtkSmartPointer<vtkIdList>::New();
-
-  for (vtkIdType i=0; i<ug->GetNumberOfPoints(); i++) {
-    if (bonelabMisc::ApproximatelyEqual(ug->GetPoint(i)[axis1], val1)) {
-      if (bonelabMisc::ApproximatelyEqual(ug->GetPoint(i)[axis2], val2)) {
-        if (specificMaterial == -1) {
-          ids->InsertNextValue(i);
-        } else {
-          ug->GetPointCells(i,cellIds);
-          for (int j=0; j<cellIds->GetNumberOfIds(); j++) {
-          int material = ug->GetCellData()->GetScalars()->GetTuple1(cellIds->GetId(j));
-            if (material == specificMaterial) {
-              ids->InsertNextValue(i);
-              break;
-            }
-          }
-        }
-      }
-    }
-  }
+  const int axes[2] = {axis1, axis2};
+  const float vals[2] = {val1, val2};
+  vtkboneNodeSetsByGeometry_FindNodes (2, axes, vals, ids, ug, specificMaterial);
+
   return VTK_OK;
 }
 
@@ -287,28 +453,10 @@ int vtkboneNodeSetsByGeometry::FindNodesIntersectingThreePlanes
 {
   bonelabMisc::SanityCheck();
 
-  vtkSmartPointer<vtkIdList> cellIds = vtkSmartPointer<vtkIdList>::New();
-
-  for (vtkIdType i=0; i<ug->GetNumberOfPoints(); i++) {
-    if (bonelabMisc::ApproximatelyEqual(ug->GetPoint(i)[axisA], valA)) {
-      if (bonelabMisc::ApproximatelyEqual(ug->GetPoint(i)[axisB], valB)) {
-        if (bonelabMisc::ApproximatelyEqual(ug->GetPoint(i)[axisC], valC)) {
-          if (specificMaterial == -1) {
-            ids->InsertNextValue(i);
-          } else {
-            ug->GetPointCells(i,cellIds);
-            for (int j=0; j<cellIds->GetNumberOfIds(); j++) {
-              int material = ug->GetCellData()->GetScalars()->GetTuple1(cellIds->GetId(j));
-              if (material == specificMaterial) {
-                ids->InsertNextValue(i);
-                break;
-              }
-            }
-          }
-        }
-      }
-    }
-  }
+  const int axes[3] = {axisA, axisB, axisC};
+  const float vals[3] = {valA, valB, valC};
+  vtkboneNodeSetsByGeometry_FindNodes (3, axes, vals, ids, ug, specificMaterial);
+
   return VTK_OK;
 }
 
@@ -19,6 +19,15 @@
  These static methods are typically used to find nodes for boundary
  conditions for finite element models (vtkboneFiniteElementModel).
 
+ The plane queries use an index of the points sorted by coordinate along
+ each axis, so that the points on a plane are found by binary search. The
+ index, together with masks of the points belonging to each material
+ queried, is cached in the information of the data set under the key
+ COORDINATE_INDEX, so that repeated queries on the same model (for
+ example, for each face, edge and corner) share it. It is rebuilt if the
+ points of the data set are modified. Call ReleaseCoordinateIndex when the
+ queries are done to free it.
+
  Note that in the future these static methods may be replaced by filter
  classes.
 
@@ -40,6 +49,7 @@ class vtkIdTypeArray;
 class vtkPolyData;
 class vtkIdList;
 class vtkPoints;
+class vtkInformationObjectBaseKey;
 
 class VTKBONE_EXPORT vtkboneNodeSetsByGeometry : public vtkObject
 {
@@ -48,6 +58,13 @@ public:
   vtkTypeMacro(vtkboneNodeSetsByGeometry,vtkObject);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
+  /*! Key under which the index of the points of a data set is cached in
+      the information of the data set. */
+  static vtkInformationObjectBaseKey* COORDINATE_INDEX();
+
+  /*! Frees the index of the points of data cached by the queries, if any. */
+  static void ReleaseCoordinateIndex(vtkDataSet* data);
+
   //@{
   /*! Determine the bounds of model, either for the whole model, or for the
       SpecificMaterial defined (i.e., representing endcaps). */
@@ -13,9 +13,275 @@
 #include "vtkInformationVector.h"
 #include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkUnsignedCharArray.h"
+#include <algorithm>
+#include <vector>
 
 template <typename T> inline T sqr(T x) {return x*x;}
 
+//----------------------------------------------------------------------------
+// Sums numValues quantities over numBlocks blocks.  compute(b, values) sets
+// values to the sums over block b; blocks are computed in parallel.  The
+// partial sums of the blocks are then added in block order with Kahan
+// (compensated) summation, so that the result is accurate and does not
+// depend on the number of threads.
+template <typename TCompute>
+void TensorOfInertiaReduce
+(
+  vtkIdType numBlocks,
+  int numValues,
+  double* result,
+  TCompute compute
+)
+{
+  std::vector<double> partials (numBlocks*numValues, 0.0);
+  vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType b=begin; b<end; ++b)
+    {
+      compute(b, &partials[b*numValues]);
+    }
+  });
+  for (int v=0; v<numValues; ++v)
+  {
+    double sum = 0;
+    double c = 0;
+    for (vtkIdType b=0; b<numBlocks; ++b)
+    {
+      const double y = partials[b*numValues + v] - c;
+      const double t = sum + y;
+      c = (t - sum) - y;
+      sum = t;
+    }
+    result[v] = sum;
+  }
+}
+
+//----------------------------------------------------------------------------
+// The selection criteria for image voxels.
+struct TensorOfInertiaCriteria
+{
+  int useSpecificValue;
+  int specificValue;
+  int useThresholds;
+  double lowerThreshold;
+  double upperThreshold;
+
+  bool Accept (double val) const
+  {
+    return !((val == 0) ||
+             (useSpecificValue && (int(val) != specificValue)) ||
+             (useThresholds && (val < lowerThreshold || val > upperThreshold)));
+  }
+};
+
+//----------------------------------------------------------------------------
+// Computes over the selected voxels of the raw image buffer the count and
+// the sums of x, y and z (sums[0..3]), then the sums of the second moments
+// about the center of mass (moments[0..5] for xx, yy, zz, xy, yz, zx, with
+// the sign convention of the tensor of inertia).  Each z slice is a
+// block; within a slice the sums are accumulated per row, which needs only
+// the count and the sums of x and x*x along the row.
+template <typename T>
+void TensorOfInertiaImageSums
+(
+  const T* data,
+  const vtkIdType dims[3],
+  const double origin[3],
+  const double spacing[3],
+  const TensorOfInertiaCriteria& criteria,
+  double sums[4],
+  double moments[6]
+)
+{
+  const vtkIdType sliceSize = dims[0]*dims[1];
+  TensorOfInertiaReduce(dims[2], 4, sums, [&](vtkIdType k, double* values)
+  {
+    const double z = origin[2] + k*spacing[2];
+    for (vtkIdType j=0; j<dims[1]; ++j)
+    {
+      const T* row = data + k*sliceSize + j*dims[0];
+      const double y = origin[1] + j*spacing[1];
+      vtkIdType n = 0;
+      double sx = 0;
+      for (vtkIdType i=0; i<dims[0]; ++i)
+      {
+        if (criteria.Accept(static_cast<double>(row[i])))
+        {
+          ++n;
+          sx += origin[0] + i*spacing[0];
+        }
+      }
+      values[0] += n;
+      values[1] += sx;
+      values[2] += n*y;
+      values[3] += n*z;
+    }
+  });
+
+  const double count = sums[0];
+  if (count == 0)
+  {
+    std::fill(moments, moments+6, 0.0);
+    return;
+  }
+  // Shift to center of mass origin
+  double com_origin[3];
+  com_origin[0] = origin[0] - sums[1]/count;
+  com_origin[1] = origin[1] - sums[2]/count;
+  com_origin[2] = origin[2] - sums[3]/count;
+  TensorOfInertiaReduce(dims[2], 6, moments, [&](vtkIdType k, double* values)
+  {
+    const double z = com_origin[2] + k*spacing[2];
+    for (vtkIdType j=0; j<dims[1]; ++j)
+    {
+      const T* row = data + k*sliceSize + j*dims[0];
+      const double y = com_origin[1] + j*spacing[1];
+      vtkIdType n = 0;
+      double sx = 0;
+      double sxx = 0;
+      for (vtkIdType i=0; i<dims[0]; ++i)
+      {
+        if (criteria.Accept(static_cast<double>(row[i])))
+        {
+          const double x = com_origin[0] + i*spacing[0];
+          ++n;
+          sx += x;
+          sxx += x*x;
+        }
+      }
+      values[0] += n*(y*y + z*z);
+      values[1] += n*z*z + sxx;
+      values[2] += sxx + n*y*y;
+      values[3] -= sx*y;
+      values[4] -= n*y*z;
+      values[5] -= z*sx;
+    }
+  });
+}
+
+//----------------------------------------------------------------------------
+// Computes over the voxel cells of a grid, with points of type T, the
+// total volume and the sums of the cell centers (sums[0..3]),
+// then the volume-weighted second moments about the center of mass
+// (moments[0..5], as for TensorOfInertiaImageSums).  Cells are processed
+// in fixed blocks, so that the result does not depend on the number of
+// threads.
+template <typename T>
+void TensorOfInertiaGridSums
+(
+  const T* points,
+  vtkCellArray* cells,
+  double sums[4],
+  double moments[6]
+)
+{
+  const vtkIdType numCells = cells->GetNumberOfCells();
+  const vtkIdType blockSize = 4096;
+  const vtkIdType numBlocks = (numCells + blockSize - 1)/blockSize;
+  vtkSMPThreadLocalObject<vtkIdList> tlIds;
+
+  // Gets the volume and center of a voxel.
+  auto voxel = [&](vtkIdType cellId, double center[3]) -> double
+  {
+    vtkIdType npts;
+    const vtkIdType* pts;
+    cells->GetCellAtId(cellId, npts, pts, tlIds.Local());
+    const double x0 = points[3*pts[0]];
+    const double y0 = points[3*pts[0] + 1];
+    const double z0 = points[3*pts[0] + 2];
+    const double x1 = points[3*pts[1]];
+    const double y2 = points[3*pts[2] + 1];
+    const double z4 = points[3*pts[4] + 2];
+    center[0] = (x1 + x0)/2;
+    center[1] = (y2 + y0)/2;
+    center[2] = (z4 + z0)/2;
+    return (x1 - x0)*(y2 - y0)*(z4 - z0);
+  };
+
+  TensorOfInertiaReduce(numBlocks, 4, sums, [&](vtkIdType b, double* values)
+  {
+    const vtkIdType end = std::min(numCells, (b+1)*blockSize);
+    for (vtkIdType c=b*blockSize; c<end; ++c)
+    {
+      double center[3];
+      values[0] += voxel(c, center);
+      values[1] += center[0];
+      values[2] += center[1];
+      values[3] += center[2];
+    }
+  });
+
+  const double com[3] = {sums[1]/numCells, sums[2]/numCells, sums[3]/numCells};
+  TensorOfInertiaReduce(numBlocks, 6, moments, [&](vtkIdType b, double* values)
+  {
+    const vtkIdType end = std::min(numCells, (b+1)*blockSize);
+    for (vtkIdType c=b*blockSize; c<end; ++c)
+    {
+      double center[3];
+      const double volume = voxel(c, center);
+      const double x = center[0] - com[0];
+      const double y = center[1] - com[1];
+      const double z = center[2] - com[2];
+      values[0] += volume * (y*y + z*z);
+      values[1] += volume * (z*z + x*x);
+      values[2] += volume * (x*x + y*y);
+      values[3] -= volume * (x*y);
+      values[4] -= volume * (y*z);
+      values[5] -= volume * (z*x);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------
+// Accumulates the count, center of mass and second moments about the center
+// of mass (in the sign convention of the tensor of inertia) of image voxels
+// over z-slabs.
+class vtkboneTensorOfInertiaStreamState
+{
+public:
+  vtkboneTensorOfInertiaStreamState() : Count (0), VoxelVolume (0)
+  {
+    std::fill(this->Mean, this->Mean+3, 0.0);
+    std::fill(this->Moments, this->Moments+6, 0.0);
+  }
+
+  // Adds voxels with the given count, center of mass and moments.  The
+  // moments of the union follow from the parallel axis theorem, applied
+  // to the offset between the centers of mass (Chan et al.), which avoids
+  // the cancellation of accumulating moments about a fixed point.
+  void Add (double count, const double mean[3], const double moments[6])
+  {
+    if (count == 0)
+    {
+      return;
+    }
+    const double n = this->Count + count;
+    const double d[3] = {mean[0] - this->Mean[0],
+                         mean[1] - this->Mean[1],
+                         mean[2] - this->Mean[2]};
+    const double f = this->Count*count/n;
+    this->Moments[0] += moments[0] + f*(d[1]*d[1] + d[2]*d[2]);
+    this->Moments[1] += moments[1] + f*(d[2]*d[2] + d[0]*d[0]);
+    this->Moments[2] += moments[2] + f*(d[0]*d[0] + d[1]*d[1]);
+    this->Moments[3] += moments[3] - f*d[0]*d[1];
+    this->Moments[4] += moments[4] - f*d[1]*d[2];
+    this->Moments[5] += moments[5] - f*d[2]*d[0];
+    for (int a=0; a<3; ++a)
+    {
+      this->Mean[a] += d[a]*count/n;
+    }
+    this->Count = n;
+  }
+
+  double Count;
+  double Mean[3];
+  double Moments[6];
+  double VoxelVolume;
+};
+
 vtkStandardNewMacro(vtkboneTensorOfInertia);
 
 //----------------------------------------------------------------------------
@@ -52,6 +318,10 @@ vtkboneTensorOfInertia::vtkboneTensorOfInertia()
   this->PrincipalAxisClosestToZ[1] = 0;
   this->PrincipalAxisClosestToZ[2] = 0;
 
+  this->NumberOfStreamDivisions = 1;
+  this->CurrentStreamDivision = 0;
+  this->StreamState = NULL;
+
   this->SetNumberOfInputPorts(1);
   this->SetNumberOfOutputPorts(0);
 }
@@ -83,6 +353,7 @@ vtkboneTensorOfInertia::~vtkboneTensorOfInertia()
     Eigenvectors->Delete();
     Eigenvectors = NULL;
   }
+  delete this->StreamState;
 }
 
 //----------------------------------------------------------------------------
@@ -94,6 +365,7 @@ void vtkboneTensorOfInertia::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "SpecificValue:" << this->SpecificValue << "\n";
   os << indent << "LowerThreshold:" << this->LowerThreshold << "\n";
   os << indent << "UpperThreshold:" << this->UpperThreshold << "\n";
+  os << indent << "NumberOfStreamDivisions: " << this->NumberOfStreamDivisions << "\n";
 
   // The rest of the values only meaningful if filter has been run already.
   os << indent << "Volume: " << this->GetVolume () << "\n";
@@ -112,6 +384,12 @@ int vtkboneTensorOfInertia::ProcessRequest(vtkInformation* request,
                                           vtkInformationVector** inputVector,
                                           vtkInformationVector* outputVector)
 {
+  // set the update extent of the input
+  if(request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_UPDATE_EXTENT()))
+  {
+    return this->RequestUpdateExtent(request, inputVector, outputVector);
+  }
+
   // generate the data
   if(request->Has(vtkDemandDrivenPipeline::REQUEST_DATA()))
   {
@@ -122,10 +400,50 @@ int vtkboneTensorOfInertia::ProcessRequest(vtkInformation* request,
 }
 
 //----------------------------------------------------------------------------
-int vtkboneTensorOfInertia::RequestData(
+void vtkboneTensorOfInertia::GetStreamDivisionRange
+(
+  const int wholeExtent[6],
+  int division,
+  int range[2]
+)
+{
+  vtkIdType n = wholeExtent[5] - wholeExtent[4] + 1;
+  vtkIdType d = std::min(vtkIdType(this->NumberOfStreamDivisions), n);
+  range[0] = int((n*division)/d);
+  range[1] = int(std::min((n*(division+1))/d, n-1));
+}
+
+//----------------------------------------------------------------------------
+int vtkboneTensorOfInertia::RequestUpdateExtent(
   vtkInformation* vtkNotUsed( request ),
   vtkInformationVector** inputVector,
   vtkInformationVector* vtkNotUsed( outputVector ))
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  if (this->NumberOfStreamDivisions <= 1 ||
+      !inInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+  {
+    return 1;
+  }
+
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  int range[2];
+  this->GetStreamDivisionRange(wholeExtent, this->CurrentStreamDivision, range);
+  int updateExtent[6];
+  std::copy(wholeExtent, wholeExtent+6, updateExtent);
+  updateExtent[4] = wholeExtent[4] + range[0];
+  updateExtent[5] = wholeExtent[4] + range[1];
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExtent, 6);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneTensorOfInertia::RequestData(
+  vtkInformation* request,
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed( outputVector ))
 {
   vtkInformation *inInfo =
     inputVector[0]->GetInformationObject(0);
@@ -133,7 +451,11 @@ int vtkboneTensorOfInertia::RequestData(
   vtkImageData *image = vtkImageData::SafeDownCast(
     inInfo->Get(vtkDataObject::DATA_OBJECT()));
   if (image)
-    { return this->ProcessImage (image); }
+  {
+    if (this->NumberOfStreamDivisions > 1)
+      { return this->ProcessImageStreaming (request, image); }
+    return this->ProcessImage (image);
+  }
 
   vtkUnstructuredGrid *grid = vtkUnstructuredGrid::SafeDownCast(
     inInfo->Get(vtkDataObject::DATA_OBJECT()));
@@ -147,6 +469,84 @@ int vtkboneTensorOfInertia::RequestData(
 //----------------------------------------------------------------------------
 int vtkboneTensorOfInertia::ProcessImage(
   vtkImageData* image)
+{
+  int extent[6];
+  image->GetExtent(extent);
+  int layerEnd = image->GetCellData()->GetScalars() ? extent[5] : extent[5] + 1;
+  vtkboneTensorOfInertiaStreamState state;
+  if (this->AccumulateImage (image, extent[4], layerEnd, &state) != VTK_OK)
+    { return VTK_ERROR; }
+  this->SetImageResults (&state);
+  return VTK_OK;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneTensorOfInertia::ProcessImageStreaming(
+  vtkInformation* request,
+  vtkImageData* image)
+{
+  vtkInformation *inInfo = this->GetInputInformation();
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+  vtkIdType numDivisions = std::min(vtkIdType(this->NumberOfStreamDivisions),
+                                    vtkIdType(wholeExtent[5] - wholeExtent[4] + 1));
+  int onCells = (image->GetCellData()->GetScalars() != NULL);
+
+  if (this->CurrentStreamDivision == 0)
+  {
+    delete this->StreamState;
+    this->StreamState = new vtkboneTensorOfInertiaStreamState;
+  }
+
+  // The voxel layers of this division.  Consecutive divisions share a
+  // layer of points, which is counted with the later division.
+  int range[2];
+  this->GetStreamDivisionRange(wholeExtent, this->CurrentStreamDivision, range);
+  bool finish = (this->CurrentStreamDivision == numDivisions - 1);
+  int layerBegin = wholeExtent[4] + range[0];
+  int layerEnd = finish ? (onCells ? wholeExtent[5] : wholeExtent[5] + 1)
+                        : wholeExtent[4] + range[1];
+
+  // Check that we received what we asked for.
+  int inExt[6];
+  image->GetExtent(inExt);
+  int status = VTK_OK;
+  if (inExt[0] != wholeExtent[0] || inExt[1] != wholeExtent[1] ||
+      inExt[2] != wholeExtent[2] || inExt[3] != wholeExtent[3] ||
+      inExt[4] > layerBegin ||
+      (onCells ? inExt[5] : inExt[5] + 1) < layerEnd)
+  {
+    vtkErrorMacro(<< "Input does not cover the requested z-slab.");
+    status = VTK_ERROR;
+  }
+  else
+  {
+    status = this->AccumulateImage (image, layerBegin, layerEnd, this->StreamState);
+  }
+
+  if (status == VTK_OK && !finish)
+  {
+    ++this->CurrentStreamDivision;
+    request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(), 1);
+    this->UpdateProgress(double(this->CurrentStreamDivision)/numDivisions);
+    return VTK_OK;
+  }
+
+  request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+  this->CurrentStreamDivision = 0;
+  if (status == VTK_OK)
+    { this->SetImageResults (this->StreamState); }
+  delete this->StreamState;
+  this->StreamState = NULL;
+  return status;
+}
+
+//----------------------------------------------------------------------------
+int vtkboneTensorOfInertia::AccumulateImage(
+  vtkImageData* image,
+  int layerBegin,
+  int layerEnd,
+  vtkboneTensorOfInertiaStreamState* state)
 {
   vtkDataArray* scalars = image->GetPointData()->GetScalars();
   int scalarsOnImageCells = 0;
@@ -160,6 +560,12 @@ int vtkboneTensorOfInertia::ProcessImage(
     scalarsOnImageCells = 1;
   }
 
+  if (!scalars)
+  {
+    vtkErrorMacro( << "No data to measure...!");
+    return VTK_ERROR;
+  }
+
   if (scalars->GetNumberOfComponents() != 1)
   {
     vtkErrorMacro(<<"Those aren't very scalar scalars");
@@ -189,6 +595,7 @@ int vtkboneTensorOfInertia::ProcessImage(
     dims[2] = extent[5] - extent[4] + 1;
   }
   assert (numScalars == dims[0]*dims[1]*dims[2]);
+  assert (layerBegin >= extent[4] && layerEnd <= extent[4] + dims[2]);
   double spacing[3];
   image->GetSpacing(spacing);
   double origin[3];
@@ -200,101 +607,78 @@ int vtkboneTensorOfInertia::ProcessImage(
     origin[1] += 0.5*spacing[1];
     origin[2] += 0.5*spacing[2];
   }
+  // Position of the first voxel of the slab.
+  origin[0] += extent[0]*spacing[0];
+  origin[1] += extent[2]*spacing[1];
+  origin[2] += layerBegin*spacing[2];
 
-  //>>> TO DO : In principle, can do this all in one pass, but that is not
-  //            working correctly.
-
-  this->Count = 0;
-  double sum_x = 0.0;
-  double sum_y = 0.0;
-  double sum_z = 0.0;
-  vtkIdType cellId = 0;
-  for (int k=0; k < dims[2]; k++)
-    for (int j=0; j < dims[1]; j++)
-      for (int i=0; i < dims[0]; i++)
-      {
-        double val = scalars->GetTuple1(cellId);
-        int flag = 1;
-        if ((val == 0) ||
-            (UseSpecificValue && (int(val) != SpecificValue)) ||
-            (UseThresholds && (val < LowerThreshold || val > UpperThreshold)))
-          {flag = 0;}
-        if (flag)
-        {
-          this->Count++;
-          double x = origin[0] + i*spacing[0];
-          double y = origin[1] + j*spacing[1];
-          double z = origin[2] + k*spacing[2];
-          sum_x += x;
-          sum_y += y;
-          sum_z += z;
-        }
-        cellId++;
-      }
+  state->VoxelVolume = spacing[0]*spacing[1]*spacing[2];
+  if (layerEnd <= layerBegin)
+    { return VTK_OK; }
 
-  double voxelVolume = spacing[0]*spacing[1]*spacing[2];
+  TensorOfInertiaCriteria criteria;
+  criteria.useSpecificValue = this->UseSpecificValue;
+  criteria.specificValue = this->SpecificValue;
+  criteria.useThresholds = this->UseThresholds;
+  criteria.lowerThreshold = this->LowerThreshold;
+  criteria.upperThreshold = this->UpperThreshold;
+
+  const vtkIdType slabDims[3] = {dims[0], dims[1], layerEnd - layerBegin};
+  const vtkIdType first = (layerBegin - extent[4])*dims[0]*dims[1];
+  double sums[4];
+  double moments[6];
+  switch (scalars->GetDataType())
+  {
+    vtkTemplateMacro(TensorOfInertiaImageSums(
+      static_cast<const VTK_TT*>(scalars->GetVoidPointer(first)),
+      slabDims, origin, spacing, criteria, sums, moments));
+    default:
+      vtkErrorMacro(<<"Unsupported scalar type.");
+      return VTK_ERROR;
+  }
 
-  this->Volume = this->Count * voxelVolume;
-  this->Mass = this->Volume;  // For now, unit density.
+  if (sums[0] > 0)
+  {
+    const double mean[3] = {sums[1]/sums[0], sums[2]/sums[0], sums[3]/sums[0]};
+    state->Add (sums[0], mean, moments);
+  }
+  return VTK_OK;
+}
 
-  this->CenterOfMass[0] = sum_x / this->Count;
-  this->CenterOfMass[1] = sum_y / this->Count;
-  this->CenterOfMass[2] = sum_z / this->Count;
+//----------------------------------------------------------------------------
+void vtkboneTensorOfInertia::SetImageResults(
+  vtkboneTensorOfInertiaStreamState* state)
+{
+  this->Count = vtkIdType(state->Count);
+  double moments[6];
+  for (int i=0; i<6; ++i)
+    { moments[i] = state->Moments[i] * state->VoxelVolume; }
+  this->SetResults (this->Count * state->VoxelVolume, state->Mean, moments);
+}
 
-  double sum_Ixx = 0.0;
-  double sum_Iyy = 0.0;
-  double sum_Izz = 0.0;
-  double sum_Ixy = 0.0;
-  double sum_Iyz = 0.0;
-  double sum_Izx = 0.0;
-  // Shift to center of mass origin
-  double com_origin[3];
-  com_origin[0] = origin[0] - this->CenterOfMass[0];
-  com_origin[1] = origin[1] - this->CenterOfMass[1];
-  com_origin[2] = origin[2] - this->CenterOfMass[2];
-  cellId = 0;
-  for (int k=0; k < dims[2]; k++)
-    for (int j=0; j < dims[1]; j++)
-      for (int i=0; i < dims[0]; i++)
-      {
-        double val = scalars->GetTuple1(cellId);
-        int flag = 1;
-        if ((val == 0) ||
-            (UseSpecificValue && (int(val) != SpecificValue)) ||
-            (UseThresholds && (val < LowerThreshold || val > UpperThreshold)))
-          {flag = 0;}
-        if (flag)
-        {
-          double x = com_origin[0] + i*spacing[0];
-          double y = com_origin[1] + j*spacing[1];
-          double z = com_origin[2] + k*spacing[2];
-          sum_Ixx += y*y + z*z;
-          sum_Iyy += z*z + x*x;
-          sum_Izz += x*x + y*y;
-          sum_Ixy -= x*y;
-          sum_Iyz -= y*z;
-          sum_Izx -= z*x;
-        }
-        cellId++;
-      }
+//----------------------------------------------------------------------------
+void vtkboneTensorOfInertia::SetResults(
+  double volume,
+  const double centerOfMass[3],
+  const double moments[6])
+{
+  this->Volume = volume;
+  this->Mass = this->Volume;  // For now, unit density.
 
-  sum_Ixx *= voxelVolume;
-  sum_Iyy *= voxelVolume;
-  sum_Izz *= voxelVolume;
-  sum_Ixy *= voxelVolume;
-  sum_Iyz *= voxelVolume;
-  sum_Izx *= voxelVolume;
+  this->CenterOfMass[0] = centerOfMass[0];
+  this->CenterOfMass[1] = centerOfMass[1];
+  this->CenterOfMass[2] = centerOfMass[2];
 
   this->TensorOfInertia->Initialize();
-  this->TensorOfInertia->SetComponent (0, 0, sum_Ixx);
-  this->TensorOfInertia->SetComponent (1, 1, sum_Iyy);
-  this->TensorOfInertia->SetComponent (2, 2, sum_Izz);
-  this->TensorOfInertia->SetComponent (0, 1, sum_Ixy);
-  this->TensorOfInertia->SetComponent (1, 0, sum_Ixy);
-  this->TensorOfInertia->SetComponent (1, 2, sum_Iyz);
-  this->TensorOfInertia->SetComponent (2, 1, sum_Iyz);
-  this->TensorOfInertia->SetComponent (2, 0, sum_Izx);
-  this->TensorOfInertia->SetComponent (0, 2, sum_Izx);
+  this->TensorOfInertia->SetComponent (0, 0, moments[0]);
+  this->TensorOfInertia->SetComponent (1, 1, moments[1]);
+  this->TensorOfInertia->SetComponent (2, 2, moments[2]);
+  this->TensorOfInertia->SetComponent (0, 1, moments[3]);
+  this->TensorOfInertia->SetComponent (1, 0, moments[3]);
+  this->TensorOfInertia->SetComponent (1, 2, moments[4]);
+  this->TensorOfInertia->SetComponent (2, 1, moments[4]);
+  this->TensorOfInertia->SetComponent (2, 0, moments[5]);
+  this->TensorOfInertia->SetComponent (0, 2, moments[5]);
 
   TranslateTensorOfInertiaFromCOM (
     this->TensorOfInertia,
@@ -318,8 +702,6 @@ int vtkboneTensorOfInertia::ProcessImage(
   this->PrincipalAxisClosestToZ[0] = this->Eigenvectors->GetElement(0,2);
   this->PrincipalAxisClosestToZ[1] = this->Eigenvectors->GetElement(1,2);
   this->PrincipalAxisClosestToZ[2] = this->Eigenvectors->GetElement(2,2);
-
-  return VTK_OK;
 }
 
 //----------------------------------------------------------------------------
@@ -330,115 +712,33 @@ int vtkboneTensorOfInertia::ProcessUnstructuredGrid(
     { return VTK_OK; }
   this->Count = grid->GetNumberOfCells();
 
-  vtkCellArray* cells = grid->GetCells();
-  vtkPoints* points = grid->GetPoints();
-
-  //>>> TO DO : In principle, can do this all in one pass, but that is not
-  //            working correctly.
-
-  this->Volume = 0;
-  cells->InitTraversal();
-  vtkIdType npts = 0;
-  const vtkIdType* pts = nullptr;
-  vtkIdType pts1[8];
-  vtkIdType cellid = 0;
-  double sum_centers[3] = {0, 0, 0};
-  while (cells->GetNextCell(npts, pts))
-  {
-    switch (grid->GetCellType(cellid))
+  vtkUnsignedCharArray* types = grid->GetCellTypesArray();
+  for (vtkIdType cellid=0; cellid<this->Count; ++cellid)
+  {
+    if (types->GetValue(cellid) != VTK_VOXEL)
     {
-      case VTK_VOXEL:
-        this->Volume += (points->GetPoint(pts[1])[0] - points->GetPoint(pts[0])[0])
-                      * (points->GetPoint(pts[2])[1] - points->GetPoint(pts[0])[1])
-                      * (points->GetPoint(pts[4])[2] - points->GetPoint(pts[0])[2]);
-        sum_centers[0] += (points->GetPoint(pts[1])[0] + points->GetPoint(pts[0])[0])/2;
-        sum_centers[1] += (points->GetPoint(pts[2])[1] + points->GetPoint(pts[0])[1])/2;
-        sum_centers[2] += (points->GetPoint(pts[4])[2] + points->GetPoint(pts[0])[2])/2;
-        break;
-      default:
-        vtkErrorMacro(<<"Unsupported Element Type.");
-        return VTK_ERROR;
+      vtkErrorMacro(<<"Unsupported Element Type.");
+      return VTK_ERROR;
     }
-    ++cellid;
   }
 
-  this->CenterOfMass[0] = sum_centers[0] / this->Count;
-  this->CenterOfMass[1] = sum_centers[1] / this->Count;
-  this->CenterOfMass[2] = sum_centers[2] / this->Count;
-
-  this->Mass = this->Volume;  // For now, unit density.
-
-  double sum_Ixx = 0.0;
-  double sum_Iyy = 0.0;
-  double sum_Izz = 0.0;
-  double sum_Ixy = 0.0;
-  double sum_Iyz = 0.0;
-  double sum_Izx = 0.0;
-  cells->InitTraversal();
-  cellid = 0;
-  while (cells->GetNextCell(npts, pts))
-  {
-    switch (grid->GetCellType(cellid))
-    {
-      case VTK_VOXEL:
-      { // scope for temp variable definition within switch
-        double volume = (points->GetPoint(pts[1])[0] - points->GetPoint(pts[0])[0])
-                      * (points->GetPoint(pts[2])[1] - points->GetPoint(pts[0])[1])
-                      * (points->GetPoint(pts[4])[2] - points->GetPoint(pts[0])[2]);
-        double x = (points->GetPoint(pts[1])[0] + points->GetPoint(pts[0])[0])/2
-                 - this->CenterOfMass[0];
-        double y = (points->GetPoint(pts[2])[1] + points->GetPoint(pts[0])[1])/2
-                 - this->CenterOfMass[1];
-        double z = (points->GetPoint(pts[4])[2] + points->GetPoint(pts[0])[2])/2
-                 - this->CenterOfMass[2];
-        sum_Ixx += volume * (y*y + z*z);
-        sum_Iyy += volume * (z*z + x*x);
-        sum_Izz += volume * (x*x + y*y);
-        sum_Ixy -= volume * (x*y);
-        sum_Iyz -= volume * (y*z);
-        sum_Izx -= volume * (z*x);
-        break;
-      }
-      default:
-        vtkErrorMacro(<<"Unsupported Element Type.");
-        return VTK_ERROR;
-    }
-    ++cellid;
+  vtkDataArray* coords = grid->GetPoints()->GetData();
+  double sums[4];
+  double moments[6];
+  switch (coords->GetDataType())
+  {
+    vtkTemplateMacro(TensorOfInertiaGridSums(
+      static_cast<const VTK_TT*>(coords->GetVoidPointer(0)),
+      grid->GetCells(), sums, moments));
+    default:
+      vtkErrorMacro(<<"Unsupported point type.");
+      return VTK_ERROR;
   }
 
-  this->TensorOfInertia->Initialize();
-  this->TensorOfInertia->SetComponent (0, 0, sum_Ixx);
-  this->TensorOfInertia->SetComponent (1, 1, sum_Iyy);
-  this->TensorOfInertia->SetComponent (2, 2, sum_Izz);
-  this->TensorOfInertia->SetComponent (0, 1, sum_Ixy);
-  this->TensorOfInertia->SetComponent (1, 0, sum_Ixy);
-  this->TensorOfInertia->SetComponent (1, 2, sum_Iyz);
-  this->TensorOfInertia->SetComponent (2, 1, sum_Iyz);
-  this->TensorOfInertia->SetComponent (2, 0, sum_Izx);
-  this->TensorOfInertia->SetComponent (0, 2, sum_Izx);
-
-  TranslateTensorOfInertiaFromCOM (
-    this->TensorOfInertia,
-    this->Mass,
-    this->CenterOfMass,
-    this->TensorOfInertiaAboutOrigin);
-
-  // Ew! VTK should really provide an interface that doesn't force
-  // a reinterpret cast.
-  vtkMath::Diagonalize3x3  (
-    reinterpret_cast<double(*)[3]>(this->TensorOfInertia->T),
-    this->PrincipalMoments,
-    reinterpret_cast<double(*)[3]>(this->Eigenvectors->GetData()));
-
-  this->PrincipalAxisClosestToX[0] = this->Eigenvectors->GetElement(0,0);
-  this->PrincipalAxisClosestToX[1] = this->Eigenvectors->GetElement(1,0);
-  this->PrincipalAxisClosestToX[2] = this->Eigenvectors->GetElement(2,0);
-  this->PrincipalAxisClosestToY[0] = this->Eigenvectors->GetElement(0,1);
-  this->PrincipalAxisClosestToY[1] = this->Eigenvectors->GetElement(1,1);
-  this->PrincipalAxisClosestToY[2] = this->Eigenvectors->GetElement(2,1);
-  this->PrincipalAxisClosestToZ[0] = this->Eigenvectors->GetElement(0,2);
-  this->PrincipalAxisClosestToZ[1] = this->Eigenvectors->GetElement(1,2);
-  this->PrincipalAxisClosestToZ[2] = this->Eigenvectors->GetElement(2,2);
+  const double centerOfMass[3] = {sums[1] / this->Count,
+                                  sums[2] / this->Count,
+                                  sums[3] / this->Count};
+  this->SetResults (sums[0], centerOfMass, moments);
 
   return VTK_OK;
 }
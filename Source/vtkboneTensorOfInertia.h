@@ -19,6 +19,19 @@
 
  vtkUnstructuredGrid inputs must consists of only cells of type VTK_VOXEL.
 
+ For image inputs, set NumberOfStreamDivisions to a value greater than 1 to
+ compute the results from successive z-slabs requested from the upstream
+ pipeline, so that images larger than the available memory can be
+ processed, for example directly from vtkboneAIMReader or vtkboneISQReader.
+ The moments of each slab are computed about its own center of mass, and
+ are combined using the parallel axis theorem.
+
+ The voxel positions of image inputs are computed from the origin, the
+ spacing and the extent, so that an image whose extent does not start at
+ zero is measured at its actual position.  If no voxel or cell matches the
+ criteria, the count, volume, center of mass and tensors of inertia are all
+ zero.
+
     @sa
  vtkMassProperties
 */
@@ -34,6 +47,7 @@
 
 // forward declarations
 class vtkMatrix3x3;
+class vtkboneTensorOfInertiaStreamState;
 
 class VTKBONE_EXPORT vtkboneTensorOfInertia : public vtkAlgorithm
 {
@@ -96,6 +110,15 @@ public:
   vtkGetMacro(UpperThreshold, double);
   //@}
 
+  //@{
+  /*! Set/Get the number of z-slabs an image input is requested in. A value
+      of 1 (the default) requests the whole input at once. Values larger
+      than the number of z slices are reduced to the number of z slices.
+      Does not apply to vtkUnstructuredGrid inputs. */
+  vtkSetClampMacro(NumberOfStreamDivisions, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfStreamDivisions, int);
+  //@}
+
   //@{
   /*! Compute and return the count of cells matching the criteria. */
   vtkGetMacro(Count, vtkIdType);
@@ -190,8 +213,39 @@ protected:
                           vtkInformationVector** inputVector,
                           vtkInformationVector* outputVector);
 
+  virtual int RequestUpdateExtent(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector);
+
   virtual int ProcessImage(vtkImageData* image);
 
+  /*! Accumulates one z-slab in streaming mode. Sets CONTINUE_EXECUTING on
+      the request until the last slab has arrived, and then sets the
+      results. */
+  virtual int ProcessImageStreaming(vtkInformation* request, vtkImageData* image);
+
+  /*! Adds the selected voxels of the voxel layers layerBegin to layerEnd-1
+      (z indices in the extent of image) to state. */
+  int AccumulateImage(vtkImageData* image,
+                      int layerBegin,
+                      int layerEnd,
+                      vtkboneTensorOfInertiaStreamState* state);
+
+  /*! Computes the range of point z-indices (relative to the whole
+      extent) requested for a stream division. */
+  void GetStreamDivisionRange(const int wholeExtent[6],
+                              int division,
+                              int range[2]);
+
+  /*! Sets the results from the voxels accumulated in state. */
+  void SetImageResults(vtkboneTensorOfInertiaStreamState* state);
+
+  /*! Sets the results from the volume, center of mass and tensor of
+      inertia about the center of mass (as xx, yy, zz, xy, yz, zx). */
+  void SetResults(double volume,
+                  const double centerOfMass[3],
+                  const double moments[6]);
+
   virtual int ProcessUnstructuredGrid(vtkUnstructuredGrid* grid);
 
   virtual int FillInputPortInformation(int port, vtkInformation* info) override;
@@ -202,6 +256,11 @@ protected:
   int           SpecificValue;
   double        LowerThreshold;
   double        UpperThreshold;
+  int           NumberOfStreamDivisions;
+
+  // Streaming state
+  int           CurrentStreamDivision;
+  vtkboneTensorOfInertiaStreamState* StreamState;
 
   // Results
   vtkIdType     	Count;
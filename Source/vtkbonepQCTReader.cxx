@@ -9,14 +9,59 @@
 #include "vtkInformationVector.h"
 #include "vtkInformation.h"
 #include "vtkInformationIntegerKey.h"
+#include "vtkInformationIntegerVectorKey.h"
+#include "vtkInformationDoubleVectorKey.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkSmartPointer.h"
 #include "pQCTIO/pQCTIO.h"
+#include "FileHeaderCache.h"
 #include <cassert>
 
 
+namespace pQCTReader_Utility
+{
+
+// The header information used by the reader.  pQCT files are not Scanco
+// files, so the image data is read by pQCTIO; the parsed pQCTIO object is
+// kept so that the data can be read without parsing the header again.
+struct pQCTHeader
+{
+  int dimensions[2];
+  double voxel_size;
+  pQCTIO::pQCTFile file;
+};
+
+// Parses the header of filename.  Throws on error.
+bool parse_header (const char* filename, pQCTHeader& header)
+{
+  header.file = pQCTIO::pQCTFile();
+  header.file.filename = filename;
+  header.file.ReadImageInfo();
+  header.dimensions[0] = header.file.PicMatrixX;
+  header.dimensions[1] = header.file.PicMatrixY;
+  header.voxel_size = header.file.VoxelSize;
+  return true;
+}
+
+FileHeaderCache<pQCTHeader> header_cache;
+
+// Returns the header of filename, parsing the file only if required.
+// Throws on error.
+bool read_header (const char* filename, pQCTHeader& header)
+{
+  return header_cache.Read (filename, header, parse_header);
+}
+
+}  // namespace pQCTReader_Utility
+
+using namespace pQCTReader_Utility;
+
 vtkStandardNewMacro (vtkbonepQCTReader);
 
+vtkInformationKeyMacro (vtkbonepQCTReader, DIMENSION, IntegerVector);
+vtkInformationKeyMacro (vtkbonepQCTReader, ELEMENT_SIZE, DoubleVector);
+vtkInformationKeyMacro (vtkbonepQCTReader, SCALAR_TYPE, Integer);
+
 //-----------------------------------------------------------------------
 vtkbonepQCTReader::vtkbonepQCTReader()
 {
@@ -62,12 +107,10 @@ int vtkbonepQCTReader::RequestInformation (
     return 0;
   }
 
-  pQCTIO::pQCTFile reader;
-
-  reader.filename = this->FileName;
+  pQCTHeader header;
   try
   {
-    reader.ReadImageInfo();
+    read_header (this->FileName, header);
   }
   catch (const std::exception& e)
   {
@@ -75,11 +118,11 @@ int vtkbonepQCTReader::RequestInformation (
     return 0;
   }
 
-  this->ElementSize[0] = reader.VoxelSize;
-  this->ElementSize[1] = reader.VoxelSize;
+  this->ElementSize[0] = header.voxel_size;
+  this->ElementSize[1] = header.voxel_size;
   this->ElementSize[2] = 2;
-  this->Dimension[0] = reader.PicMatrixX;
-  this->Dimension[1] = reader.PicMatrixY;
+  this->Dimension[0] = header.dimensions[0];
+  this->Dimension[1] = header.dimensions[1];
   this->Dimension[2] = 0;
   this->Position[0] = 0;
   this->Position[1] = 0;
@@ -99,30 +142,30 @@ int vtkbonepQCTReader::RequestInformation (
   // This is so that rendering will be in consistent frames.
 
   double spacing[3];
-  spacing[0] = reader.VoxelSize;
-  spacing[1] = reader.VoxelSize;
+  spacing[0] = header.voxel_size;
+  spacing[1] = header.voxel_size;
   spacing[2] = 2;
 
   int extent[6];
   double origin[3];
   if (DataOnCells == 0)  // on Points
   {
-    extent[0] = 0;   extent[1] = reader.PicMatrixX - 1;
-    extent[2] = 0;   extent[3] = reader.PicMatrixY - 1;
+    extent[0] = 0;   extent[1] = header.dimensions[0] - 1;
+    extent[2] = 0;   extent[3] = header.dimensions[1] - 1;
     extent[4] = 0;   extent[5] = 0;
 
-    origin[0] = (0 + 0.5) * reader.VoxelSize;
-    origin[1] = (0 + 0.5) * reader.VoxelSize;
+    origin[0] = (0 + 0.5) * header.voxel_size;
+    origin[1] = (0 + 0.5) * header.voxel_size;
     origin[2] = (0 + 0.5) * 2;
   }
   else // on Cells
   {
-    extent[0] = 0;   extent[1] = reader.PicMatrixX;
-    extent[2] = 0;   extent[3] = reader.PicMatrixY;
+    extent[0] = 0;   extent[1] = header.dimensions[0];
+    extent[2] = 0;   extent[3] = header.dimensions[1];
     extent[4] = 0;   extent[5] = 0;
 
-    origin[0] = 0 * reader.VoxelSize;
-    origin[1] = 0 * reader.VoxelSize;
+    origin[0] = 0 * header.voxel_size;
+    origin[1] = 0 * header.voxel_size;
     origin[2] = (0 + 0.5) * 2;
   }
 
@@ -160,11 +203,11 @@ int vtkbonepQCTReader::RequestData (vtkInformation*,
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
   vtkImageData* out = vtkImageData::GetData (outputVector);
 
-  pQCTIO::pQCTFile reader;
-  reader.filename = this->FileName;
+  // The header is normally cached from RequestInformation.
+  pQCTHeader header;
   try
   {
-    reader.ReadImageInfo();
+    read_header (this->FileName, header);
   }
   catch (const std::exception& e)
   {
@@ -174,18 +217,18 @@ int vtkbonepQCTReader::RequestData (vtkInformation*,
 
   this->UpdateProgress(.70);
 
-  vtkIdType N = reader.number_of_voxels;
+  vtkIdType N = vtkIdType(header.dimensions[0]) * vtkIdType(header.dimensions[1]);
   int extent[6];
   if (DataOnCells == 0)  // on Points
   {
-    extent[0] = 0;   extent[1] = reader.PicMatrixX - 1;
-    extent[2] = 0;   extent[3] = reader.PicMatrixY - 1;
+    extent[0] = 0;   extent[1] = header.dimensions[0] - 1;
+    extent[2] = 0;   extent[3] = header.dimensions[1] - 1;
     extent[4] = 0;   extent[5] = 0;
   }
   else // on Cells
   {
-    extent[0] = 0;   extent[1] = reader.PicMatrixX;
-    extent[2] = 0;   extent[3] = reader.PicMatrixY;
+    extent[0] = 0;   extent[1] = header.dimensions[0];
+    extent[2] = 0;   extent[3] = header.dimensions[1];
     extent[4] = 0;   extent[5] = 0;
   }
   out->SetExtent(extent);
@@ -215,7 +258,7 @@ int vtkbonepQCTReader::RequestData (vtkInformation*,
       sarray->SetNumberOfValues(N);
       try
       {
-        reader.ReadImageData((short*)(sarray->WriteVoidPointer(0,N)), N);
+        header.file.ReadImageData((short*)(sarray->WriteVoidPointer(0,N)), N);
       }
       catch (const std::exception& e)
       {
@@ -249,3 +292,34 @@ int vtkbonepQCTReader::RequestData (vtkInformation*,
 
   return 1;
 }
+
+//----------------------------------------------------------------------------
+int vtkbonepQCTReader::ReadHeader (const char* filename, vtkInformation* info)
+{
+  if (filename == NULL || info == NULL)
+  {
+    return 0;
+  }
+  pQCTHeader header;
+  try
+  {
+    read_header (filename, header);
+  }
+  catch (const std::exception& e)
+  {
+    return 0;
+  }
+  int dimensions[3] = {header.dimensions[0], header.dimensions[1], 0};
+  double element_size[3] = {header.voxel_size, header.voxel_size, 2};
+  info->Set (DIMENSION(), dimensions, 3);
+  info->Set (ELEMENT_SIZE(), element_size, 3);
+  // pQCT always short type
+  info->Set (SCALAR_TYPE(), VTK_SHORT);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkbonepQCTReader::ClearHeaderCache ()
+{
+  header_cache.Clear();
+}
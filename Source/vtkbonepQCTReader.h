@@ -34,6 +34,11 @@
  that most VTK filters which take vtkImageData as input expect the data
  to be on the Points; VTKBONE filters generally accept input images with
  either on the Points or on the Cells.
+
+ Parsed headers are cached (for the process), keyed on the file name,
+ size and modification time, so that a file header is parsed only once
+ for information requests.  ReadHeader gives fast access to the header
+ information without creating a pipeline.
 */
 
 #ifndef __vtkbonepQCTReader_h
@@ -49,6 +54,9 @@
 // Forward declarations
 class vtkImageData;
 class vtkMath;
+class vtkInformationIntegerKey;
+class vtkInformationIntegerVectorKey;
+class vtkInformationDoubleVectorKey;
 
 class VTKBONE_EXPORT vtkbonepQCTReader : public vtkImageAlgorithm
 {
@@ -90,6 +98,23 @@ public:
   vtkGetVector3Macro(ElementSize, double);
   //@}
 
+  //@{
+  /*! Keys for the header information returned by ReadHeader.  These have
+      the same values as Dimension and ElementSize, and SCALAR_TYPE is
+      always VTK_SHORT. */
+  static vtkInformationIntegerVectorKey* DIMENSION();
+  static vtkInformationDoubleVectorKey* ELEMENT_SIZE();
+  static vtkInformationIntegerKey* SCALAR_TYPE();
+  //@}
+
+  /*! Reads only the header of a pQCT file, into info using the keys
+      above.  The image data is not read.  Returns 1 on success, 0 on
+      error. */
+  static int ReadHeader(const char* filename, vtkInformation* info);
+
+  /*! Discards all cached headers. */
+  static void ClearHeaderCache();
+
 
 protected:
   vtkbonepQCTReader();
@@ -0,0 +1,230 @@
+from __future__ import division
+import sys
+import os
+import shutil
+import struct
+import tempfile
+import numpy
+from numpy.core import *
+import vtk
+from vtk.util.numpy_support import vtk_to_numpy, numpy_to_vtk
+import vtkbone
+import traceback
+import unittest
+
+# Scanco type codes (see ScancoFileHelper.h)
+AIM_TYPE_CHAR = 0x00010001
+AIM_TYPE_BINARY_RUN_LENGTH = 0x00150001
+AIM_TYPE_CHAR_RUN_LENGTH = 0x00080002
+
+
+def runs (data):
+    """Returns the (value, length) runs of data."""
+    result = []
+    start = 0
+    for i in range(1, len(data)+1):
+        if i == len(data) or data[i] != data[start]:
+            result.append ((int(data[start]), i - start))
+            start = i
+    return result
+
+
+def encode_binary (data, values):
+    """Binary run-length encoding: a 6 byte header ending with the two
+    values, then the lengths of runs of alternating values.  A run of 255
+    continues with the same value."""
+    stream = bytearray (4) + bytearray ([v & 0xff for v in values])
+    current = 0
+    for value, length in runs (data):
+        if value != values[current]:
+            # Zero length run of the other value
+            stream.append (0)
+            current ^= 1
+        while length >= 255:
+            stream.append (255)
+            length -= 255
+        stream.append (length)
+        current ^= 1
+    return bytes (stream)
+
+
+def encode_char (data):
+    """Char run-length encoding: a 4 byte header, then (count,value) pairs."""
+    stream = bytearray (4)
+    for value, length in runs (data):
+        while length > 0:
+            count = min (length, 255)
+            stream += bytearray ([count, value & 0xff])
+            length -= count
+    return bytes (stream)
+
+
+def aim_blocks (contents):
+    """Returns the block sizes of an AIM file, and their offset and size
+    in bytes in the pre-header."""
+    if contents[:12] == b"AIMDATA_V030":
+        return list(struct.unpack ("<5q", contents[16:56])), 16, 8
+    return list(struct.unpack ("<5i", contents[:20])), 0, 4
+
+
+class TestAIMReader (unittest.TestCase):
+
+    def setUp (self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown (self):
+        vtkbone.vtkboneAIMReader.ClearHeaderCache()
+        shutil.rmtree (self.directory)
+
+    def write_aim (self, data, dims, filename):
+        image = vtk.vtkImageData()
+        image.SetDimensions (dims)
+        image.GetPointData().SetScalars (numpy_to_vtk (data, deep=1))
+        writer = vtkbone.vtkboneAIMWriter()
+        writer.SetInputData (image)
+        writer.SetFileName (filename)
+        writer.Update()
+
+    def replace_data (self, filename, type_code, stream):
+        """Replaces the image data of an AIM file with stream, and sets its
+        type code."""
+        with open (filename, "rb") as f:
+            contents = f.read()
+        blocks, start, size = aim_blocks (contents)
+        code_offset = blocks[0] + 20
+        self.assertEqual (struct.unpack ("<i", contents[code_offset:code_offset+4])[0],
+                          AIM_TYPE_CHAR)
+        data_offset = blocks[0] + blocks[1] + blocks[2]
+        data_end = data_offset + blocks[3]
+        blocks[3] = len(stream)
+        pre_header = struct.pack ("<5q" if size == 8 else "<5i", *blocks)
+        contents = (contents[:start] + pre_header + contents[start+5*size:code_offset]
+                    + struct.pack ("<i", type_code) + contents[code_offset+4:data_offset]
+                    + stream + contents[data_end:])
+        with open (filename, "wb") as f:
+            f.write (contents)
+
+    def read_aim (self, filename, parallel=0, threads=0, extent=None):
+        vtkbone.vtkboneAIMReader.ClearHeaderCache()
+        reader = vtkbone.vtkboneAIMReader()
+        reader.SetFileName (filename)
+        reader.DataOnCellsOff()
+        reader.SetParallelRunLengthDecoding (parallel)
+        reader.SetNumberOfThreads (threads)
+        if extent:
+            reader.UpdateExtent (extent)
+        else:
+            reader.Update()
+        self.assertEqual (reader.GetError(), 0)
+        return vtk_to_numpy (reader.GetOutput().GetPointData().GetScalars()).copy()
+
+    def check_parallel_decoding (self, filename, data, dims):
+        """Checks that the parallel decoder gives the same result as AimIO,
+        for the whole image and a sub-extent."""
+        reference = self.read_aim (filename)
+        self.assertTrue (alltrue (reference == data))
+        extent = (1,7,2,6,1,4)
+        sub_reference = self.read_aim (filename, extent=extent)
+        expected = data.reshape (dims[2],dims[1],dims[0])[
+            extent[4]:extent[5]+1, extent[2]:extent[3]+1, extent[0]:extent[1]+1]
+        self.assertTrue (alltrue (sub_reference == expected.ravel()))
+        for threads in (1, 4):
+            self.assertTrue (alltrue (
+                self.read_aim (filename, 1, threads) == reference))
+            self.assertTrue (alltrue (
+                self.read_aim (filename, 1, threads, extent) == sub_reference))
+
+    def test_decode_binary_run_length (self):
+        dims = (10,8,6)
+        data = zeros (dims[0]*dims[1]*dims[2], int8)
+        data[3:8] = 127
+        data[300:410] = 127
+        data[460:] = 127
+        filename = os.path.join (self.directory, "binary.aim")
+        self.write_aim (zeros(len(data), int8), dims, filename)
+        self.replace_data (filename, AIM_TYPE_BINARY_RUN_LENGTH,
+                           encode_binary (data, (0,127)))
+        self.check_parallel_decoding (filename, data, dims)
+
+    def test_decode_char_run_length (self):
+        dims = (10,8,6)
+        numpy.random.seed (1)
+        data = repeat (numpy.random.randint (-128, 128, 48).astype(int8), 10)
+        data[100:400] = 5
+        filename = os.path.join (self.directory, "char.aim")
+        self.write_aim (zeros(len(data), int8), dims, filename)
+        self.replace_data (filename, AIM_TYPE_CHAR_RUN_LENGTH, encode_char (data))
+        self.check_parallel_decoding (filename, data, dims)
+
+    def streamed_image (self):
+        """Returns a signed char image source that supports sub-extents."""
+        source = vtk.vtkImageMandelbrotSource()
+        source.SetWholeExtent (0,19,0,15,0,11)
+        source.SetMaximumNumberOfIterations (100)
+        cast = vtk.vtkImageCast()
+        cast.SetInputConnection (source.GetOutputPort())
+        cast.SetOutputScalarTypeToSignedChar()
+        return cast
+
+    def test_streamed_write_round_trip (self):
+        source = self.streamed_image()
+        source.Update()
+        expected = vtk_to_numpy (source.GetOutput().GetPointData().GetScalars()).copy()
+        filename = os.path.join (self.directory, "streamed.aim")
+        writer = vtkbone.vtkboneAIMWriter()
+        writer.SetInputConnection (source.GetOutputPort())
+        writer.SetFileName (filename)
+        writer.SetNumberOfStreamDivisions (5)
+        writer.Update()
+        self.assertEqual (writer.GetErrorCode(), 0)
+
+        reader = vtkbone.vtkboneAIMReader()
+        reader.SetFileName (filename)
+        reader.DataOnCellsOff()
+        reader.Update()
+        self.assertEqual (reader.GetError(), 0)
+        self.assertEqual (reader.GetOutput().GetDimensions(), (20,16,12))
+        full = vtk_to_numpy (reader.GetOutput().GetPointData().GetScalars()).copy()
+        self.assertTrue (alltrue (full == expected))
+
+        mapped = vtkbone.vtkboneAIMReader()
+        mapped.SetFileName (filename)
+        mapped.DataOnCellsOff()
+        mapped.MemoryMappingOn()
+        mapped.Update()
+        self.assertEqual (mapped.GetError(), 0)
+        self.assertEqual (mapped.GetDataIsMemoryMapped(), 1)
+        self.assertTrue (alltrue (
+            vtk_to_numpy (mapped.GetOutput().GetPointData().GetScalars()) == full))
+
+    def test_sub_extent_read (self):
+        source = self.streamed_image()
+        filename = os.path.join (self.directory, "sub_extent.aim")
+        writer = vtkbone.vtkboneAIMWriter()
+        writer.SetInputConnection (source.GetOutputPort())
+        writer.SetFileName (filename)
+        writer.SetNumberOfStreamDivisions (3)
+        writer.Update()
+        self.assertEqual (writer.GetErrorCode(), 0)
+
+        reader = vtkbone.vtkboneAIMReader()
+        reader.SetFileName (filename)
+        reader.DataOnCellsOff()
+        reader.Update()
+        full = vtk_to_numpy (reader.GetOutput().GetPointData().GetScalars()).copy()
+        full = full.reshape (12,16,20)
+
+        extent = (2,15,3,12,4,9)
+        sub = vtkbone.vtkboneAIMReader()
+        sub.SetFileName (filename)
+        sub.DataOnCellsOff()
+        sub.UpdateExtent (extent)
+        self.assertEqual (sub.GetError(), 0)
+        self.assertEqual (sub.GetOutput().GetExtent(), extent)
+        data = vtk_to_numpy (sub.GetOutput().GetPointData().GetScalars())
+        expected = full[extent[4]:extent[5]+1, extent[2]:extent[3]+1, extent[0]:extent[1]+1]
+        self.assertTrue (alltrue (data == expected.ravel()))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -32,6 +32,10 @@ class TestApplyCompressionTest (unittest.TestCase):
         model_generator.Update()
         model = model_generator.GetOutput()
 
+        # The index built to find the node sets is not kept on the model.
+        self.assertFalse(model.GetInformation().Has(
+            vtkbone.vtkboneNodeSetsByGeometry.COORDINATE_INDEX()))
+
         # -----------------
         # Check constraints
 
@@ -910,5 +910,125 @@ class TestCoarsenModel (unittest.TestCase):
     self.assertTrue (alltrue(abs(D2-D2_ref) < 1E-2))
 
 
+  def test_hierarchy_and_maps (self):
+    # Create 9x6x5 image with holes
+    numpy.random.seed (1)
+    cellmap = numpy.random.randint (0, 3, 5*6*9).astype(int16)
+    cellmap[0] = 1
+    image = vtk.vtkImageData()
+    image.SetDimensions((10,7,6))     # x,y,z order
+    image.SetSpacing(1.5,1.5,1.5)
+    image.SetOrigin(3.5,4.5,5.5)
+    image.GetCellData().SetScalars(numpy_to_vtk(cellmap, deep=1))
+
+    geometry_generator = vtkbone.vtkboneImageToMesh()
+    geometry_generator.SetInputData(image)
+    geometry_generator.Update()
+    geometry = geometry_generator.GetOutput()
+
+    material = vtkbone.vtkboneLinearIsotropicMaterial()
+    material.SetYoungsModulus(1000)
+    material.SetPoissonsRatio(0.3)
+    material_table = vtkbone.vtkboneMaterialTable()
+    material_table.AddMaterial (1, material)
+    material_table.AddMaterial (2, material)
+
+    generator = vtkbone.vtkboneApplyCompressionTest()
+    generator.SetInputData(0, geometry)
+    generator.SetInputData(1, material_table)
+    generator.Update()
+    model = generator.GetOutput()
+
+    # Two levels in one update, compared with two separate updates.
+    coarsener = vtkbone.vtkboneCoarsenModel()
+    coarsener.SetInputData (model)
+    coarsener.SetNumberOfLevels (2)
+    coarsener.ExportMapsOn()
+    coarsener.Update()
+    self.assertEqual (coarsener.GetLevelOutput(2), coarsener.GetOutput())
+    self.assertEqual (coarsener.GetLevelOutput(3), None)
+    levels = [model, coarsener.GetLevelOutput(1), coarsener.GetLevelOutput(2)]
+
+    fine = model
+    for level in (1, 2):
+      single = vtkbone.vtkboneCoarsenModel()
+      single.SetInputData (fine)
+      single.Update()
+      expected = single.GetOutput()
+      coarse = levels[level]
+      self.assertEqual (coarse.GetNumberOfCells(), expected.GetNumberOfCells())
+      self.assertEqual (coarse.GetNumberOfPoints(), expected.GetNumberOfPoints())
+      self.assertTrue (alltrue (vtk_to_numpy (coarse.GetPoints().GetData()) ==
+                                vtk_to_numpy (expected.GetPoints().GetData())))
+      self.assertTrue (alltrue (vtk_to_numpy (coarse.GetCells().GetConnectivityArray()) ==
+                                vtk_to_numpy (expected.GetCells().GetConnectivityArray())))
+
+      # Check the maps against the geometry.
+      cell_map = vtk_to_numpy (coarse.GetFieldData().GetArray("FineToCoarseCellMap"))
+      point_map = vtk_to_numpy (coarse.GetFieldData().GetArray("FineToCoarsePointMap"))
+      reverse_map = vtk_to_numpy (coarse.GetCellData().GetArray("CoarseToFineCellMap"))
+      self.assertEqual (len(cell_map), fine.GetNumberOfCells())
+      self.assertEqual (len(point_map), fine.GetNumberOfPoints())
+      self.assertEqual (reverse_map.shape, (coarse.GetNumberOfCells(), 8))
+      for c in range (fine.GetNumberOfCells()):
+        b = fine.GetCell(c).GetBounds()
+        center = array ([b[0]+b[1], b[2]+b[3], b[4]+b[5]])/2
+        cb = coarse.GetCell(cell_map[c]).GetBounds()
+        self.assertTrue (cb[0] < center[0] < cb[1])
+        self.assertTrue (cb[2] < center[1] < cb[3])
+        self.assertTrue (cb[4] < center[2] < cb[5])
+        self.assertTrue (c in reverse_map[cell_map[c]])
+      self.assertTrue (alltrue (point_map >= 0))
+      fine = coarse
+
+  def test_reverse_map_at_odd_faces (self):
+    # 5x4x3 cells: odd in x and z, so the coarse cells at the x and z
+    # maximum faces have only padding in their upper slots.
+    cellmap = ones (5*4*3, int16)
+    image = vtk.vtkImageData()
+    image.SetDimensions((6,5,4))
+    image.GetCellData().SetScalars(numpy_to_vtk(cellmap, deep=1))
+    geometry_generator = vtkbone.vtkboneImageToMesh()
+    geometry_generator.SetInputData(image)
+    material = vtkbone.vtkboneLinearIsotropicMaterial()
+    material_table = vtkbone.vtkboneMaterialTable()
+    material_table.AddMaterial (1, material)
+    generator = vtkbone.vtkboneApplyCompressionTest()
+    generator.SetInputConnection(0, geometry_generator.GetOutputPort())
+    generator.SetInputData(1, material_table)
+    coarsener = vtkbone.vtkboneCoarsenModel()
+    coarsener.SetInputConnection (generator.GetOutputPort())
+    coarsener.ExportMapsOn()
+    coarsener.Update()
+    fine = generator.GetOutput()
+    coarse = coarsener.GetOutput()
+    self.assertEqual (coarse.GetNumberOfCells(), 3*2*2)
+    cell_map = vtk_to_numpy (coarse.GetFieldData().GetArray("FineToCoarseCellMap"))
+    reverse_map = vtk_to_numpy (coarse.GetCellData().GetArray("CoarseToFineCellMap"))
+
+    # Each fine cell is listed exactly once, in the slot of its octant.
+    listed = reverse_map[reverse_map >= 0]
+    self.assertEqual (len(listed), fine.GetNumberOfCells())
+    self.assertTrue (alltrue (sort(listed) == arange(fine.GetNumberOfCells())))
+    for c in range (coarse.GetNumberOfCells()):
+      cb = coarse.GetCell(c).GetBounds()
+      mid = array ([cb[0]+cb[1], cb[2]+cb[3], cb[4]+cb[5]])/2
+      upper_x = cb[1] > 5
+      upper_z = cb[5] > 3
+      for slot in range (8):
+        f = reverse_map[c,slot]
+        padding = (upper_x and slot & 1) or (upper_z and slot & 4)
+        if padding:
+          self.assertEqual (f, -1)
+          continue
+        self.assertTrue (f >= 0)
+        self.assertEqual (cell_map[f], c)
+        b = fine.GetCell(f).GetBounds()
+        center = array ([b[0]+b[1], b[2]+b[3], b[4]+b[5]])/2
+        octant = int(center[0] > mid[0]) | (int(center[1] > mid[1]) << 1) | \
+                 (int(center[2] > mid[2]) << 2)
+        self.assertEqual (octant, slot)
+
+
 if __name__ == '__main__':
     unittest.main()
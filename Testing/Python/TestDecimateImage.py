@@ -0,0 +1,193 @@
+from __future__ import division
+import sys
+import numpy
+from numpy.core import *
+import vtk
+from vtk.util.numpy_support import vtk_to_numpy, numpy_to_vtk
+import vtkbone
+import traceback
+import unittest
+
+
+def reference_decimate (data, dims):
+    """Reference 2x2x2 maximum, padding odd dimensions by duplicating
+    the outer-most layer.  dims is in x,y,z order."""
+    a = data.reshape (dims[2], dims[1], dims[0])
+    pad = [(0, n % 2) for n in a.shape]
+    a = numpy.pad (a, pad, mode='edge')
+    nz, ny, nx = a.shape
+    a = a.reshape (nz//2, 2, ny//2, 2, nx//2, 2)
+    return a.max(axis=(1,3,5)).flatten()
+
+
+def reference_reduce (data, dims, factors, reduce):
+    """Reference reduction of blocks of size factors (in x,y,z order),
+    truncated at the image boundary."""
+    a = data.reshape (dims[2], dims[1], dims[0])
+    f = factors[::-1]
+    out = []
+    for k in range (0, a.shape[0], f[0]):
+        for j in range (0, a.shape[1], f[1]):
+            for i in range (0, a.shape[2], f[2]):
+                out.append (reduce (a[k:k+f[0], j:j+f[1], i:i+f[2]].flatten()))
+    return array (out)
+
+
+def majority (values):
+    labels, counts = numpy.unique (values, return_counts=True)
+    return labels[counts == counts.max()].max()
+
+
+class TestDecimateImage (unittest.TestCase):
+
+    def check_cells (self, data, cdims):
+        image = vtk.vtkImageData()
+        image.SetDimensions (cdims[0]+1, cdims[1]+1, cdims[2]+1)
+        image.SetSpacing (0.5, 1.0, 1.5)
+        image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        decimator = vtkbone.vtkboneDecimateImage()
+        decimator.SetInputData (image)
+        decimator.Update()
+        output = decimator.GetOutput()
+        ref = reference_decimate (data, cdims)
+        odims = output.GetDimensions()
+        self.assertEqual (odims, tuple((n+1)//2 + 1 for n in cdims))
+        self.assertEqual (output.GetSpacing(), (1.0, 2.0, 3.0))
+        scalars = vtk_to_numpy (output.GetCellData().GetScalars())
+        self.assertEqual (scalars.dtype, data.dtype)
+        self.assertTrue (alltrue (scalars == ref))
+
+    def test_short_cells (self):
+        numpy.random.seed (1)
+        cdims = (37, 6, 8)
+        data = numpy.random.randint (-100, 100, prod(cdims)).astype(int16)
+        self.check_cells (data, cdims)
+
+    def test_odd_dimensions_negative (self):
+        # All negative values must not be clamped to zero at the odd edges.
+        numpy.random.seed (2)
+        cdims = (19, 5, 3)
+        data = numpy.random.randint (-100, -1, prod(cdims)).astype(int16)
+        self.check_cells (data, cdims)
+
+    def test_other_types (self):
+        numpy.random.seed (3)
+        cdims = (35, 7, 5)
+        for dtype in (int8, uint8, uint16, int32, float32, float64):
+            data = numpy.random.randint (-120, 120, prod(cdims))
+            if dtype in (uint8, uint16):
+                data = abs(data)
+            data = data.astype(dtype)
+            self.check_cells (data, cdims)
+
+    def test_points (self):
+        numpy.random.seed (4)
+        dims = (21, 4, 7)
+        data = numpy.random.randint (0, 127, prod(dims)).astype(uint8)
+        image = vtk.vtkImageData()
+        image.SetDimensions (dims)
+        image.GetPointData().SetScalars (numpy_to_vtk (data, deep=1))
+        decimator = vtkbone.vtkboneDecimateImage()
+        decimator.SetInputData (image)
+        decimator.Update()
+        output = decimator.GetOutput()
+        self.assertEqual (output.GetDimensions(), tuple((n+1)//2 for n in dims))
+        scalars = vtk_to_numpy (output.GetPointData().GetScalars())
+        self.assertTrue (alltrue (scalars == reference_decimate (data, dims)))
+
+    def decimate_cells (self, data, cdims, factors, mode):
+        image = vtk.vtkImageData()
+        image.SetDimensions (cdims[0]+1, cdims[1]+1, cdims[2]+1)
+        image.SetOrigin (1.0, 2.0, 3.0)
+        image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        decimator = vtkbone.vtkboneDecimateImage()
+        decimator.SetInputData (image)
+        decimator.SetDecimationFactors (factors)
+        decimator.SetReductionMode (mode)
+        decimator.Update()
+        output = decimator.GetOutput()
+        self.assertEqual (output.GetDimensions(),
+            tuple((cdims[i]+factors[i]-1)//factors[i] + 1 for i in range(3)))
+        self.assertEqual (output.GetSpacing(), tuple(float(x) for x in factors))
+        self.assertEqual (output.GetOrigin(), (1.0, 2.0, 3.0))
+        return vtk_to_numpy (output.GetCellData().GetScalars())
+
+    def test_factors_maximum (self):
+        numpy.random.seed (5)
+        cdims = (23, 8, 7)
+        data = numpy.random.randint (-50, 50, prod(cdims)).astype(int16)
+        for factors in ((3,3,3), (4,1,2), (1,1,1), (5,2,3)):
+            scalars = self.decimate_cells (data, cdims, factors,
+                                           vtkbone.vtkboneDecimateImage.MAXIMUM)
+            self.assertTrue (alltrue (scalars ==
+                reference_reduce (data, cdims, factors, numpy.max)))
+
+    def test_factors_mean (self):
+        numpy.random.seed (6)
+        cdims = (11, 7, 5)
+        data = numpy.random.randint (0, 100, prod(cdims)).astype(int16)
+        scalars = self.decimate_cells (data, cdims, (3,2,4),
+                                       vtkbone.vtkboneDecimateImage.MEAN)
+        self.assertEqual (scalars.dtype, float32)
+        self.assertTrue (allclose (scalars,
+            reference_reduce (data, cdims, (3,2,4), numpy.mean)))
+
+    def test_factors_majority (self):
+        numpy.random.seed (7)
+        cdims = (10, 9, 5)
+        data = numpy.random.randint (0, 4, prod(cdims)).astype(uint8)
+        scalars = self.decimate_cells (data, cdims, (4,3,2),
+                                       vtkbone.vtkboneDecimateImage.MAJORITY)
+        self.assertEqual (scalars.dtype, uint8)
+        self.assertTrue (alltrue (scalars ==
+            reference_reduce (data, cdims, (4,3,2), majority)))
+
+    def test_factors_occupancy_fraction (self):
+        numpy.random.seed (8)
+        cdims = (9, 10, 6)
+        data = numpy.random.randint (0, 3, prod(cdims)).astype(int16)
+        scalars = self.decimate_cells (data, cdims, (4,4,4),
+                                       vtkbone.vtkboneDecimateImage.OCCUPANCY_FRACTION)
+        self.assertEqual (scalars.dtype, float32)
+        self.assertTrue (allclose (scalars,
+            reference_reduce (data, cdims, (4,4,4),
+                              lambda x: (x != 0).mean())))
+
+    def test_output_scalar_type_information (self):
+        dims = (9, 6, 5)
+        data = arange (prod(dims)).astype(int16)
+        image = vtk.vtkImageData()
+        image.SetDimensions (dims)
+        image.GetPointData().SetScalars (numpy_to_vtk (data, deep=1))
+        decimator = vtkbone.vtkboneDecimateImage()
+        decimator.SetInputData (image)
+        for mode, vtk_type in ((vtkbone.vtkboneDecimateImage.MAXIMUM, vtk.VTK_SHORT),
+                               (vtkbone.vtkboneDecimateImage.MEAN, vtk.VTK_FLOAT),
+                               (vtkbone.vtkboneDecimateImage.OCCUPANCY_FRACTION, vtk.VTK_FLOAT)):
+            decimator.SetReductionMode (mode)
+            decimator.UpdateInformation()
+            self.assertEqual (vtk.vtkImageData.GetScalarType (
+                decimator.GetOutputInformation(0)), vtk_type)
+            decimator.Update()
+            self.assertEqual (decimator.GetOutput().GetScalarType(), vtk_type)
+
+    def test_output_scalar_type_information_cells (self):
+        cdims = (8, 5, 4)
+        image = vtk.vtkImageData()
+        image.SetDimensions (cdims[0]+1, cdims[1]+1, cdims[2]+1)
+        image.GetCellData().SetScalars (numpy_to_vtk (
+            zeros(prod(cdims), int16), deep=1))
+        decimator = vtkbone.vtkboneDecimateImage()
+        decimator.SetInputData (image)
+        decimator.SetReductionModeToMean()
+        decimator.UpdateInformation()
+        info = vtk.vtkDataObject.GetActiveFieldInformation (
+            decimator.GetOutputInformation(0),
+            vtk.vtkDataObject.FIELD_ASSOCIATION_CELLS,
+            vtk.vtkDataSetAttributes.SCALARS)
+        self.assertTrue (info is not None)
+        self.assertEqual (info.Get (vtk.vtkDataObject.FIELD_ARRAY_TYPE()), vtk.VTK_FLOAT)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -289,6 +289,31 @@ class TestImageConnectivityFilter (unittest.TestCase):
         output_data.resize(output_image.GetDimensions())
         self.assertTrue (alltrue (output_data == regions[0] + regions[3]))
 
+    def test_region_statistics(self):
+        regions, input_image = generate_test_image()
+        filter = vtkbone.vtkboneImageConnectivityFilter()
+        filter.SetInputData (input_image)
+        filter.SetExtractionMode (vtkbone.vtkboneImageConnectivityFilter.EXTRACT_ALL_REGIONS)
+        filter.Update()
+        statistics = filter.GetRegionStatistics()
+        self.assertEqual(statistics.GetNumberOfRows(), 4)
+        # Regions are labelled in the order of their first voxel.
+        counts = vtk_to_numpy (statistics.GetColumnByName ("VoxelCount"))
+        self.assertTrue (alltrue (counts == array((36,60,8,1))))
+        first = vtk_to_numpy (statistics.GetColumnByName ("FirstVoxel"))
+        self.assertTrue (alltrue (first == array(((2*20+14)*20+2,
+                                                  (9*20+13)*20+10,
+                                                  (16*20+10)*20+10,
+                                                  (17*20+4)*20+8))))
+        extent = vtk_to_numpy (statistics.GetColumnByName ("Extent"))
+        self.assertTrue (alltrue (extent[0] == array((2,5,14,16,2,4))))
+        self.assertTrue (alltrue (extent[3] == array((8,8,4,4,17,17))))
+        centroid = vtk_to_numpy (statistics.GetColumnByName ("Centroid"))
+        origin = array ((0.2,-1.0,1.5))
+        spacing = array ((2,4,5.5))
+        self.assertTrue (allclose (centroid[0], origin + array((3.5,15,3))*spacing))
+        self.assertTrue (allclose (centroid[1], origin + array((11.5,15,10))*spacing))
+
 
 if __name__ == '__main__':
     unittest.main()
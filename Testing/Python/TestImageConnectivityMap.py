@@ -9,6 +9,33 @@ import traceback
 import unittest
 
 
+def reference_connectivity_map (data, connectivity=6):
+    """Seed-scan breadth-first labelling; data is indexed as [k,j,i]."""
+    max_order = {6:1, 18:2, 26:3}[connectivity]
+    offsets = [(dk,dj,di) for dk in (-1,0,1) for dj in (-1,0,1) for di in (-1,0,1)
+               if 0 < abs(dk)+abs(dj)+abs(di) <= max_order]
+    labels = zeros(data.shape, int)
+    count = 0
+    for seed in zip(*nonzero(data)):
+        if labels[seed] != 0:
+            continue
+        count += 1
+        labels[seed] = count
+        wave = [seed]
+        while wave:
+            new_wave = []
+            for (k,j,i) in wave:
+                for (dk,dj,di) in offsets:
+                    n = (k+dk, j+dj, i+di)
+                    if min(n) < 0 or n[0] >= data.shape[0] or n[1] >= data.shape[1] or n[2] >= data.shape[2]:
+                        continue
+                    if data[n] != 0 and labels[n] == 0:
+                        labels[n] = count
+                        new_wave.append(n)
+            wave = new_wave
+    return labels, count
+
+
 class TestImageConnectivityMap (unittest.TestCase):
 
     def test_data_on_points(self):
@@ -480,6 +507,58 @@ class TestImageConnectivityMap (unittest.TestCase):
                                  [0,0,0]]] )
         self.assertTrue (alltrue(cmap_data == expected_cmap))
 
+    def check_random_against_reference(self, connectivity, dtype, threshold):
+        numpy.random.seed (5)
+        dims = (37,17,31)
+        data = (numpy.random.rand(dims[2],dims[1],dims[0]) > threshold).astype(dtype)
+        input_image = vtk.vtkImageData()
+        input_image.SetDimensions (dims)
+        input_image.GetPointData().SetScalars (numpy_to_vtk (data.flatten(), deep=1))
+        filter = vtkbone.vtkboneImageConnectivityMap()
+        filter.SetInputData (input_image)
+        filter.SetConnectivity (connectivity)
+        filter.Update()
+        expected_cmap, expected_count = reference_connectivity_map (data, connectivity)
+        self.assertEqual (filter.GetNumberOfRegions(), expected_count)
+        cmap_data = vtk_to_numpy (filter.GetOutput().GetPointData().GetScalars())
+        self.assertTrue (alltrue(cmap_data == expected_cmap.flatten()))
+
+    def test_random_against_reference(self):
+        self.check_random_against_reference (6, int16, 0.62)
+        self.check_random_against_reference (6, uint8, 0.5)
+        self.check_random_against_reference (6, float32, 0.7)
+
+    def test_random_against_reference_18(self):
+        self.check_random_against_reference (18, int16, 0.75)
+        self.check_random_against_reference (18, uint8, 0.8)
+        self.check_random_against_reference (18, int32, 0.7)
+
+    def test_random_against_reference_26(self):
+        self.check_random_against_reference (26, int16, 0.8)
+        self.check_random_against_reference (26, uint8, 0.85)
+        self.check_random_against_reference (26, float64, 0.8)
+
+    def test_diagonal_voxels(self):
+        input_image = vtk.vtkImageData()
+        input_image.SetDimensions (3,3,3)
+        input_image.AllocateScalars (vtk.VTK_SHORT, 1)
+        input_data = vtk_to_numpy (input_image.GetPointData().GetScalars())
+        input_data.resize(3,3,3)
+        input_data[:,:,:] = 0
+        input_data[0,0,0] = 1
+        input_data[0,1,1] = 1
+        input_data[1,2,2] = 1
+        filter = vtkbone.vtkboneImageConnectivityMap()
+        filter.SetInputData (input_image)
+        filter.Update()
+        self.assertEqual (filter.GetNumberOfRegions(), 3)
+        filter.SetConnectivityToEdges()
+        filter.Update()
+        self.assertEqual (filter.GetNumberOfRegions(), 2)
+        filter.SetConnectivityToVertices()
+        filter.Update()
+        self.assertEqual (filter.GetNumberOfRegions(), 1)
+
 
 if __name__ == '__main__':
     unittest.main()
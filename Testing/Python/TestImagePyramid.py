@@ -0,0 +1,86 @@
+from __future__ import division
+import sys
+import numpy
+from numpy.core import *
+import vtk
+from vtk.util.numpy_support import vtk_to_numpy, numpy_to_vtk
+import vtkbone
+import traceback
+import unittest
+
+
+class TestImagePyramid (unittest.TestCase):
+
+    def make_image (self, cdims, data):
+        image = vtk.vtkImageData()
+        image.SetDimensions (cdims[0]+1, cdims[1]+1, cdims[2]+1)
+        image.SetOrigin (-1.0, 0.5, 2.0)
+        image.SetSpacing (0.5, 0.5, 0.25)
+        image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        return image
+
+    def check_against_decimate (self, image, factors, mode, levels):
+        pyramid = vtkbone.vtkboneImagePyramid()
+        pyramid.SetInputData (image)
+        pyramid.SetNumberOfLevels (levels)
+        pyramid.SetDecimationFactors (factors)
+        pyramid.SetReductionMode (mode)
+        pyramid.Update()
+        output = pyramid.GetOutput()
+        self.assertEqual (output.GetNumberOfBlocks(), levels)
+        previous = image
+        for l in range (levels):
+            decimator = vtkbone.vtkboneDecimateImage()
+            decimator.SetInputData (previous)
+            decimator.SetDecimationFactors (factors)
+            if l > 0 and mode in (vtkbone.vtkboneDecimateImage.MEAN,
+                                  vtkbone.vtkboneDecimateImage.OCCUPANCY_FRACTION):
+                decimator.SetReductionMode (vtkbone.vtkboneDecimateImage.MEAN)
+            else:
+                decimator.SetReductionMode (mode)
+            decimator.Update()
+            expected = decimator.GetOutput()
+            level = output.GetBlock (l)
+            self.assertEqual (level.GetDimensions(), expected.GetDimensions())
+            self.assertTrue (allclose (level.GetOrigin(), expected.GetOrigin()))
+            self.assertTrue (allclose (level.GetSpacing(), expected.GetSpacing()))
+            a = vtk_to_numpy (level.GetCellData().GetScalars())
+            b = vtk_to_numpy (expected.GetCellData().GetScalars())
+            self.assertEqual (a.dtype, b.dtype)
+            self.assertTrue (alltrue (a == b))
+            previous = expected
+
+    def test_maximum (self):
+        numpy.random.seed (1)
+        cdims = (37, 21, 45)
+        data = numpy.random.randint (0, 50, prod(cdims)).astype(int16)
+        self.check_against_decimate (self.make_image (cdims, data), (2,2,2),
+                                     vtkbone.vtkboneDecimateImage.MAXIMUM, 3)
+
+    def test_majority_factors (self):
+        numpy.random.seed (2)
+        cdims = (30, 17, 40)
+        data = numpy.random.randint (0, 3, prod(cdims)).astype(uint8)
+        self.check_against_decimate (self.make_image (cdims, data), (3,2,2),
+                                     vtkbone.vtkboneDecimateImage.MAJORITY, 2)
+
+    def test_occupancy_fraction (self):
+        numpy.random.seed (3)
+        cdims = (16, 16, 32)
+        data = numpy.random.randint (0, 2, prod(cdims)).astype(int16)
+        image = self.make_image (cdims, data)
+        self.check_against_decimate (image, (2,2,2),
+                                     vtkbone.vtkboneDecimateImage.OCCUPANCY_FRACTION, 3)
+        # With dimensions that are multiples of the factors, the coarsest
+        # level is the occupancy fraction of 8x8x8 blocks.
+        pyramid = vtkbone.vtkboneImagePyramid()
+        pyramid.SetInputData (image)
+        pyramid.SetReductionMode (vtkbone.vtkboneDecimateImage.OCCUPANCY_FRACTION)
+        pyramid.Update()
+        coarsest = vtk_to_numpy (pyramid.GetOutput().GetBlock(2).GetCellData().GetScalars())
+        ref = (data.reshape (4,8,2,8,2,8) != 0).mean(axis=(1,3,5)).flatten()
+        self.assertTrue (allclose (coarsest, ref))
+
+
+if __name__ == '__main__':
+    unittest.main()
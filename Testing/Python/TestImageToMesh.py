@@ -0,0 +1,183 @@
+from __future__ import division
+import sys
+import numpy
+from numpy.core import *
+import vtk
+from vtk.util.numpy_support import vtk_to_numpy, numpy_to_vtk
+from vtk.util.vtkAlgorithm import VTKPythonAlgorithmBase
+import vtkbone
+import traceback
+import unittest
+
+
+def reference_mesh (image):
+    """Serial reference implementation of the image to mesh conversion,
+    operating on an image with scalars on the cells."""
+    dims = image.GetDimensions()
+    cdims = (dims[0]-1, dims[1]-1, dims[2]-1)
+    scalars = vtk_to_numpy (image.GetCellData().GetScalars())
+    cell_ids = nonzero(scalars)[0]
+    used = zeros(dims[0]*dims[1]*dims[2], bool)
+    cells = []
+    for c in cell_ids:
+        i = c % cdims[0]
+        j = (c // cdims[0]) % cdims[1]
+        k = c // (cdims[0]*cdims[1])
+        p0 = (k*dims[1] + j)*dims[0] + i
+        ids = [p0, p0+1, p0+dims[0], p0+dims[0]+1]
+        ids = ids + [p + dims[0]*dims[1] for p in ids]
+        used[ids] = True
+        cells.append (ids)
+    point_map = -ones(len(used), int)
+    point_map[used] = arange(used.sum())
+    points = array([image.GetPoint(p) for p in nonzero(used)[0]])
+    cells = point_map[array(cells, int)]
+    return points, cells, scalars[cell_ids]
+
+
+class FailingImageSource (VTKPythonAlgorithmBase):
+    """Image source that produces point scalars for the requested extent,
+    but produces no scalars from execution number fail_at onwards."""
+
+    def __init__ (self, fail_at):
+        VTKPythonAlgorithmBase.__init__ (self, nInputPorts=0, nOutputPorts=1,
+                                         outputType="vtkImageData")
+        self.fail_at = fail_at
+        self.executions = 0
+
+    def RequestInformation (self, request, inInfo, outInfo):
+        info = outInfo.GetInformationObject(0)
+        info.Set (vtk.vtkStreamingDemandDrivenPipeline.WHOLE_EXTENT(), (0,4,0,3,0,8), 6)
+        return 1
+
+    def RequestData (self, request, inInfo, outInfo):
+        info = outInfo.GetInformationObject(0)
+        output = vtk.vtkImageData.GetData (outInfo)
+        output.SetExtent (info.Get (vtk.vtkStreamingDemandDrivenPipeline.UPDATE_EXTENT()))
+        self.executions += 1
+        if self.executions < self.fail_at:
+            data = ones (output.GetNumberOfPoints(), int16)
+            output.GetPointData().SetScalars (numpy_to_vtk (data, deep=1))
+        return 1
+
+
+class TestImageToMesh (unittest.TestCase):
+
+    def check_against_reference (self, image, cell_image):
+        filter = vtkbone.vtkboneImageToMesh()
+        filter.SetInputData (image)
+        filter.Update()
+        mesh = filter.GetOutput()
+        ref_points, ref_cells, ref_scalars = reference_mesh (cell_image)
+        self.assertEqual (mesh.GetNumberOfPoints(), len(ref_points))
+        self.assertEqual (mesh.GetNumberOfCells(), len(ref_cells))
+        self.assertEqual (mesh.GetCellType(0), vtk.VTK_VOXEL)
+        points = vtk_to_numpy (mesh.GetPoints().GetData())
+        self.assertTrue (alltrue (abs(points - ref_points) < 1E-8))
+        cells = vtk_to_numpy (mesh.GetCells().GetConnectivityArray())
+        self.assertTrue (alltrue (cells == ref_cells.flatten()))
+        scalars = vtk_to_numpy (mesh.GetCellData().GetScalars())
+        self.assertEqual (mesh.GetCellData().GetScalars().GetName(), "MaterialID")
+        self.assertTrue (alltrue (scalars == ref_scalars))
+
+    def test_data_on_cells (self):
+        image = vtk.vtkImageData()
+        image.SetDimensions (6,5,7)
+        image.SetOrigin (0.2,-1.0,1.5)
+        image.SetSpacing (2,4,5.5)
+        numpy.random.seed (1)
+        data = numpy.random.randint (0, 3, 5*4*6).astype(int16)
+        image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        self.check_against_reference (image, image)
+
+    def test_data_on_points (self):
+        image = vtk.vtkImageData()
+        image.SetDimensions (5,4,6)
+        image.SetExtent (1,5,2,5,0,5)
+        image.SetOrigin (0.2,-1.0,1.5)
+        image.SetSpacing (2,4,5.5)
+        numpy.random.seed (2)
+        data = numpy.random.randint (0, 127, 5*4*6).astype(uint8)
+        data[data < 64] = 0
+        image.GetPointData().SetScalars (numpy_to_vtk (data, deep=1))
+        cell_image = vtk.vtkImageData()
+        cell_image.SetDimensions (6,5,7)
+        cell_image.SetOrigin (0.2 + 0.5*2, -1.0 + 1.5*4, 1.5 - 0.5*5.5)
+        cell_image.SetSpacing (2,4,5.5)
+        cell_image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        self.check_against_reference (image, cell_image)
+
+    def check_streaming (self, image):
+        filter = vtkbone.vtkboneImageToMesh()
+        filter.SetInputData (image)
+        filter.Update()
+        mesh = filter.GetOutput()
+        for divisions in (2, 3, 100):
+            streamer = vtkbone.vtkboneImageToMesh()
+            streamer.SetInputData (image)
+            streamer.SetNumberOfStreamDivisions (divisions)
+            streamer.Update()
+            streamed = streamer.GetOutput()
+            self.assertEqual (streamed.GetNumberOfPoints(), mesh.GetNumberOfPoints())
+            self.assertEqual (streamed.GetNumberOfCells(), mesh.GetNumberOfCells())
+            self.assertTrue (alltrue (vtk_to_numpy (streamed.GetPoints().GetData()) ==
+                                      vtk_to_numpy (mesh.GetPoints().GetData())))
+            self.assertTrue (alltrue (vtk_to_numpy (streamed.GetCells().GetConnectivityArray()) ==
+                                      vtk_to_numpy (mesh.GetCells().GetConnectivityArray())))
+            self.assertTrue (alltrue (vtk_to_numpy (streamed.GetCellData().GetScalars()) ==
+                                      vtk_to_numpy (mesh.GetCellData().GetScalars())))
+
+    def test_streaming_data_on_cells (self):
+        image = vtk.vtkImageData()
+        image.SetExtent (0,5,0,4,3,9)
+        image.SetSpacing (2,4,5.5)
+        numpy.random.seed (3)
+        data = numpy.random.randint (0, 3, 5*4*6).astype(int16)
+        image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        self.check_streaming (image)
+
+    def test_streaming_data_on_points (self):
+        image = vtk.vtkImageData()
+        image.SetExtent (0,4,0,3,3,8)
+        image.SetOrigin (0.2,-1.0,1.5)
+        image.SetSpacing (2,4,5.5)
+        numpy.random.seed (4)
+        data = numpy.random.randint (0, 3, 5*4*6).astype(uint8)
+        image.GetPointData().SetScalars (numpy_to_vtk (data, deep=1))
+        self.check_streaming (image)
+
+    def test_streaming_failure (self):
+        source = FailingImageSource (fail_at=2)
+        streamer = vtkbone.vtkboneImageToMesh()
+        streamer.SetInputConnection (source.GetOutputPort())
+        streamer.SetNumberOfStreamDivisions (3)
+        vtk.vtkObject.GlobalWarningDisplayOff()
+        try:
+            # Must return rather than re-executing forever.
+            streamer.Update()
+        finally:
+            vtk.vtkObject.GlobalWarningDisplayOn()
+        self.assertEqual (source.executions, 2)
+        self.assertEqual (streamer.GetOutput().GetNumberOfCells(), 0)
+        # A subsequent update starts again from the first division.
+        source.fail_at = 1000
+        source.executions = 0
+        source.Modified()
+        streamer.Update()
+        self.assertEqual (source.executions, 3)
+        self.assertEqual (streamer.GetOutput().GetNumberOfCells(), 5*4*9)
+
+    def test_blank (self):
+        image = vtk.vtkImageData()
+        image.SetDimensions (4,4,4)
+        data = zeros(27, int16)
+        image.GetCellData().SetScalars (numpy_to_vtk (data, deep=1))
+        filter = vtkbone.vtkboneImageToMesh()
+        filter.SetInputData (image)
+        filter.Update()
+        self.assertEqual (filter.GetOutput().GetNumberOfPoints(), 0)
+        self.assertEqual (filter.GetOutput().GetNumberOfCells(), 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,162 @@
+from __future__ import division
+
+import unittest
+from numpy.core import *
+import numpy
+import vtk
+from vtk.util.numpy_support import vtk_to_numpy, numpy_to_vtk
+import vtkbone
+
+
+class TestInterpolateCoarseSolution (unittest.TestCase):
+
+  @staticmethod
+  def make_model (cells, spacing, origin):
+    cellmap = ones (cells[::-1], dtype=int16)
+    cellmap_vtk = numpy_to_vtk(cellmap.flatten().copy(), deep=1)
+    image = vtk.vtkImageData()
+    image.SetDimensions([c+1 for c in cells])
+    image.SetSpacing(spacing)
+    image.SetOrigin(origin)
+    image.GetCellData().SetScalars(cellmap_vtk)
+
+    geometry_generator = vtkbone.vtkboneImageToMesh()
+    geometry_generator.SetInputData(image)
+    geometry_generator.Update()
+
+    material = vtkbone.vtkboneLinearIsotropicMaterial()
+    material.SetYoungsModulus(1000)
+    material.SetPoissonsRatio(0.3)
+    material_table = vtkbone.vtkboneMaterialTable()
+    material_table.AddMaterial (1, material)
+
+    generator = vtkbone.vtkboneApplyCompressionTest()
+    generator.SetInputData(0, geometry_generator.GetOutput())
+    generator.SetInputData(1, material_table)
+    generator.Update()
+    return generator.GetOutput()
+
+  def get_models (self):
+    # Create 4x4x4 cube image
+    cellmap = ones ((4,4,4), dtype=int16)
+    cellmap_vtk = numpy_to_vtk(cellmap.flatten().copy(), deep=1)
+    image = vtk.vtkImageData()
+    image.SetDimensions((5,5,5))     # x,y,z order
+    image.SetSpacing(1.5,1.5,1.5)
+    image.SetOrigin(3.5,4.5,5.5)
+    image.GetCellData().SetScalars(cellmap_vtk)
+
+    geometry_generator = vtkbone.vtkboneImageToMesh()
+    geometry_generator.SetInputData(image)
+    geometry_generator.Update()
+    geometry = geometry_generator.GetOutput()
+
+    material = vtkbone.vtkboneLinearIsotropicMaterial()
+    material.SetYoungsModulus(1000)
+    material.SetPoissonsRatio(0.3)
+    material_table = vtkbone.vtkboneMaterialTable()
+    material_table.AddMaterial (1, material)
+
+    generator = vtkbone.vtkboneApplyCompressionTest()
+    generator.SetInputData(0, geometry)
+    generator.SetInputData(1, material_table)
+    generator.Update()
+    model = generator.GetOutput()
+
+    coarsener = vtkbone.vtkboneCoarsenModel()
+    coarsener.SetInputData (model)
+    coarsener.Update()
+    coarse_model = coarsener.GetOutput()
+    return model, coarse_model
+
+  @staticmethod
+  def linear_field (points):
+    # A linear field is reproduced exactly by trilinear interpolation.
+    u = zeros ((len(points),3), float32)
+    u[:,0] = 0.1*points[:,0] + 0.2*points[:,1]
+    u[:,1] = -0.3*points[:,2] + 1.0
+    u[:,2] = 0.05*points[:,0] - 0.1*points[:,1] + 0.2*points[:,2]
+    return u
+
+  def test_displacement (self):
+    model, coarse_model = self.get_models()
+    coarse_points = vtk_to_numpy (coarse_model.GetPoints().GetData())
+    u_vtk = numpy_to_vtk (self.linear_field(coarse_points), deep=1)
+    u_vtk.SetName ("Displacement")
+    coarse_model.GetPointData().AddArray (u_vtk)
+
+    interpolator = vtkbone.vtkboneInterpolateCoarseSolution()
+    interpolator.SetInputData (0, model)
+    interpolator.SetInputData (1, coarse_model)
+    interpolator.Update()
+    u = interpolator.GetSolutionArray()
+    self.assertEqual (u.GetName(), "Displacement")
+    self.assertEqual (u.GetNumberOfTuples(), model.GetNumberOfPoints())
+    self.assertEqual (u.GetNumberOfComponents(), 3)
+    points = vtk_to_numpy (model.GetPoints().GetData())
+    self.assertTrue (alltrue(abs(vtk_to_numpy(u) - self.linear_field(points)) < 1E-5))
+
+  def test_multiple_arrays (self):
+    model, coarse_model = self.get_models()
+    coarse_points = vtk_to_numpy (coarse_model.GetPoints().GetData())
+    u_vtk = numpy_to_vtk (self.linear_field(coarse_points), deep=1)
+    u_vtk.SetName ("Displacement")
+    coarse_model.GetPointData().AddArray (u_vtk)
+    t = (coarse_points[:,0] + 2*coarse_points[:,1] - coarse_points[:,2]).astype(float64)
+    t_vtk = numpy_to_vtk (t, deep=1)
+    t_vtk.SetName ("Temperature")
+    coarse_model.GetPointData().AddArray (t_vtk)
+
+    interpolator = vtkbone.vtkboneInterpolateCoarseSolution()
+    interpolator.SetInputData (0, model)
+    interpolator.SetInputData (1, coarse_model)
+    interpolator.AddArrayName ("Temperature")
+    interpolator.AddArrayName ("Displacement")
+    self.assertEqual (interpolator.GetNumberOfArrayNames(), 2)
+    interpolator.Update()
+
+    points = vtk_to_numpy (model.GetPoints().GetData())
+    data = interpolator.GetInterpolatedData()
+    self.assertEqual (data.GetNumberOfArrays(), 2)
+    u = data.GetArray ("Displacement")
+    self.assertTrue (alltrue(abs(vtk_to_numpy(u) - self.linear_field(points)) < 1E-5))
+    t = data.GetArray ("Temperature")
+    self.assertEqual (t.GetDataType(), vtk.VTK_DOUBLE)
+    self.assertEqual (t.GetNumberOfComponents(), 1)
+    t_expected = points[:,0] + 2*points[:,1] - points[:,2]
+    self.assertTrue (alltrue(abs(vtk_to_numpy(t) - t_expected) < 1E-10))
+    self.assertEqual (interpolator.GetSolutionArray().GetName(), "Displacement")
+
+  def interpolate_linear_field (self, model, coarse_model):
+    coarse_points = vtk_to_numpy (coarse_model.GetPoints().GetData())
+    u_vtk = numpy_to_vtk (self.linear_field(coarse_points), deep=1)
+    u_vtk.SetName ("Displacement")
+    coarse_model.GetPointData().AddArray (u_vtk)
+    interpolator = vtkbone.vtkboneInterpolateCoarseSolution()
+    interpolator.SetInputData (0, model)
+    interpolator.SetInputData (1, coarse_model)
+    interpolator.Update()
+    return vtk_to_numpy (interpolator.GetSolutionArray())
+
+  def test_integer_ratio (self):
+    for factor in (3, 4):
+      model = self.make_model ((12,12,12), (0.5,0.5,0.5), (1.0,2.0,3.0))
+      coarse_model = self.make_model ((12//factor,12//factor,12//factor),
+                                      (0.5*factor,0.5*factor,0.5*factor), (1.0,2.0,3.0))
+      u = self.interpolate_linear_field (model, coarse_model)
+      points = vtk_to_numpy (model.GetPoints().GetData())
+      self.assertTrue (alltrue(abs(u - self.linear_field(points)) < 1E-5))
+
+  def test_arbitrary_ratio (self):
+    # The coarse model does not cover the fine model in x; fine points
+    # beyond it take the values at the closest coarse point.
+    model = self.make_model ((6,6,6), (1.0,1.0,1.0), (0.0,0.0,0.0))
+    coarse_model = self.make_model ((2,3,3), (2.5,2.5,2.5), (0.0,0.0,0.0))
+    u = self.interpolate_linear_field (model, coarse_model)
+    points = vtk_to_numpy (model.GetPoints().GetData()).copy()
+    points[:,0] = minimum (points[:,0], 5.0)
+    self.assertTrue (alltrue(abs(u - self.linear_field(points)) < 1E-5))
+
+
+if __name__ == '__main__':
+  unittest.main()
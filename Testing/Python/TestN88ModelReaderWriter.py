@@ -0,0 +1,318 @@
+from __future__ import division
+import sys
+import os
+import shutil
+import tempfile
+import numpy
+from numpy.core import *
+import vtk
+from vtk.util.numpy_support import vtk_to_numpy, numpy_to_vtk
+import vtkbone
+import traceback
+import unittest
+
+
+def make_model (cdims, holes=()):
+    """Returns a compression test model of a block of cdims voxels (x,y,z
+    order), with the voxels of linear indices holes removed."""
+    cellmap = ones (cdims[0]*cdims[1]*cdims[2], int16)
+    for h in holes:
+        cellmap[h] = 0
+    image = vtk.vtkImageData()
+    image.SetDimensions (cdims[0]+1, cdims[1]+1, cdims[2]+1)
+    image.SetSpacing (0.5, 0.5, 0.5)
+    image.GetCellData().SetScalars (numpy_to_vtk (cellmap, deep=1))
+    geometry_generator = vtkbone.vtkboneImageToMesh()
+    geometry_generator.SetInputData (image)
+    material = vtkbone.vtkboneLinearIsotropicMaterial()
+    material.SetYoungsModulus (6829)
+    material.SetPoissonsRatio (0.3)
+    material_table = vtkbone.vtkboneMaterialTable()
+    material_table.AddMaterial (1, material)
+    generator = vtkbone.vtkboneApplyCompressionTest()
+    generator.SetInputConnection (0, geometry_generator.GetOutputPort())
+    generator.SetInputData (1, material_table)
+    generator.Update()
+    return generator.GetOutput()
+
+
+class TestN88ModelReaderWriter (unittest.TestCase):
+
+    def setUp (self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown (self):
+        shutil.rmtree (self.directory)
+
+    def write_model (self, model, filename, configure=None):
+        writer = vtkbone.vtkboneN88ModelWriter()
+        writer.SetInputData (model)
+        writer.SetFileName (filename)
+        if configure:
+            configure (writer)
+        writer.Update()
+        return writer
+
+    def read_model (self, filename, configure=None):
+        reader = vtkbone.vtkboneN88ModelReader()
+        reader.SetFileName (filename)
+        if configure:
+            configure (reader)
+        reader.Update()
+        return reader.GetOutput()
+
+    def test_elements_round_trip (self):
+        # The node numbers are written and read in blocks of 65536
+        # elements; the element count is not a multiple of that.
+        cdims = (41, 41, 41)
+        model = make_model (cdims, holes=(0, 100, 5000, 68920))
+        self.assertEqual (model.GetNumberOfCells(), 41*41*41 - 4)
+        self.assertNotEqual (model.GetNumberOfCells() % 65536, 0)
+        filename = os.path.join (self.directory, "elements.n88model")
+        self.write_model (model, filename)
+        result = self.read_model (filename)
+        self.assertEqual (result.GetNumberOfCells(), model.GetNumberOfCells())
+        self.assertEqual (result.GetNumberOfPoints(), model.GetNumberOfPoints())
+        self.assertTrue (alltrue (vtk_to_numpy (result.GetCellTypesArray()) == vtk.VTK_VOXEL))
+        self.assertTrue (alltrue (
+            vtk_to_numpy (result.GetCells().GetConnectivityArray()) ==
+            vtk_to_numpy (model.GetCells().GetConnectivityArray())))
+        self.assertTrue (alltrue (
+            vtk_to_numpy (result.GetCells().GetOffsetsArray()) ==
+            vtk_to_numpy (model.GetCells().GetOffsetsArray())))
+        self.assertTrue (alltrue (
+            vtk_to_numpy (result.GetPoints().GetData()) ==
+            vtk_to_numpy (model.GetPoints().GetData())))
+        self.assertTrue (alltrue (
+            vtk_to_numpy (result.GetCellData().GetScalars()) ==
+            vtk_to_numpy (model.GetCellData().GetScalars())))
+
+    def test_compression_round_trip (self):
+        model = make_model ((20, 16, 12), holes=(3, 50, 200))
+        numpy.random.seed (11)
+        displacement = numpy.random.rand (model.GetNumberOfPoints(), 3).astype(float32)
+        displacement_vtk = numpy_to_vtk (displacement, deep=1)
+        displacement_vtk.SetName ("Displacement")
+        model.GetPointData().AddArray (displacement_vtk)
+
+        plain = os.path.join (self.directory, "plain.n88model")
+        self.write_model (model, plain)
+        W = vtkbone.vtkboneN88ModelWriter
+        settings = ((W.DEFLATE, 1, 0, ()),
+                    (W.DEFLATE, 9, 1, ()),
+                    (W.DEFLATE, 5, 0, (("NodeNumbers", W.DEFLATE, 0),
+                                       ("Displacement", W.DEFLATE, 9))),
+                    (W.ZSTANDARD, 3, 0, ()),
+                    (W.ZSTANDARD, 19, 1, (("Coordinates", W.DEFLATE, 4),)))
+        for n, (codec, level, shuffle, variables) in enumerate (settings):
+            # Zstandard would fall back to deflate with a warning if
+            # unavailable, which would not test it.
+            if not W.IsCompressionCodecAvailable (codec):
+                continue
+            warnings = []
+            def configure (writer):
+                writer.CompressionOn()
+                writer.SetCompressionCodec (codec)
+                writer.SetCompressionLevel (level)
+                writer.SetShuffle (shuffle)
+                for name, c, l in variables:
+                    writer.SetVariableCompression (name, c, l)
+                writer.AddObserver ("WarningEvent", lambda obj, event: warnings.append (event))
+            filename = os.path.join (self.directory, "compressed%d.n88model" % n)
+            writer = self.write_model (model, filename, configure)
+            self.assertEqual (warnings, [])
+            self.assertEqual (writer.GetCompressionCodec(), codec)
+            self.assertEqual (writer.GetCompressionLevel(), level)
+            self.assertEqual (writer.GetShuffle(), shuffle)
+            if "NodeNumbers" not in [v[0] for v in variables]:
+                self.assertTrue (os.path.getsize (filename) < os.path.getsize (plain))
+            result = self.read_model (filename)
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetCells().GetConnectivityArray()) ==
+                vtk_to_numpy (model.GetCells().GetConnectivityArray())))
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetPoints().GetData()) ==
+                vtk_to_numpy (model.GetPoints().GetData())))
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetPointData().GetArray ("Displacement")) ==
+                displacement))
+
+    def test_parallel_compression (self):
+        W = vtkbone.vtkboneN88ModelWriter
+        if not W.IsParallelCompressionAvailable():
+            self.skipTest ("parallel compression not supported by this build")
+        # 144000 elements: NodeNumbers has two chunks of 131072 rows, the
+        # last one partial.
+        model = make_model ((60, 60, 40), holes=(10, 20000))
+        numpy.random.seed (14)
+        displacement = numpy.random.rand (model.GetNumberOfPoints(), 3).astype(float32)
+        displacement_vtk = numpy_to_vtk (displacement, deep=1)
+        displacement_vtk.SetName ("Displacement")
+        model.GetPointData().AddArray (displacement_vtk)
+
+        plain = os.path.join (self.directory, "plain.n88model")
+        self.write_model (model, plain)
+        settings = ((1, 0, ()),
+                    (9, 1, ()),
+                    (5, 0, (("NodeNumbers", W.DEFLATE, 0),
+                            ("Displacement", W.DEFLATE, 9))))
+        for n, (level, shuffle, variables) in enumerate (settings):
+            errors = []
+            def configure (writer):
+                writer.CompressionOn()
+                writer.SetCompressionLevel (level)
+                writer.SetShuffle (shuffle)
+                for name, c, l in variables:
+                    writer.SetVariableCompression (name, c, l)
+                writer.ParallelCompressionOn()
+                writer.AddObserver ("ErrorEvent", lambda obj, event: errors.append (event))
+            filename = os.path.join (self.directory, "parallel%d.n88model" % n)
+            self.write_model (model, filename, configure)
+            self.assertEqual (errors, [])
+            if "NodeNumbers" not in [v[0] for v in variables]:
+                self.assertTrue (os.path.getsize (filename) < os.path.getsize (plain))
+            result = self.read_model (filename)
+            self.assertEqual (result.GetNumberOfCells(), model.GetNumberOfCells())
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetCells().GetConnectivityArray()) ==
+                vtk_to_numpy (model.GetCells().GetConnectivityArray())))
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetPoints().GetData()) ==
+                vtk_to_numpy (model.GetPoints().GetData())))
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetCellData().GetScalars()) ==
+                vtk_to_numpy (model.GetCellData().GetScalars())))
+            self.assertTrue (alltrue (
+                vtk_to_numpy (result.GetPointData().GetArray ("Displacement")) ==
+                displacement))
+
+    def test_read_switches (self):
+        model = make_model ((6, 5, 4))
+        numpy.random.seed (12)
+        for name, n in (("Displacement", 3), ("ReactionForce", 3)):
+            values = numpy_to_vtk (numpy.random.rand (model.GetNumberOfPoints(), n)
+                                   .astype(float32), deep=1)
+            values.SetName (name)
+            model.GetPointData().AddArray (values)
+        sed = numpy_to_vtk (numpy.random.rand (model.GetNumberOfCells())
+                            .astype(float32), deep=1)
+        sed.SetName ("StrainEnergyDensity")
+        model.GetCellData().AddArray (sed)
+        filename = os.path.join (self.directory, "switches.n88model")
+        self.write_model (model, filename)
+
+        def check (result, geometry=True, materials=True, boundary_conditions=True,
+                   sets=True, solutions=("Displacement", "ReactionForce",
+                                         "StrainEnergyDensity")):
+            self.assertEqual (result.GetNumberOfPoints(),
+                              model.GetNumberOfPoints() if geometry else 0)
+            self.assertEqual (result.GetNumberOfCells(),
+                              model.GetNumberOfCells() if geometry else 0)
+            self.assertEqual (result.GetMaterialTable().GetNumberOfMaterials(),
+                              1 if materials else 0)
+            self.assertEqual (result.GetConstraints().GetNumberOfItems(),
+                              2 if boundary_conditions else 0)
+            self.assertEqual (result.GetConvergenceSet() is not None,
+                              boundary_conditions)
+            self.assertEqual (result.GetNodeSet ("face_z1") is not None, sets)
+            self.assertEqual (result.GetNodeSets().GetNumberOfItems() > 0, sets)
+            for name in ("Displacement", "ReactionForce"):
+                self.assertEqual (result.GetPointData().GetArray (name) is not None,
+                                  name in solutions)
+            self.assertEqual (result.GetCellData().GetArray ("StrainEnergyDensity")
+                              is not None, "StrainEnergyDensity" in solutions)
+
+        check (self.read_model (filename))
+        check (self.read_model (filename, lambda r: r.ReadGeometryOff()),
+               geometry=False, solutions=())
+        check (self.read_model (filename, lambda r: r.ReadMaterialsOff()),
+               materials=False)
+        check (self.read_model (filename, lambda r: r.ReadBoundaryConditionsOff()),
+               boundary_conditions=False)
+        check (self.read_model (filename, lambda r: r.ReadNodeAndElementSetsOff()),
+               sets=False)
+        check (self.read_model (filename, lambda r: r.ReadSolutionValuesOff()),
+               solutions=())
+        check (self.read_model (filename, lambda r: r.AddSolutionArrayName ("ReactionForce")),
+               solutions=("ReactionForce",))
+
+        # The solution variables are listed without being read.
+        reader = vtkbone.vtkboneN88ModelReader()
+        reader.SetFileName (filename)
+        reader.UpdateInformation()
+        node_names = reader.GetNodeValueNames()
+        self.assertEqual (sorted (node_names.GetValue(i)
+                                  for i in range (node_names.GetNumberOfValues())),
+                          ["Displacement", "ReactionForce"])
+        element_names = reader.GetElementValueNames()
+        self.assertEqual ([element_names.GetValue(i)
+                           for i in range (element_names.GetNumberOfValues())],
+                          ["StrainEnergyDensity"])
+        self.assertEqual (reader.GetOutput().GetNumberOfPoints(), 0)
+
+    def test_partial_reads (self):
+        model = make_model ((10, 8, 6), holes=(7, 90))
+        numpy.random.seed (13)
+        displacement = numpy_to_vtk (numpy.random.rand (model.GetNumberOfPoints(), 3)
+                                     .astype(float32), deep=1)
+        displacement.SetName ("Displacement")
+        model.GetPointData().AddArray (displacement)
+        sed = numpy_to_vtk (numpy.random.rand (model.GetNumberOfCells())
+                            .astype(float32), deep=1)
+        sed.SetName ("StrainEnergyDensity")
+        model.GetCellData().AddArray (sed)
+        filename = os.path.join (self.directory, "partial.n88model")
+        self.write_model (model, filename)
+
+        full = self.read_model (filename)
+        full_displacement = vtk_to_numpy (full.GetPointData().GetArray ("Displacement"))
+        full_sed = vtk_to_numpy (full.GetCellData().GetArray ("StrainEnergyDensity"))
+        n_points = full.GetNumberOfPoints()
+        n_cells = full.GetNumberOfCells()
+
+        reader = vtkbone.vtkboneN88ModelReader()
+        reader.SetFileName (filename)
+
+        def check (status, values, expected):
+            self.assertEqual (status, 1)   # VTK_OK
+            result = vtk_to_numpy (values).reshape (expected.shape)
+            self.assertTrue (alltrue (result == expected))
+
+        # Node and element sets
+        for name in ("face_z0", "face_z1"):
+            ids = vtk_to_numpy (full.GetNodeSet (name))
+            values = vtk.vtkFloatArray()
+            check (reader.ReadNodeValuesForSet ("Displacement", name, values),
+                   values, full_displacement[ids])
+            ids = vtk_to_numpy (full.GetElementSet (name))
+            values = vtk.vtkFloatArray()
+            check (reader.ReadElementValuesForSet ("StrainEnergyDensity", name, values),
+                   values, full_sed[ids])
+
+        # Unsorted, repeated and non-contiguous ids, with gaps both shorter
+        # and longer than those merged into a single read.
+        for n, getter, name, full_values in (
+                (n_points, reader.ReadNodeValuesForIds, "Displacement", full_displacement),
+                (n_cells, reader.ReadElementValuesForIds, "StrainEnergyDensity", full_sed)):
+            ids = array ([n-1, 0, 5, 5, 200, 37, 38, 39, 60, n//2, 3, n-1])
+            ids_vtk = numpy_to_vtk (ids, deep=1, array_type=vtk.VTK_ID_TYPE)
+            values = vtk.vtkFloatArray()
+            check (getter (name, ids_vtk, values), values, full_values[ids])
+
+        # Merged runs longer than the maximum read size are split: with 40
+        # bytes, runs are limited to 3 rows of Displacement and 10 rows of
+        # StrainEnergyDensity.  A size smaller than a row reads row by row.
+        self.assertEqual (reader.GetMaximumPartialReadSize(), 1<<22)
+        for size in (40, 1):
+            reader.SetMaximumPartialReadSize (size)
+            for n, getter, name, full_values in (
+                    (n_points, reader.ReadNodeValuesForIds, "Displacement", full_displacement),
+                    (n_cells, reader.ReadElementValuesForIds, "StrainEnergyDensity", full_sed)):
+                ids = numpy.concatenate ((numpy.arange (20, 61), numpy.arange (n-1, n-30, -2), [25, 0]))
+                ids_vtk = numpy_to_vtk (ids, deep=1, array_type=vtk.VTK_ID_TYPE)
+                values = vtk.vtkFloatArray()
+                check (getter (name, ids_vtk, values), values, full_values[ids])
+
+
+if __name__ == '__main__':
+    unittest.main()
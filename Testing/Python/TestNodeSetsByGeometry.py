@@ -875,5 +875,41 @@ class TestNodeSetsByGeometry (unittest.TestCase):
         self.assertTrue (alltrue(ids == expected_ids))
 
 
+    def test_cached_index (self):
+
+        geometry = test_geometries.generate_quasi_donut_geometry_two_materials_offset()
+
+        # Repeated queries return the same nodes, in increasing order.
+        ids_vtk = vtk.vtkIdTypeArray()
+        vtkbone.vtkboneNodeSetsByGeometry.FindNodesOnPlane(0, 0.5, ids_vtk, geometry, -1)
+        first = vtk_to_numpy(ids_vtk).copy()
+        self.assertEqual (len(first), 24)
+        self.assertTrue (alltrue(first[1:] > first[:-1]))
+        self.assertTrue (geometry.GetInformation().Has(
+            vtkbone.vtkboneNodeSetsByGeometry.COORDINATE_INDEX()))
+        ids_vtk = vtk.vtkIdTypeArray()
+        vtkbone.vtkboneNodeSetsByGeometry.FindNodesOnPlane(0, 0.5, ids_vtk, geometry, -1)
+        self.assertTrue (alltrue(vtk_to_numpy(ids_vtk) == first))
+
+        # Moving the points invalidates the index.
+        points = vtk_to_numpy(geometry.GetPoints().GetData())
+        points[:,0] += 1.0
+        geometry.GetPoints().Modified()
+        ids_vtk = vtk.vtkIdTypeArray()
+        vtkbone.vtkboneNodeSetsByGeometry.FindNodesOnPlane(0, 0.5, ids_vtk, geometry, -1)
+        self.assertEqual (ids_vtk.GetNumberOfTuples(), 0)
+        ids_vtk = vtk.vtkIdTypeArray()
+        vtkbone.vtkboneNodeSetsByGeometry.FindNodesOnPlane(0, 1.5, ids_vtk, geometry, -1)
+        self.assertTrue (alltrue(vtk_to_numpy(ids_vtk) == first))
+
+        # Releasing the index frees it; it is rebuilt by the next query.
+        vtkbone.vtkboneNodeSetsByGeometry.ReleaseCoordinateIndex(geometry)
+        self.assertFalse (geometry.GetInformation().Has(
+            vtkbone.vtkboneNodeSetsByGeometry.COORDINATE_INDEX()))
+        ids_vtk = vtk.vtkIdTypeArray()
+        vtkbone.vtkboneNodeSetsByGeometry.FindNodesOnPlane(0, 1.5, ids_vtk, geometry, -1)
+        self.assertTrue (alltrue(vtk_to_numpy(ids_vtk) == first))
+
+
 if __name__ == '__main__':
     unittest.main()
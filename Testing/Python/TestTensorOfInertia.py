@@ -247,5 +247,237 @@ class TestTensorOfInertia (unittest.TestCase):
         tensor_of_inertia_standard_analysis(toi, I_ref, COM_ref, count_ref, mass_ref)
 
 
+    def test_random_image (self):
+
+        # An image large enough to be split over several threads, with
+        # scalars of a type other than those of the step images.
+        #
+        numpy.random.seed(12345)
+        dims = (23,31,17)    # x,y,z
+        cellmap = numpy.random.randint(0, 4, size=dims[::-1]).astype(uint16)
+        spacing = array((0.5,0.25,0.75))
+        offset = array((-3.0,2.0,7.5))
+        image = vtk.vtkImageData()
+        image.SetDimensions([d+1 for d in dims])
+        image.SetSpacing(spacing)
+        image.SetOrigin(offset)
+        image.GetCellData().SetScalars(numpy_to_vtk(cellmap.flatten().copy(), deep=1))
+
+        toi = vtkbone.vtkboneTensorOfInertia()
+        toi.SetInputData (image)
+        toi.UseThresholdsOn()
+        toi.SetLowerThreshold(2)
+        toi.SetUpperThreshold(3)
+        toi.Update()
+
+        k,j,i = numpy.ogrid[0:dims[2],0:dims[1],0:dims[0]]
+        x = offset[0] + (i+0.5)*spacing[0]
+        y = offset[1] + (j+0.5)*spacing[1]
+        z = offset[2] + (k+0.5)*spacing[2]
+        mask = (cellmap >= 2)
+        voxel_vol = spacing[0]*spacing[1]*spacing[2]
+        count_ref = sum(mask)
+        self.assertEqual(toi.GetCount(), count_ref)
+        self.assertAlmostEqual(toi.GetVolume(), voxel_vol*count_ref)
+        COM_ref = array((sum(x*mask), sum(y*mask), sum(z*mask)))/count_ref
+        self.assertTrue(alltrue(abs(array(toi.GetCenterOfMass()) - COM_ref) < 1E-10))
+        x = x - COM_ref[0]
+        y = y - COM_ref[1]
+        z = z - COM_ref[2]
+        I_ref = zeros((3,3), float)
+        I_ref[0,0] = voxel_vol * sum((y**2 + z**2)*mask)
+        I_ref[1,1] = voxel_vol * sum((z**2 + x**2)*mask)
+        I_ref[2,2] = voxel_vol * sum((x**2 + y**2)*mask)
+        I_ref[1,0] = I_ref[0,1] = -voxel_vol * sum(x*y*mask)
+        I_ref[2,0] = I_ref[0,2] = -voxel_vol * sum(x*z*mask)
+        I_ref[1,2] = I_ref[2,1] = -voxel_vol * sum(y*z*mask)
+        I_vtk = vtkbone.vtkboneTensor()
+        toi.GetTensorOfInertia(I_vtk)
+        I = zeros((3,3), float)
+        for a,b in itertools.product(list(range(3)),list(range(3))):
+            I[a,b] = I_vtk.GetComponent(a,b)
+        self.assertTrue(alltrue(abs(I - I_ref) < 1E-10*abs(I_ref).max()))
+
+        # The mesh of the image without thresholds gives the same results
+        # as the image without thresholds.
+        toi.UseThresholdsOff()
+        toi.Update()
+        hexa = vtkbone.vtkboneImageToMesh()
+        hexa.SetInputData(image)
+        hexa.Update()
+        toi2 = vtkbone.vtkboneTensorOfInertia()
+        toi2.SetInputData(hexa.GetOutput())
+        toi2.Update()
+        self.assertEqual(toi2.GetCount(), toi.GetCount())
+        self.assertAlmostEqual(toi2.GetVolume(), toi.GetVolume(), places=4)
+        self.assertTrue(alltrue(abs(array(toi2.GetCenterOfMass()) -
+                                    array(toi.GetCenterOfMass())) < 1E-4))
+        I2_vtk = vtkbone.vtkboneTensor()
+        toi2.GetTensorOfInertia(I2_vtk)
+        toi.GetTensorOfInertia(I_vtk)
+        for a,b in itertools.product(list(range(3)),list(range(3))):
+            self.assertTrue(abs(I2_vtk.GetComponent(a,b) - I_vtk.GetComponent(a,b))
+                            < 1E-5*abs(I_ref).max())
+
+
+    def test_streaming (self):
+
+        # vtkImageShiftScale produces only the requested extent, so that
+        # the input arrives slab by slab.
+        #
+        numpy.random.seed(23456)
+        dims = (19,13,29)    # x,y,z
+        values = numpy.random.randint(0, 3, size=dims[::-1]).astype(int16)
+        image = vtk.vtkImageData()
+        image.SetDimensions(dims)
+        image.SetSpacing(0.5,0.75,0.25)
+        image.SetOrigin(-1.0,3.0,2.0)
+        image.GetPointData().SetScalars(numpy_to_vtk(values.flatten().copy(), deep=1))
+        shift = vtk.vtkImageShiftScale()
+        shift.SetInputData(image)
+        shift.SetShift(0)
+        shift.SetScale(1)
+
+        toi = vtkbone.vtkboneTensorOfInertia()
+        toi.SetInputData(image)
+        toi.SetSpecificValue(2)
+        toi.UseSpecificValueOn()
+        toi.Update()
+        I_vtk = vtkbone.vtkboneTensor()
+        toi.GetTensorOfInertia(I_vtk)
+
+        for divisions in (2, 5, 29, 100):
+            toi2 = vtkbone.vtkboneTensorOfInertia()
+            toi2.SetInputConnection(shift.GetOutputPort())
+            toi2.SetSpecificValue(2)
+            toi2.UseSpecificValueOn()
+            toi2.SetNumberOfStreamDivisions(divisions)
+            toi2.Update()
+            self.assertEqual(toi2.GetUseSpecificValue(), 1)
+            self.assertEqual(toi2.GetCount(), toi.GetCount())
+            self.assertAlmostEqual(toi2.GetVolume(), toi.GetVolume())
+            self.assertTrue(alltrue(abs(array(toi2.GetCenterOfMass()) -
+                                        array(toi.GetCenterOfMass())) < 1E-10))
+            I2_vtk = vtkbone.vtkboneTensor()
+            toi2.GetTensorOfInertia(I2_vtk)
+            for a,b in itertools.product(list(range(3)),list(range(3))):
+                self.assertAlmostEqual(I2_vtk.GetComponent(a,b), I_vtk.GetComponent(a,b))
+
+
+    def test_streaming_cells (self):
+
+        # The whole image is available for each division, but only the
+        # cell layers of the requested slab may be accumulated.
+        #
+        numpy.random.seed(34567)
+        cdims = (11,8,17)    # x,y,z
+        values = numpy.random.randint(0, 3, size=cdims[::-1]).astype(int16)
+        image = vtk.vtkImageData()
+        image.SetDimensions(cdims[0]+1, cdims[1]+1, cdims[2]+1)
+        image.SetSpacing(0.5,0.75,0.25)
+        image.SetOrigin(-1.0,3.0,2.0)
+        image.GetCellData().SetScalars(numpy_to_vtk(values.flatten().copy(), deep=1))
+
+        toi = vtkbone.vtkboneTensorOfInertia()
+        toi.SetInputData(image)
+        toi.SetSpecificValue(1)
+        toi.UseSpecificValueOn()
+        toi.Update()
+        self.assertEqual(toi.GetCount(), (values == 1).sum())
+        I_vtk = vtkbone.vtkboneTensor()
+        toi.GetTensorOfInertia(I_vtk)
+
+        for divisions in (2, 3, 16, 17, 100):
+            toi2 = vtkbone.vtkboneTensorOfInertia()
+            toi2.SetInputData(image)
+            toi2.SetSpecificValue(1)
+            toi2.UseSpecificValueOn()
+            toi2.SetNumberOfStreamDivisions(divisions)
+            toi2.Update()
+            self.assertEqual(toi2.GetCount(), toi.GetCount())
+            self.assertAlmostEqual(toi2.GetVolume(), toi.GetVolume())
+            self.assertTrue(alltrue(abs(array(toi2.GetCenterOfMass()) -
+                                        array(toi.GetCenterOfMass())) < 1E-10))
+            I2_vtk = vtkbone.vtkboneTensor()
+            toi2.GetTensorOfInertia(I2_vtk)
+            for a,b in itertools.product(list(range(3)),list(range(3))):
+                self.assertAlmostEqual(I2_vtk.GetComponent(a,b), I_vtk.GetComponent(a,b))
+
+
+    def test_extent_not_starting_at_zero (self):
+
+        # The voxel positions are origin + index*spacing, where the indices
+        # start at the extent, not at zero.
+        #
+        numpy.random.seed(45678)
+        dims = (5,4,3)    # x,y,z
+        extent = (2,6,-1,2,3,5)
+        spacing = (0.5,0.75,0.25)
+        origin = (-1.0,3.0,2.0)
+        values = numpy.random.randint(0, 2, size=dims[::-1]).astype(int16)
+        image = vtk.vtkImageData()
+        image.SetExtent(extent)
+        image.SetSpacing(spacing)
+        image.SetOrigin(origin)
+        image.GetPointData().SetScalars(numpy_to_vtk(values.flatten().copy(), deep=1))
+
+        toi = vtkbone.vtkboneTensorOfInertia()
+        toi.SetInputData(image)
+        toi.SetSpecificValue(1)
+        toi.UseSpecificValueOn()
+        toi.Update()
+
+        k,j,i = numpy.nonzero(values == 1)
+        x = array((origin[0] + (i + extent[0])*spacing[0],
+                   origin[1] + (j + extent[2])*spacing[1],
+                   origin[2] + (k + extent[4])*spacing[2])).transpose()
+        self.assertEqual(toi.GetCount(), len(x))
+        self.assertTrue(alltrue(abs(array(toi.GetCenterOfMass()) - x.mean(axis=0)) < 1E-10))
+
+        # The same image with the extent starting at zero, and the origin
+        # moved to keep the voxels in place.
+        shifted = vtk.vtkImageData()
+        shifted.SetDimensions(dims)
+        shifted.SetSpacing(spacing)
+        shifted.SetOrigin([origin[a] + extent[2*a]*spacing[a] for a in range(3)])
+        shifted.GetPointData().SetScalars(image.GetPointData().GetScalars())
+        toi2 = vtkbone.vtkboneTensorOfInertia()
+        toi2.SetInputData(shifted)
+        toi2.SetSpecificValue(1)
+        toi2.UseSpecificValueOn()
+        toi2.Update()
+        self.assertTrue(alltrue(abs(array(toi2.GetCenterOfMass()) -
+                                    array(toi.GetCenterOfMass())) < 1E-10))
+        I_vtk = vtkbone.vtkboneTensor()
+        toi.GetTensorOfInertiaAboutOrigin(I_vtk)
+        I2_vtk = vtkbone.vtkboneTensor()
+        toi2.GetTensorOfInertiaAboutOrigin(I2_vtk)
+        for a,b in itertools.product(list(range(3)),list(range(3))):
+            self.assertAlmostEqual(I2_vtk.GetComponent(a,b), I_vtk.GetComponent(a,b))
+
+
+    def test_empty_selection (self):
+
+        # No voxel has the specific value: everything is zero.
+        #
+        image = test_geometries.generate_step_image()
+        for divisions in (1, 2):
+            toi = vtkbone.vtkboneTensorOfInertia()
+            toi.SetInputData(image)
+            toi.SetSpecificValue(99)
+            toi.UseSpecificValueOn()
+            toi.SetNumberOfStreamDivisions(divisions)
+            toi.Update()
+            self.assertEqual(toi.GetCount(), 0)
+            self.assertEqual(toi.GetVolume(), 0)
+            self.assertEqual(toi.GetMass(), 0)
+            self.assertEqual(toi.GetCenterOfMass(), (0,0,0))
+            for getter in (toi.GetTensorOfInertia, toi.GetTensorOfInertiaAboutOrigin):
+                I_vtk = vtkbone.vtkboneTensor()
+                getter(I_vtk)
+                for a,b in itertools.product(list(range(3)),list(range(3))):
+                    self.assertEqual(I_vtk.GetComponent(a,b), 0)
+
+
 if __name__ == '__main__':
     unittest.main()